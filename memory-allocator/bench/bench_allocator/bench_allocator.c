@@ -0,0 +1,385 @@
+#include "allocator.h"
+#include "bench_common.h"
+#include "timing.h"
+
+#include "getopt.h"
+#include "stdlib.h"
+#include "string.h"
+
+#define __FILENAME__     "bench_allocator.c"
+#define LOG_MODULE_GROUP LOG_GROUP_DEFAULT
+#define LOG_LEVEL        LOG_LEVEL_ERROR
+#include "logging.h"
+
+// Every case uses the whole range of block sizes the allocator supports
+#define MIN_BLOCK_SIZE 8
+#define MAX_BLOCK_SIZE 255
+
+// Block sizes are drawn up front so that generating them isn't measured. Must be a power of two
+#define SIZE_TABLE_LENGTH 4096
+
+// Operations are timed in batches, as many as fit in the free space of the buffer up to this many
+#define MAX_BATCH 1024
+
+#define DEFAULT_OPS      1000000
+#define MAX_CAPACITIES   16
+#define CASE_NAME_LENGTH 128
+
+// Name of a reported result, the longest implementation and operation followed by the case name
+#define REPORT_NAME_LENGTH (sizeof("allocator/alloc/") + CASE_NAME_LENGTH)
+
+typedef enum {
+    DISTRIBUTION_FIXED,    // Every block is 64 bytes
+    DISTRIBUTION_UNIFORM,  // Uniform between MIN_BLOCK_SIZE and MAX_BLOCK_SIZE
+    DISTRIBUTION_BIMODAL,  // 90% small blocks up to 32 bytes, 10% large blocks from 192 bytes
+    DISTRIBUTION_COUNT,
+} distribution_t;
+
+static const char* distribution_names[DISTRIBUTION_COUNT] = { "fixed", "uniform", "bimodal" };
+
+// From a buffer that fits in L1 to one that only fits in DRAM
+static const size_t default_capacities[] = { 4096, 256 * 1024, 8 * 1024 * 1024, 256 * 1024 * 1024 };
+
+// Percentage of the buffer in use while measuring
+static const unsigned int fill_levels[] = { 0, 50, 90 };
+
+typedef struct {
+    size_t capacities[MAX_CAPACITIES];
+    size_t capacity_count;
+    uint64_t ops;
+    const char* p_filter;
+    bench_format_t format;
+    const char* p_output;  // NULL for stdout
+    bool keep_log_levels;
+} options_t;
+
+static const char* const metrics[] = { "ns_per_op", "ops_per_sec" };
+
+// Read by peek so that it can't be optimized away
+static volatile uint8_t sink;
+
+static void fill_sizes(uint8_t* p_sizes, distribution_t distribution) {
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+
+    for (size_t i = 0; i < SIZE_TABLE_LENGTH; i++) {
+        uint64_t random = bench_random(&state);
+        switch (distribution) {
+            case DISTRIBUTION_FIXED:
+                p_sizes[i] = 64;
+                break;
+            case DISTRIBUTION_UNIFORM:
+                p_sizes[i] = (uint8_t)(MIN_BLOCK_SIZE + (random % (MAX_BLOCK_SIZE - MIN_BLOCK_SIZE + 1)));
+                break;
+            default:
+                if ((random % 10) != 0) {
+                    p_sizes[i] = (uint8_t)(MIN_BLOCK_SIZE + ((random >> 8) % (32 - MIN_BLOCK_SIZE + 1)));
+                } else {
+                    p_sizes[i] = (uint8_t)(192 + ((random >> 8) % (MAX_BLOCK_SIZE - 192 + 1)));
+                }
+                break;
+        }
+    }
+}
+
+static size_t get_batch_size(size_t capacity, size_t target) {
+    size_t batch = (capacity - target) / MAX_BLOCK_SIZE;
+
+    if (batch == 0) {
+        return 1;
+    }
+    return (batch < MAX_BATCH) ? batch : MAX_BATCH;
+}
+
+static double to_ns_per_op(uint64_t ticks, uint64_t ops) {
+    return (ops > 0) ? ((double)timing_ticks_to_ns(ticks) / (double)ops) : 0.0;
+}
+
+// Measures alloc, peek and free at a constant fill level. Every round allocates a batch of blocks, peeks as many
+// times and frees the oldest blocks until the fill level is back to the target. Blocks are freed in the order
+// they were allocated, so the size of the oldest one is known without asking the allocator
+static bool run_allocator(size_t capacity, unsigned int fill, const uint8_t* p_sizes, uint64_t ops, double* p_ns_per_op) {
+    allocator_t* p_allocator = allocator_init(capacity, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE);
+    if (p_allocator == NULL) {
+        return false;
+    }
+
+    size_t target = (capacity / 100) * fill;
+    size_t batch = get_batch_size(capacity, target);
+    size_t used = 0;
+    size_t next_alloc = 0;
+    size_t next_free = 0;
+    uint8_t* p_block;
+    size_t block_size;
+    bool failed = false;
+
+    while ((used < target) && (failed == false)) {
+        block_size = p_sizes[next_alloc++ & (SIZE_TABLE_LENGTH - 1)];
+        failed = (allocator_alloc(p_allocator, block_size, &p_block) != ALLOCATOR_SUCCESS);
+        used += block_size;
+    }
+
+    uint64_t ticks[ALLOCATOR_OP_COUNT] = { 0 };
+    uint64_t counts[ALLOCATOR_OP_COUNT] = { 0 };
+
+    while ((counts[ALLOCATOR_OP_ALLOC] < ops) && (failed == false)) {
+        uint64_t start = timing_now_ticks();
+        for (size_t i = 0; i < batch; i++) {
+            block_size = p_sizes[next_alloc++ & (SIZE_TABLE_LENGTH - 1)];
+            failed |= (allocator_alloc(p_allocator, block_size, &p_block) != ALLOCATOR_SUCCESS);
+            p_block[0] = (uint8_t)i;
+            used += block_size;
+        }
+        uint64_t allocated = timing_now_ticks();
+        for (size_t i = 0; i < batch; i++) {
+            failed |= (allocator_peek(p_allocator, &p_block, &block_size) != ALLOCATOR_SUCCESS);
+            sink = p_block[0];
+        }
+        uint64_t peeked = timing_now_ticks();
+        size_t frees = 0;
+        while (used > target) {
+            failed |= (allocator_free(p_allocator) != ALLOCATOR_SUCCESS);
+            used -= p_sizes[next_free++ & (SIZE_TABLE_LENGTH - 1)];
+            frees++;
+        }
+        uint64_t freed = timing_now_ticks();
+
+        ticks[ALLOCATOR_OP_ALLOC] += allocated - start;
+        ticks[ALLOCATOR_OP_PEEK] += peeked - allocated;
+        ticks[ALLOCATOR_OP_FREE] += freed - peeked;
+        counts[ALLOCATOR_OP_ALLOC] += batch;
+        counts[ALLOCATOR_OP_PEEK] += batch;
+        counts[ALLOCATOR_OP_FREE] += frees;
+    }
+    allocator_uninit(p_allocator);
+
+    for (size_t op = 0; op < ALLOCATOR_OP_COUNT; op++) {
+        p_ns_per_op[op] = to_ns_per_op(ticks[op], counts[op]);
+    }
+    return (failed == false);
+}
+
+// Same as run_allocator() with malloc and free, the blocks are kept in a FIFO
+static bool run_malloc(size_t capacity, unsigned int fill, const uint8_t* p_sizes, uint64_t ops, double* p_ns_per_op) {
+    size_t target = (capacity / 100) * fill;
+    size_t batch = get_batch_size(capacity, target);
+
+    // At most target + batch * MAX_BLOCK_SIZE bytes are live, and every run of SIZE_TABLE_LENGTH blocks
+    // takes as many bytes as the whole table
+    size_t table_bytes = 0;
+    for (size_t i = 0; i < SIZE_TABLE_LENGTH; i++) {
+        table_bytes += p_sizes[i];
+    }
+    size_t live_length = (((target + (batch * MAX_BLOCK_SIZE)) / table_bytes) + 2) * SIZE_TABLE_LENGTH;
+    uint8_t** pp_live = (uint8_t**)malloc(live_length * sizeof(uint8_t*));
+    if (pp_live == NULL) {
+        return false;
+    }
+
+    size_t used = 0;
+    size_t next_alloc = 0;
+    size_t next_free = 0;
+    size_t head = 0;
+    size_t tail = 0;
+    bool failed = false;
+
+    while ((used < target) && (failed == false)) {
+        size_t block_size = p_sizes[next_alloc++ & (SIZE_TABLE_LENGTH - 1)];
+        pp_live[head] = (uint8_t*)malloc(block_size);
+        failed = (pp_live[head] == NULL);
+        head = (head + 1 == live_length) ? 0 : (head + 1);
+        used += block_size;
+    }
+
+    uint64_t ticks[ALLOCATOR_OP_COUNT] = { 0 };
+    uint64_t counts[ALLOCATOR_OP_COUNT] = { 0 };
+
+    while ((counts[ALLOCATOR_OP_ALLOC] < ops) && (failed == false)) {
+        uint64_t start = timing_now_ticks();
+        for (size_t i = 0; i < batch; i++) {
+            size_t block_size = p_sizes[next_alloc++ & (SIZE_TABLE_LENGTH - 1)];
+            uint8_t* p_block = (uint8_t*)malloc(block_size);
+            if (p_block == NULL) {
+                abort();
+            }
+            p_block[0] = (uint8_t)i;
+            pp_live[head] = p_block;
+            head = (head + 1 == live_length) ? 0 : (head + 1);
+            used += block_size;
+        }
+        uint64_t allocated = timing_now_ticks();
+        size_t frees = 0;
+        while (used > target) {
+            free(pp_live[tail]);
+            tail = (tail + 1 == live_length) ? 0 : (tail + 1);
+            used -= p_sizes[next_free++ & (SIZE_TABLE_LENGTH - 1)];
+            frees++;
+        }
+        uint64_t freed = timing_now_ticks();
+
+        ticks[ALLOCATOR_OP_ALLOC] += allocated - start;
+        ticks[ALLOCATOR_OP_FREE] += freed - allocated;
+        counts[ALLOCATOR_OP_ALLOC] += batch;
+        counts[ALLOCATOR_OP_FREE] += frees;
+    }
+
+    while (tail != head) {
+        free(pp_live[tail]);
+        tail = (tail + 1 == live_length) ? 0 : (tail + 1);
+    }
+    free(pp_live);
+
+    for (size_t op = 0; op < ALLOCATOR_OP_COUNT; op++) {
+        p_ns_per_op[op] = to_ns_per_op(ticks[op], counts[op]);
+    }
+    return (failed == false);
+}
+
+static void report_case(bench_report_t* p_report, const char* p_implementation, const char* p_op, const char* p_case, double ns_per_op) {
+    char name[REPORT_NAME_LENGTH];
+    const double values[] = { ns_per_op, (ns_per_op > 0.0) ? (1e9 / ns_per_op) : 0.0 };
+
+    snprintf(name, sizeof(name), "%s/%s/%s", p_implementation, p_op, p_case);
+    bench_report_add(p_report, name, values);
+}
+
+static void print_usage(const char* p_program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --format csv|json    format of the results, csv by default\n"
+            "  --capacity SIZE      buffer size to measure, e.g. 64K or 2G, can be repeated\n"
+            "  --ops N              operations measured per case, %d by default\n"
+            "  --filter TEXT        only run the cases whose distribution/capacity/fill contains TEXT\n"
+            "  --output FILE        file the results are written to, stdout by default\n"
+            "  --keep-log-levels    keep the runtime log levels, which let the debug logging of the allocator through\n",
+            p_program, DEFAULT_OPS);
+}
+
+static bool parse_options(int argc, char* argv[], options_t* p_options) {
+    static const struct option long_options[] = {
+        { "format", required_argument, NULL, 'f' },
+        { "capacity", required_argument, NULL, 'c' },
+        { "ops", required_argument, NULL, 'n' },
+        { "filter", required_argument, NULL, 'F' },
+        { "output", required_argument, NULL, 'o' },
+        { "keep-log-levels", no_argument, NULL, 'k' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 },
+    };
+    int option;
+
+    p_options->capacity_count = 0;
+    p_options->ops = DEFAULT_OPS;
+    p_options->p_filter = NULL;
+    p_options->format = BENCH_FORMAT_CSV;
+    p_options->p_output = NULL;
+    p_options->keep_log_levels = false;
+
+    while ((option = getopt_long(argc, argv, "f:c:n:F:o:kh", long_options, NULL)) != -1) {
+        switch (option) {
+            case 'f':
+                if (bench_parse_format(optarg, &p_options->format) == false) {
+                    return false;
+                }
+                break;
+            case 'c':
+                if ((p_options->capacity_count == MAX_CAPACITIES) ||
+                    (bench_parse_size(optarg, &p_options->capacities[p_options->capacity_count]) == false)) {
+                    return false;
+                }
+                p_options->capacity_count++;
+                break;
+            case 'n':
+                p_options->ops = strtoull(optarg, NULL, 10);
+                if (p_options->ops == 0) {
+                    return false;
+                }
+                break;
+            case 'F':
+                p_options->p_filter = optarg;
+                break;
+            case 'o':
+                p_options->p_output = optarg;
+                break;
+            case 'k':
+                p_options->keep_log_levels = true;
+                break;
+            default:
+                return false;
+        }
+    }
+
+    if (p_options->capacity_count == 0) {
+        p_options->capacity_count = sizeof(default_capacities) / sizeof(default_capacities[0]);
+        memcpy(p_options->capacities, default_capacities, sizeof(default_capacities));
+    }
+    return (optind == argc);
+}
+
+// Measures the single-threaded cost of every allocator operation, and of malloc and free for the same block sizes.
+// Usage: bench_allocator [--format csv|json] [--capacity SIZE]... [--ops N] [--filter TEXT] [--output FILE] [--keep-log-levels]
+int main(int argc, char* argv[]) {
+    options_t options;
+    bench_report_t report;
+    uint8_t sizes[SIZE_TABLE_LENGTH];
+    int result = 0;
+
+    if (parse_options(argc, argv, &options) == false) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    // The allocator logs every operation at debug level, which is not what is being measured
+    // unless the cost of that logging is what is being checked
+    if ((options.keep_log_levels == false) && (getenv("LOG_LEVELS") == NULL)) {
+        log_set_level(LOG_GROUP_ID_ALLOCATOR, LOG_LEVEL_ERROR);
+    }
+
+    FILE* p_output = (options.p_output != NULL) ? fopen(options.p_output, "w") : stdout;
+    if (p_output == NULL) {
+        fprintf(stderr, "Couldn't open %s\n", options.p_output);
+        return 2;
+    }
+    timing_calibrate();
+
+    bench_report_begin(&report, p_output, options.format, "bench_allocator", metrics, sizeof(metrics) / sizeof(metrics[0]));
+    for (size_t distribution = 0; distribution < DISTRIBUTION_COUNT; distribution++) {
+        fill_sizes(sizes, (distribution_t)distribution);
+
+        for (size_t c = 0; c < options.capacity_count; c++) {
+            char capacity[32];
+            bench_format_size(options.capacities[c], capacity, sizeof(capacity));
+
+            for (size_t f = 0; f < sizeof(fill_levels) / sizeof(fill_levels[0]); f++) {
+                char case_name[CASE_NAME_LENGTH];
+                double ns_per_op[ALLOCATOR_OP_COUNT];
+
+                snprintf(case_name, sizeof(case_name), "%s/%s/fill%u", distribution_names[distribution], capacity, fill_levels[f]);
+                if ((options.p_filter != NULL) && (strstr(case_name, options.p_filter) == NULL)) {
+                    continue;
+                }
+
+                if (run_allocator(options.capacities[c], fill_levels[f], sizes, options.ops, ns_per_op) == true) {
+                    report_case(&report, "allocator", "alloc", case_name, ns_per_op[ALLOCATOR_OP_ALLOC]);
+                    report_case(&report, "allocator", "peek", case_name, ns_per_op[ALLOCATOR_OP_PEEK]);
+                    report_case(&report, "allocator", "free", case_name, ns_per_op[ALLOCATOR_OP_FREE]);
+                } else {
+                    fprintf(stderr, "allocator/%s failed\n", case_name);
+                    result = 1;
+                }
+
+                if (run_malloc(options.capacities[c], fill_levels[f], sizes, options.ops, ns_per_op) == true) {
+                    report_case(&report, "malloc", "alloc", case_name, ns_per_op[ALLOCATOR_OP_ALLOC]);
+                    report_case(&report, "malloc", "free", case_name, ns_per_op[ALLOCATOR_OP_FREE]);
+                } else {
+                    fprintf(stderr, "malloc/%s failed\n", case_name);
+                    result = 1;
+                }
+            }
+        }
+    }
+    bench_report_end(&report);
+    if (p_output != stdout) {
+        fclose(p_output);
+    }
+    return result;
+}
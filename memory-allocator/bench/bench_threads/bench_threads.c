@@ -0,0 +1,529 @@
+#define _GNU_SOURCE
+
+#include "allocator.h"
+#include "bench_common.h"
+#include "timing.h"
+
+#include "getopt.h"
+#include "pthread.h"
+#include "sched.h"
+#include "stdlib.h"
+#include "string.h"
+#include "unistd.h"
+
+#define __FILENAME__     "bench_threads.c"
+#define LOG_MODULE_GROUP LOG_GROUP_DEFAULT
+#define LOG_LEVEL        LOG_LEVEL_ERROR
+#include "logging.h"
+
+#define MAX_THREADS        64
+#define DEFAULT_MESSAGES   100000
+#define DEFAULT_CAPACITY   65536
+#define DEFAULT_BLOCK_SIZE 64
+#define CASE_NAME_LENGTH   128
+
+typedef enum {
+    TOPOLOGY_MUTEX,  // Any number of producers and consumers, every call to the allocator is made under one mutex
+    TOPOLOGY_SPSC,   // One producer and one consumer without locks, waiting with the *_wait functions
+} topology_mode_t;
+
+typedef struct {
+    topology_mode_t mode;
+    allocator_wait_strategy_t wait_strategy;  // Only used by TOPOLOGY_SPSC
+    size_t producers;
+    size_t consumers;
+} topology_t;
+
+// Written at the start of every block. allocator_alloc() publishes a block before the producer fills it,
+// so without a lock the consumer waits until the sequence number of the message it expects shows up
+typedef struct {
+    uint64_t sequence;
+    uint64_t ticks;  // When the producer started to enqueue the message
+} message_t;
+
+typedef struct {
+    allocator_t* p_allocator;
+    pthread_mutex_t lock;
+    pthread_barrier_t start;
+    const topology_t* p_topology;
+    uint64_t messages;  // Sent by every producer
+    size_t block_size;
+    uint64_t consumed;  // Messages received by all the consumers, only used by TOPOLOGY_MUTEX
+} shared_t;
+
+typedef struct {
+    shared_t* p_shared;
+    pthread_t thread;
+    int cpu;  // -1 to leave the thread unpinned
+    allocator_latency_histogram_t latency;
+    bool failed;
+} worker_t;
+
+typedef struct {
+    topology_t topology;
+    bool custom_topology;
+    uint64_t messages;
+    size_t block_size;
+    size_t capacity;
+    int cpus[MAX_THREADS];
+    size_t cpu_count;
+    bench_format_t format;
+    const char* p_output;  // NULL for stdout
+    bool keep_log_levels;
+} options_t;
+
+static const char* const wait_names[] = { "spin", "yield", "futex" };
+
+static const char* const metrics[] = { "msgs_per_sec", "p50_ns", "p99_ns", "p99_9_ns", "max_ns" };
+
+// Run when no topology is given on the command line, busy spinning is left out if there aren't enough cores
+static const topology_t default_topologies[] = {
+    { TOPOLOGY_SPSC, ALLOCATOR_WAIT_BUSY_SPIN, 1, 1 },
+    { TOPOLOGY_SPSC, ALLOCATOR_WAIT_SPIN_YIELD, 1, 1 },
+    { TOPOLOGY_SPSC, ALLOCATOR_WAIT_FUTEX, 1, 1 },
+    { TOPOLOGY_MUTEX, ALLOCATOR_WAIT_SPIN_YIELD, 1, 1 },
+    { TOPOLOGY_MUTEX, ALLOCATOR_WAIT_SPIN_YIELD, 2, 2 },
+    { TOPOLOGY_MUTEX, ALLOCATOR_WAIT_SPIN_YIELD, 4, 4 },
+};
+
+static void pin_thread(int cpu) {
+    if (cpu < 0) {
+        return;
+    }
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+}
+
+static void write_message(uint8_t* p_block, uint64_t sequence, uint64_t ticks) {
+    message_t* p_message = (message_t*)p_block;
+
+    p_message->ticks = ticks;
+    __atomic_store_n(&p_message->sequence, sequence, __ATOMIC_RELEASE);
+}
+
+static void* run_mutex_producer(void* p_argument) {
+    worker_t* p_worker = (worker_t*)p_argument;
+    shared_t* p_shared = p_worker->p_shared;
+    uint8_t* p_block;
+
+    pin_thread(p_worker->cpu);
+    pthread_barrier_wait(&p_shared->start);
+
+    for (uint64_t i = 0; i < p_shared->messages; i++) {
+        uint64_t start = timing_now_ticks();
+        while (true) {
+            pthread_mutex_lock(&p_shared->lock);
+            allocator_error_t result = allocator_alloc(p_shared->p_allocator, p_shared->block_size, &p_block);
+            if (result == ALLOCATOR_SUCCESS) {
+                write_message(p_block, i + 1, start);
+            }
+            pthread_mutex_unlock(&p_shared->lock);
+
+            if (result == ALLOCATOR_SUCCESS) {
+                break;
+            }
+            if (result != ALLOCATOR_ERROR_OUT_OF_MEMORY) {
+                p_worker->failed = true;
+                return NULL;
+            }
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void* run_mutex_consumer(void* p_argument) {
+    worker_t* p_worker = (worker_t*)p_argument;
+    shared_t* p_shared = p_worker->p_shared;
+    uint64_t total = p_shared->messages * p_shared->p_topology->producers;
+    uint8_t* p_block;
+    size_t block_size;
+
+    pin_thread(p_worker->cpu);
+    pthread_barrier_wait(&p_shared->start);
+
+    while (true) {
+        message_t message;
+        uint64_t now = 0;
+
+        pthread_mutex_lock(&p_shared->lock);
+        bool received = (allocator_peek(p_shared->p_allocator, &p_block, &block_size) == ALLOCATOR_SUCCESS);
+        if (received == true) {
+            now = timing_now_ticks();
+            memcpy(&message, p_block, sizeof(message));
+            allocator_free(p_shared->p_allocator);
+            p_shared->consumed++;
+        }
+        bool done = (p_shared->consumed == total);
+        pthread_mutex_unlock(&p_shared->lock);
+
+        if (received == true) {
+            allocator_latency_histogram_record(&p_worker->latency, now - message.ticks);
+        } else if (done == true) {
+            break;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void* run_spsc_producer(void* p_argument) {
+    worker_t* p_worker = (worker_t*)p_argument;
+    shared_t* p_shared = p_worker->p_shared;
+    uint8_t* p_block;
+
+    pin_thread(p_worker->cpu);
+    pthread_barrier_wait(&p_shared->start);
+
+    for (uint64_t i = 0; i < p_shared->messages; i++) {
+        uint64_t start = timing_now_ticks();
+        if (allocator_alloc_wait(p_shared->p_allocator, p_shared->block_size, &p_block, ALLOCATOR_WAIT_FOREVER) != ALLOCATOR_SUCCESS) {
+            p_worker->failed = true;
+            return NULL;
+        }
+        write_message(p_block, i + 1, start);
+    }
+    return NULL;
+}
+
+static void* run_spsc_consumer(void* p_argument) {
+    worker_t* p_worker = (worker_t*)p_argument;
+    shared_t* p_shared = p_worker->p_shared;
+    uint8_t* p_block;
+    size_t block_size;
+
+    pin_thread(p_worker->cpu);
+    pthread_barrier_wait(&p_shared->start);
+
+    for (uint64_t i = 0; i < p_shared->messages; i++) {
+        if (allocator_peek_wait(p_shared->p_allocator, &p_block, &block_size, ALLOCATOR_WAIT_FOREVER) != ALLOCATOR_SUCCESS) {
+            p_worker->failed = true;
+            return NULL;
+        }
+
+        message_t* p_message = (message_t*)p_block;
+        while (__atomic_load_n(&p_message->sequence, __ATOMIC_ACQUIRE) != i + 1) {
+            // The producer is between allocating the block and filling it
+            sched_yield();
+        }
+        uint64_t now = timing_now_ticks();
+        allocator_latency_histogram_record(&p_worker->latency, now - p_message->ticks);
+        allocator_free(p_shared->p_allocator);
+    }
+    return NULL;
+}
+
+static void merge_histogram(allocator_latency_histogram_t* p_total, const allocator_latency_histogram_t* p_histogram) {
+    for (size_t i = 0; i < ALLOCATOR_LATENCY_BUCKETS; i++) {
+        p_total->counts[i] += p_histogram->counts[i];
+    }
+    p_total->total += p_histogram->total;
+    if (p_histogram->max > p_total->max) {
+        p_total->max = p_histogram->max;
+    }
+}
+
+// Runs a topology and fills in the metrics, in the order of the metrics array
+static bool run_topology(const topology_t* p_topology, const options_t* p_options, double* p_values) {
+    size_t thread_count = p_topology->producers + p_topology->consumers;
+    long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    shared_t shared;
+
+    // The buffer wraps at buffer_size + 1. Keeping that a multiple of the block size, itself a multiple of 8,
+    // keeps every message_t 8 byte aligned, so its sequence number is never read across two cache lines
+    size_t buffer_size = ((p_options->capacity / p_options->block_size) * p_options->block_size) - 1;
+    shared.p_allocator = allocator_init(buffer_size, (uint8_t)p_options->block_size, (uint8_t)p_options->block_size);
+    if (shared.p_allocator == NULL) {
+        return false;
+    }
+    allocator_set_wait_strategy(shared.p_allocator, p_topology->wait_strategy);
+    pthread_mutex_init(&shared.lock, NULL);
+    pthread_barrier_init(&shared.start, NULL, (unsigned int)thread_count + 1);
+    shared.p_topology = p_topology;
+    shared.messages = p_options->messages;
+    shared.block_size = p_options->block_size;
+    shared.consumed = 0;
+
+    worker_t* p_workers = (worker_t*)calloc(thread_count, sizeof(worker_t));
+    if (p_workers == NULL) {
+        pthread_barrier_destroy(&shared.start);
+        pthread_mutex_destroy(&shared.lock);
+        allocator_uninit(shared.p_allocator);
+        return false;
+    }
+
+    for (size_t i = 0; i < thread_count; i++) {
+        bool producer = (i < p_topology->producers);
+        void* (*p_run)(void*);
+        if (p_topology->mode == TOPOLOGY_MUTEX) {
+            p_run = (producer == true) ? run_mutex_producer : run_mutex_consumer;
+        } else {
+            p_run = (producer == true) ? run_spsc_producer : run_spsc_consumer;
+        }
+
+        // Threads get a core each if there are enough of them, or the cores given on the command line
+        p_workers[i].p_shared = &shared;
+        if (p_options->cpu_count > 0) {
+            p_workers[i].cpu = p_options->cpus[i % p_options->cpu_count];
+        } else {
+            p_workers[i].cpu = ((long)thread_count <= online_cpus) ? (int)i : -1;
+        }
+        allocator_latency_histogram_reset(&p_workers[i].latency);
+        pthread_create(&p_workers[i].thread, NULL, p_run, &p_workers[i]);
+    }
+
+    pthread_barrier_wait(&shared.start);
+    uint64_t start = timing_now_ticks();
+
+    allocator_latency_histogram_t latency;
+    bool failed = false;
+    allocator_latency_histogram_reset(&latency);
+    for (size_t i = 0; i < thread_count; i++) {
+        pthread_join(p_workers[i].thread, NULL);
+        merge_histogram(&latency, &p_workers[i].latency);
+        failed |= p_workers[i].failed;
+    }
+    uint64_t elapsed_ns = timing_ticks_to_ns(timing_now_ticks() - start);
+
+    free(p_workers);
+    pthread_barrier_destroy(&shared.start);
+    pthread_mutex_destroy(&shared.lock);
+    allocator_uninit(shared.p_allocator);
+
+    p_values[0] = (double)latency.total * 1e9 / (double)((elapsed_ns > 0) ? elapsed_ns : 1);
+    p_values[1] = (double)timing_ticks_to_ns(allocator_latency_histogram_percentile(&latency, 50.0));
+    p_values[2] = (double)timing_ticks_to_ns(allocator_latency_histogram_percentile(&latency, 99.0));
+    p_values[3] = (double)timing_ticks_to_ns(allocator_latency_histogram_percentile(&latency, 99.9));
+    p_values[4] = (double)timing_ticks_to_ns(latency.max);
+    return (failed == false);
+}
+
+static void get_case_name(const topology_t* p_topology, const options_t* p_options, char* p_name, size_t name_size) {
+    char capacity[32];
+    char mode[16];
+
+    bench_format_size(p_options->capacity, capacity, sizeof(capacity));
+    if (p_topology->mode == TOPOLOGY_MUTEX) {
+        snprintf(mode, sizeof(mode), "mutex");
+    } else {
+        snprintf(mode, sizeof(mode), "spsc-%s", wait_names[p_topology->wait_strategy]);
+    }
+    snprintf(p_name, name_size, "%s/%zup%zuc/%zuB/%s", mode, p_topology->producers, p_topology->consumers, p_options->block_size, capacity);
+}
+
+static bool parse_cpus(const char* p_text, options_t* p_options) {
+    p_options->cpu_count = 0;
+
+    while (*p_text != '\0') {
+        char* p_end;
+        long cpu = strtol(p_text, &p_end, 10);
+        if ((p_end == p_text) || (cpu < 0) || (p_options->cpu_count == MAX_THREADS)) {
+            return false;
+        }
+        p_options->cpus[p_options->cpu_count++] = (int)cpu;
+
+        p_text = p_end;
+        if (*p_text == ',') {
+            p_text++;
+        } else if (*p_text != '\0') {
+            return false;
+        }
+    }
+    return (p_options->cpu_count > 0);
+}
+
+static bool parse_wait_strategy(const char* p_text, allocator_wait_strategy_t* p_strategy) {
+    for (size_t i = 0; i < sizeof(wait_names) / sizeof(wait_names[0]); i++) {
+        if (strcmp(p_text, wait_names[i]) == 0) {
+            *p_strategy = (allocator_wait_strategy_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void print_usage(const char* p_program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --mode mutex|spsc    run a single topology instead of the default set\n"
+            "  --producers N        producer threads of the topology, 1 by default\n"
+            "  --consumers N        consumer threads of the topology, 1 by default\n"
+            "  --wait spin|yield|futex\n"
+            "                       wait strategy of spsc topologies, yield by default\n"
+            "  --messages N         messages sent by every producer, %d by default\n"
+            "  --block-size N       size of the messages, a multiple of 8 between 16 and 248, %d by default\n"
+            "  --capacity SIZE      buffer size, e.g. 64K, %d by default\n"
+            "  --cpus LIST          cores the threads are pinned to in turn, producers first, e.g. 0,2,4,6\n"
+            "  --format csv|json    format of the results, csv by default\n"
+            "  --output FILE        file the results are written to, stdout by default\n"
+            "  --keep-log-levels    keep the runtime log levels, which let the debug logging of the allocator through\n",
+            p_program, DEFAULT_MESSAGES, DEFAULT_BLOCK_SIZE, DEFAULT_CAPACITY);
+}
+
+static bool parse_options(int argc, char* argv[], options_t* p_options) {
+    static const struct option long_options[] = {
+        { "mode", required_argument, NULL, 'm' },
+        { "producers", required_argument, NULL, 'p' },
+        { "consumers", required_argument, NULL, 'c' },
+        { "wait", required_argument, NULL, 'w' },
+        { "messages", required_argument, NULL, 'n' },
+        { "block-size", required_argument, NULL, 'b' },
+        { "capacity", required_argument, NULL, 's' },
+        { "cpus", required_argument, NULL, 'C' },
+        { "format", required_argument, NULL, 'f' },
+        { "output", required_argument, NULL, 'o' },
+        { "keep-log-levels", no_argument, NULL, 'k' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 },
+    };
+    int option;
+
+    p_options->topology.mode = TOPOLOGY_MUTEX;
+    p_options->topology.wait_strategy = ALLOCATOR_WAIT_SPIN_YIELD;
+    p_options->topology.producers = 1;
+    p_options->topology.consumers = 1;
+    p_options->custom_topology = false;
+    p_options->messages = DEFAULT_MESSAGES;
+    p_options->block_size = DEFAULT_BLOCK_SIZE;
+    p_options->capacity = DEFAULT_CAPACITY;
+    p_options->cpu_count = 0;
+    p_options->format = BENCH_FORMAT_CSV;
+    p_options->p_output = NULL;
+    p_options->keep_log_levels = false;
+
+    while ((option = getopt_long(argc, argv, "m:p:c:w:n:b:s:C:f:o:kh", long_options, NULL)) != -1) {
+        switch (option) {
+            case 'm':
+                if (strcmp(optarg, "mutex") == 0) {
+                    p_options->topology.mode = TOPOLOGY_MUTEX;
+                } else if (strcmp(optarg, "spsc") == 0) {
+                    p_options->topology.mode = TOPOLOGY_SPSC;
+                } else {
+                    return false;
+                }
+                p_options->custom_topology = true;
+                break;
+            case 'p':
+                p_options->topology.producers = strtoul(optarg, NULL, 10);
+                p_options->custom_topology = true;
+                break;
+            case 'c':
+                p_options->topology.consumers = strtoul(optarg, NULL, 10);
+                p_options->custom_topology = true;
+                break;
+            case 'w':
+                if (parse_wait_strategy(optarg, &p_options->topology.wait_strategy) == false) {
+                    return false;
+                }
+                break;
+            case 'n':
+                p_options->messages = strtoull(optarg, NULL, 10);
+                break;
+            case 'b':
+                p_options->block_size = strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                if (bench_parse_size(optarg, &p_options->capacity) == false) {
+                    return false;
+                }
+                break;
+            case 'C':
+                if (parse_cpus(optarg, p_options) == false) {
+                    return false;
+                }
+                break;
+            case 'f':
+                if (bench_parse_format(optarg, &p_options->format) == false) {
+                    return false;
+                }
+                break;
+            case 'o':
+                p_options->p_output = optarg;
+                break;
+            case 'k':
+                p_options->keep_log_levels = true;
+                break;
+            default:
+                return false;
+        }
+    }
+
+    const topology_t* p_topology = &p_options->topology;
+    if ((p_topology->producers == 0) || (p_topology->consumers == 0) ||
+        (p_topology->producers + p_topology->consumers > MAX_THREADS)) {
+        return false;
+    }
+    // Without locks the allocator only supports one producer and one consumer
+    if ((p_topology->mode == TOPOLOGY_SPSC) && ((p_topology->producers != 1) || (p_topology->consumers != 1))) {
+        return false;
+    }
+    if ((p_options->block_size < 16) || (p_options->block_size > 248) || ((p_options->block_size % 8) != 0) ||
+        (p_options->capacity < 2 * p_options->block_size) || (p_options->messages == 0)) {
+        return false;
+    }
+    return (optind == argc);
+}
+
+// Measures the throughput of producer and consumer threads sharing an allocator,
+// and the latency from the moment a message is enqueued to the moment it is dequeued.
+// Usage: bench_threads [--mode mutex|spsc] [--producers N] [--consumers N] [--wait spin|yield|futex] [...]
+int main(int argc, char* argv[]) {
+    options_t options;
+    bench_report_t report;
+    int result = 0;
+
+    if (parse_options(argc, argv, &options) == false) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    // The allocator logs every operation at debug level, which is not what is being measured
+    // unless the cost of that logging is what is being checked
+    if ((options.keep_log_levels == false) && (getenv("LOG_LEVELS") == NULL)) {
+        log_set_level(LOG_GROUP_ID_ALLOCATOR, LOG_LEVEL_ERROR);
+    }
+
+    FILE* p_output = (options.p_output != NULL) ? fopen(options.p_output, "w") : stdout;
+    if (p_output == NULL) {
+        fprintf(stderr, "Couldn't open %s\n", options.p_output);
+        return 2;
+    }
+    timing_calibrate();
+
+    const topology_t* p_topologies = default_topologies;
+    size_t topology_count = sizeof(default_topologies) / sizeof(default_topologies[0]);
+    if (options.custom_topology == true) {
+        p_topologies = &options.topology;
+        topology_count = 1;
+    }
+
+    bench_report_begin(&report, p_output, options.format, "bench_threads", metrics, sizeof(metrics) / sizeof(metrics[0]));
+    for (size_t i = 0; i < topology_count; i++) {
+        const topology_t* p_topology = &p_topologies[i];
+        char name[CASE_NAME_LENGTH];
+        double values[sizeof(metrics) / sizeof(metrics[0])];
+
+        // Two spinning threads on one core only make progress when the scheduler preempts them
+        if ((options.custom_topology == false) && (p_topology->wait_strategy == ALLOCATOR_WAIT_BUSY_SPIN) &&
+            (sysconf(_SC_NPROCESSORS_ONLN) < 2)) {
+            continue;
+        }
+
+        get_case_name(p_topology, &options, name, sizeof(name));
+        if (run_topology(p_topology, &options, values) == true) {
+            bench_report_add(&report, name, values);
+        } else {
+            fprintf(stderr, "%s failed\n", name);
+            result = 1;
+        }
+    }
+    bench_report_end(&report);
+    if (p_output != stdout) {
+        fclose(p_output);
+    }
+    return result;
+}
@@ -0,0 +1,202 @@
+#include "bench_common.h"
+
+#include "stdlib.h"
+#include "string.h"
+
+static void write_csv_field(FILE* p_file, const char* p_text) {
+    // Quote the field only if it needs it
+    if (strpbrk(p_text, ",\"\n") == NULL) {
+        fputs(p_text, p_file);
+        return;
+    }
+
+    fputc('"', p_file);
+    for (; *p_text != '\0'; p_text++) {
+        if (*p_text == '"') {
+            fputc('"', p_file);
+        }
+        fputc(*p_text, p_file);
+    }
+    fputc('"', p_file);
+}
+
+static void write_json_string(FILE* p_file, const char* p_text) {
+    fputc('"', p_file);
+    for (; *p_text != '\0'; p_text++) {
+        if ((*p_text == '"') || (*p_text == '\\')) {
+            fputc('\\', p_file);
+        }
+        fputc(*p_text, p_file);
+    }
+    fputc('"', p_file);
+}
+
+/**
+ * @brief       Starts a report, writing the CSV header or opening the JSON document.
+ *
+ * @param[out] p_report         pointer to report
+ * @param[in]  p_file           file the report is written to
+ * @param[in]  format           format of the report
+ * @param[in]  p_benchmark      name of the benchmark, only written to JSON reports
+ * @param[in]  pp_metrics       names of the metrics of every row, must outlive the report
+ * @param[in]  metric_count     number of metrics
+ */
+void bench_report_begin(bench_report_t* p_report, FILE* p_file, bench_format_t format, const char* p_benchmark, const char* const* pp_metrics, size_t metric_count) {
+    p_report->p_file = p_file;
+    p_report->format = format;
+    p_report->pp_metrics = pp_metrics;
+    p_report->metric_count = metric_count;
+    p_report->rows = 0;
+
+    if (format == BENCH_FORMAT_CSV) {
+        fputs("name", p_file);
+        for (size_t i = 0; i < metric_count; i++) {
+            fputc(',', p_file);
+            write_csv_field(p_file, pp_metrics[i]);
+        }
+        fputc('\n', p_file);
+    } else {
+        fputs("{\n  \"benchmark\": ", p_file);
+        write_json_string(p_file, p_benchmark);
+        fputs(",\n  \"results\": [", p_file);
+    }
+    fflush(p_file);
+}
+
+/**
+ * @brief       Writes the results of a benchmark case.
+ *
+ * @param[in] p_report          pointer to report
+ * @param[in] p_name            name of the case, unique within the benchmark so results can be compared across runs
+ * @param[in] p_values          values of the metrics, in the order given to bench_report_begin()
+ */
+void bench_report_add(bench_report_t* p_report, const char* p_name, const double* p_values) {
+    FILE* p_file = p_report->p_file;
+
+    if (p_report->format == BENCH_FORMAT_CSV) {
+        write_csv_field(p_file, p_name);
+        for (size_t i = 0; i < p_report->metric_count; i++) {
+            fprintf(p_file, ",%.6g", p_values[i]);
+        }
+        fputc('\n', p_file);
+    } else {
+        fputs((p_report->rows > 0) ? ",\n    {\"name\": " : "\n    {\"name\": ", p_file);
+        write_json_string(p_file, p_name);
+        for (size_t i = 0; i < p_report->metric_count; i++) {
+            fputs(", ", p_file);
+            write_json_string(p_file, p_report->pp_metrics[i]);
+            fprintf(p_file, ": %.6g", p_values[i]);
+        }
+        fputc('}', p_file);
+    }
+    p_report->rows++;
+
+    // Long runs show their progress
+    fflush(p_file);
+}
+
+/**
+ * @brief       Finishes a report, closing the JSON document.
+ *
+ * @param[in] p_report          pointer to report
+ */
+void bench_report_end(bench_report_t* p_report) {
+    if (p_report->format == BENCH_FORMAT_JSON) {
+        fputs((p_report->rows > 0) ? "\n  ]\n}\n" : "]\n}\n", p_report->p_file);
+    }
+    fflush(p_report->p_file);
+}
+
+/**
+ * @brief       Parses the name of a report format, "csv" or "json".
+ *
+ * @param[in]  p_text           pointer to text
+ * @param[out] p_format         pointer to format
+ *
+ * @return bool                 true if the name was valid
+ */
+bool bench_parse_format(const char* p_text, bench_format_t* p_format) {
+    if (strcmp(p_text, "csv") == 0) {
+        *p_format = BENCH_FORMAT_CSV;
+    } else if (strcmp(p_text, "json") == 0) {
+        *p_format = BENCH_FORMAT_JSON;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief       Parses a size in bytes, optionally followed by K, M or G for powers of 1024.
+ *
+ * @param[in]  p_text           pointer to text
+ * @param[out] p_size           pointer to size
+ *
+ * @return bool                 true if the size was valid and not 0
+ */
+bool bench_parse_size(const char* p_text, size_t* p_size) {
+    char* p_end;
+    unsigned long long size = strtoull(p_text, &p_end, 10);
+    unsigned int shift = 0;
+
+    if ((p_end == p_text) || (size == 0)) {
+        return false;
+    }
+    switch (*p_end) {
+        case 'K':
+        case 'k':
+            shift = 10;
+            p_end++;
+            break;
+        case 'M':
+        case 'm':
+            shift = 20;
+            p_end++;
+            break;
+        case 'G':
+        case 'g':
+            shift = 30;
+            p_end++;
+            break;
+        default:
+            break;
+    }
+    if ((*p_end != '\0') || (size > (SIZE_MAX >> shift))) {
+        return false;
+    }
+
+    *p_size = (size_t)size << shift;
+    return true;
+}
+
+/**
+ * @brief       Formats a size in bytes with the largest binary unit that divides it.
+ *
+ * @param[in]  size             size in bytes
+ * @param[out] p_text           pointer to text buffer
+ * @param[in]  text_size        size of the text buffer
+ */
+void bench_format_size(size_t size, char* p_text, size_t text_size) {
+    static const char* units[] = { "B", "KiB", "MiB", "GiB" };
+    size_t unit = 0;
+
+    while ((unit + 1 < sizeof(units) / sizeof(units[0])) && (size >= 1024) && ((size % 1024) == 0)) {
+        size /= 1024;
+        unit++;
+    }
+    snprintf(p_text, text_size, "%zu%s", size, units[unit]);
+}
+
+/**
+ * @brief       Returns the next number of a fast deterministic generator, xorshift64*.
+ *
+ * @param[in] p_state           pointer to the state of the generator, any value but 0
+ *
+ * @return uint64_t             pseudo-random number
+ */
+uint64_t bench_random(uint64_t* p_state) {
+    *p_state ^= *p_state >> 12;
+    *p_state ^= *p_state << 25;
+    *p_state ^= *p_state >> 27;
+    return *p_state * 0x2545F4914F6CDD1Dull;
+}
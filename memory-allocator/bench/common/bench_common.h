@@ -0,0 +1,100 @@
+#ifndef BENCH_COMMON_H_
+#define BENCH_COMMON_H_
+
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+#include "stdio.h"
+
+typedef enum {
+    BENCH_FORMAT_CSV,
+    BENCH_FORMAT_JSON,
+} bench_format_t;
+
+// Results are written as one row per benchmark case, with the same metrics on every row
+typedef struct {
+    FILE* p_file;
+    bench_format_t format;
+    const char* const* pp_metrics;
+    size_t metric_count;
+    size_t rows;
+} bench_report_t;
+
+/**
+ * @brief       Starts a report, writing the CSV header or opening the JSON document.
+ *
+ * @param[out] p_report         pointer to report
+ * @param[in]  p_file           file the report is written to
+ * @param[in]  format           format of the report
+ * @param[in]  p_benchmark      name of the benchmark, only written to JSON reports
+ * @param[in]  pp_metrics       names of the metrics of every row, must outlive the report
+ * @param[in]  metric_count     number of metrics
+ */
+void bench_report_begin(bench_report_t* p_report,
+                        FILE* p_file,
+                        bench_format_t format,
+                        const char* p_benchmark,
+                        const char* const* pp_metrics,
+                        size_t metric_count);
+
+/**
+ * @brief       Writes the results of a benchmark case.
+ *
+ * @param[in] p_report          pointer to report
+ * @param[in] p_name            name of the case, unique within the benchmark so results can be compared across runs
+ * @param[in] p_values          values of the metrics, in the order given to bench_report_begin()
+ */
+void bench_report_add(bench_report_t* p_report,
+                      const char* p_name,
+                      const double* p_values);
+
+/**
+ * @brief       Finishes a report, closing the JSON document.
+ *
+ * @param[in] p_report          pointer to report
+ */
+void bench_report_end(bench_report_t* p_report);
+
+/**
+ * @brief       Parses the name of a report format, "csv" or "json".
+ *
+ * @param[in]  p_text           pointer to text
+ * @param[out] p_format         pointer to format
+ *
+ * @return bool                 true if the name was valid
+ */
+bool bench_parse_format(const char* p_text,
+                        bench_format_t* p_format);
+
+/**
+ * @brief       Parses a size in bytes, optionally followed by K, M or G for powers of 1024.
+ *
+ * @param[in]  p_text           pointer to text
+ * @param[out] p_size           pointer to size
+ *
+ * @return bool                 true if the size was valid and not 0
+ */
+bool bench_parse_size(const char* p_text,
+                      size_t* p_size);
+
+/**
+ * @brief       Formats a size in bytes with the largest binary unit that divides it.
+ *
+ * @param[in]  size             size in bytes
+ * @param[out] p_text           pointer to text buffer
+ * @param[in]  text_size        size of the text buffer
+ */
+void bench_format_size(size_t size,
+                       char* p_text,
+                       size_t text_size);
+
+/**
+ * @brief       Returns the next number of a fast deterministic generator, xorshift64*.
+ *
+ * @param[in] p_state           pointer to the state of the generator, any value but 0
+ *
+ * @return uint64_t             pseudo-random number
+ */
+uint64_t bench_random(uint64_t* p_state);
+
+#endif  // BENCH_COMMON_H_
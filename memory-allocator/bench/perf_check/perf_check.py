@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""Runs the allocator benchmarks and compares their medians against a stored baseline.
+
+Every benchmark listed in the baseline is run once to warm up and then a number of times,
+and the median of every metric is compared against the baseline value with the tolerance
+of the metric. The check fails if any metric got worse by more than its tolerance.
+
+A benchmark is named after its executable unless it sets "executable", so the same executable
+can be listed with different arguments. Results are read from a file given with --output, and
+anything the benchmark prints, like the logging of the allocator, is discarded.
+
+Usage: perf_check.py --bench-dir BUILD_DIR/bench [--baseline FILE] [--repetitions N] [--update]
+"""
+
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+
+DEFAULT_BASELINE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "baseline.json")
+
+
+def find_executable(bench_dir, name):
+    for candidate in (os.path.join(bench_dir, name, name + ".elf"), os.path.join(bench_dir, name, name)):
+        if os.path.isfile(candidate):
+            return candidate
+    raise FileNotFoundError("{} not found in {}".format(name, bench_dir))
+
+
+def run_benchmark(executable, arguments):
+    with tempfile.NamedTemporaryFile(mode="r", suffix=".json") as output_file:
+        subprocess.run([executable, "--format", "json", "--output", output_file.name] + arguments,
+                       check=True, stdout=subprocess.DEVNULL)
+        output = json.load(output_file)
+    return {result["name"]: result for result in output["results"]}
+
+
+def collect_medians(executable, arguments, warmup, repetitions):
+    for _ in range(warmup):
+        run_benchmark(executable, arguments)
+
+    samples = {}
+    for _ in range(repetitions):
+        for name, result in run_benchmark(executable, arguments).items():
+            for metric, value in result.items():
+                if metric != "name":
+                    samples.setdefault(name, {}).setdefault(metric, []).append(value)
+
+    return {name: {metric: statistics.median(values) for metric, values in metrics.items()}
+            for name, metrics in samples.items()}
+
+
+def compare(benchmark, expected, medians, tolerances):
+    """Returns the rows of the report of a benchmark and whether all of them passed."""
+    rows = []
+    passed = True
+
+    for name, metrics in sorted(expected.items()):
+        for metric, baseline in sorted(metrics.items()):
+            tolerance = tolerances[metric]
+            current = medians.get(name, {}).get(metric)
+            if current is None:
+                rows.append((benchmark, name, metric, baseline, None, None, tolerance["max_change"], "MISSING"))
+                passed = False
+                continue
+
+            # Changes are always expressed so that a positive one is a slowdown
+            change = (current - baseline) / baseline if baseline != 0 else 0.0
+            if tolerance["higher_is_better"]:
+                change = -change
+            status = "ok" if change <= tolerance["max_change"] else "SLOWER"
+            passed = passed and (status == "ok")
+            rows.append((benchmark, name, metric, baseline, current, change, tolerance["max_change"], status))
+    return rows, passed
+
+
+def print_report(rows):
+    header = ("benchmark", "case", "metric", "baseline", "current", "slowdown", "tolerance", "status")
+    table = [header]
+    for benchmark, name, metric, baseline, current, change, max_change, status in rows:
+        table.append((benchmark, name, metric, "{:.4g}".format(baseline),
+                      "-" if current is None else "{:.4g}".format(current),
+                      "-" if change is None else "{:+.1%}".format(change),
+                      "{:.0%}".format(max_change), status))
+
+    widths = [max(len(row[i]) for row in table) for i in range(len(header))]
+    for row in table:
+        print("  ".join(cell.ljust(width) for cell, width in zip(row, widths)).rstrip())
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--bench-dir", required=True, help="build directory of the benchmarks")
+    parser.add_argument("--baseline", default=DEFAULT_BASELINE, help="baseline file, the checked-in one by default")
+    parser.add_argument("--warmup", type=int, default=1, help="runs discarded before measuring")
+    parser.add_argument("--repetitions", type=int, default=7, help="runs the medians are taken from")
+    parser.add_argument("--update", action="store_true", help="store the medians as the new baseline instead of checking")
+    options = parser.parse_args()
+
+    with open(options.baseline) as baseline_file:
+        baseline = json.load(baseline_file)
+
+    rows = []
+    passed = True
+    for benchmark, configuration in baseline["benchmarks"].items():
+        executable = find_executable(options.bench_dir, configuration.get("executable", benchmark))
+        medians = collect_medians(executable, configuration["arguments"], options.warmup, options.repetitions)
+
+        if options.update:
+            for name, metrics in configuration["results"].items():
+                for metric in metrics:
+                    metrics[metric] = float("{:.4g}".format(medians[name][metric]))
+            continue
+
+        benchmark_rows, benchmark_passed = compare(benchmark, configuration["results"], medians, baseline["tolerances"])
+        rows += benchmark_rows
+        passed = passed and benchmark_passed
+
+    if options.update:
+        with open(options.baseline, "w") as baseline_file:
+            json.dump(baseline, baseline_file, indent=2)
+            baseline_file.write("\n")
+        print("Baseline updated: {}".format(options.baseline))
+        return 0
+
+    print_report(rows)
+    print("\nperf_check {}".format("passed" if passed else "FAILED, some metrics got worse than their tolerance"))
+    return 0 if passed else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
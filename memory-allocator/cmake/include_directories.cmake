@@ -2,4 +2,6 @@ set(INCLUDE_PATHS
     ${PROJECT_SOURCE_DIR}
     ${PROJECT_SOURCE_DIR}/allocator
     ${PROJECT_SOURCE_DIR}/logging
+    ${PROJECT_SOURCE_DIR}/replay
+    ${PROJECT_SOURCE_DIR}/timing
 )
\ No newline at end of file
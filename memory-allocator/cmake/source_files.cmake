@@ -1,4 +1,19 @@
 
 set(SOURCE_FILES
     ${PROJECT_SOURCE_DIR}/allocator/allocator.c
+    ${PROJECT_SOURCE_DIR}/allocator/allocator_segmented.c
+    ${PROJECT_SOURCE_DIR}/allocator/allocator_mux.c
+    ${PROJECT_SOURCE_DIR}/allocator/allocator_latency.c
+    ${PROJECT_SOURCE_DIR}/allocator/allocator_trace.c
+    ${PROJECT_SOURCE_DIR}/logging/logging_async.c
+    ${PROJECT_SOURCE_DIR}/logging/logging_compact.c
+    ${PROJECT_SOURCE_DIR}/logging/logging_flight.c
+    ${PROJECT_SOURCE_DIR}/logging/logging_levels.c
+    ${PROJECT_SOURCE_DIR}/logging/logging_limits.c
+    ${PROJECT_SOURCE_DIR}/logging/logging_sink.c
+    ${PROJECT_SOURCE_DIR}/logging/logging_stamp.c
+    ${PROJECT_SOURCE_DIR}/logging/logging_record.c
+    ${PROJECT_SOURCE_DIR}/replay/planner.c
+    ${PROJECT_SOURCE_DIR}/replay/replay.c
+    ${PROJECT_SOURCE_DIR}/timing/timing.c
 )
\ No newline at end of file
@@ -1,13 +1,69 @@
 #include "allocator.h"
+#include "allocator_probes.h"
+#include "allocator_trace.h"
 
-#include "stdbool.h"
+#include "sched.h"
 #include "stdlib.h"
+#include "string.h"
+#include "time.h"
+#include "timing.h"
 
-#define __FILENAME__     "allocator.c"
-#define LOG_MODULE_GROUP LOG_GROUP_DEFAULT
-#define LOG_LEVEL        LOG_LEVEL_DEBUG
+#if defined(__linux__)
+#include "linux/futex.h"
+#include "sys/eventfd.h"
+#include "sys/syscall.h"
+#include "unistd.h"
+#endif
+
+#define __FILENAME__        "allocator.c"
+#define LOG_MODULE_GROUP    LOG_GROUP_ALLOCATOR
+#define LOG_MODULE_GROUP_ID LOG_GROUP_ID_ALLOCATOR
+#define LOG_LEVEL           LOG_LEVEL_DEBUG
 #include "logging.h"
 
+// Latency instrumentation of the public operations, compiled out unless ALLOCATOR_LATENCY is defined
+#if defined(ALLOCATOR_LATENCY)
+#define LATENCY_START()               uint64_t latency_start_ticks = timing_now_ticks()
+#define LATENCY_STOP(p_allocator, op) allocator_latency_histogram_record(&(p_allocator)->p_latency[op], timing_now_ticks() - latency_start_ticks)
+#else
+#define LATENCY_START()
+#define LATENCY_STOP(p_allocator, op)
+#endif
+
+// Trace recording of the public operations, compiled out unless ALLOCATOR_TRACE is defined.
+// While no trace is being recorded it costs a load and a branch
+#if defined(ALLOCATOR_TRACE)
+#define TRACE_RECORD(p_allocator, op, size, result)                                   \
+    do {                                                                              \
+        if (__atomic_load_n(&allocator_trace_generation, __ATOMIC_RELAXED) != 0) {    \
+            allocator_trace_record((p_allocator), (op), (size), (result));            \
+        }                                                                             \
+    } while (0)
+#else
+// The size is only named in sizeof, so a variable kept for the trace doesn't go unused
+#define TRACE_RECORD(p_allocator, op, size, result)    do { (void)sizeof(size); } while (0)
+#endif
+
+// Number of polls done by ALLOCATOR_WAIT_SPIN_YIELD before it starts yielding the CPU
+#define WAIT_SPIN_COUNT 128
+
+typedef struct {
+    uint64_t timeout_ns;
+    struct timespec start;
+    uint32_t spins;
+} wait_state_t;
+
+// The consumer only reads the heads and the producer only reads the tails,
+// so publishing them with acquire/release semantics is enough to share an
+// allocator between one producer thread and one consumer thread
+static size_t load_index(size_t* p_index) {
+    return __atomic_load_n(p_index, __ATOMIC_ACQUIRE);
+}
+
+static void store_index(size_t* p_index, size_t value) {
+    __atomic_store_n(p_index, value, __ATOMIC_RELEASE);
+}
+
 static size_t get_index_after_block(allocator_buffer_cb_t* p_cb, size_t index, uint8_t block_size) {
     // The new index would go beyond the buffer size after inserting the block
     // so the new index needs to wrap-around the buffer
@@ -19,13 +75,16 @@ static size_t get_index_after_block(allocator_buffer_cb_t* p_cb, size_t index, u
 }
 
 static size_t get_buffer_utilization(allocator_buffer_cb_t* p_cb) {
+    size_t head = load_index(&p_cb->head);
+    size_t tail = load_index(&p_cb->tail);
+
     // No wrap-around
-    if (p_cb->head >= p_cb->tail) {
-        return p_cb->head - p_cb->tail;
+    if (head >= tail) {
+        return head - tail;
     }
     // The head has wrapped around the buffer
     else {
-        return p_cb->max_capacity + p_cb->head - p_cb->tail;
+        return p_cb->max_capacity + head - tail;
     }
 }
 
@@ -34,7 +93,355 @@ static size_t get_space_available(allocator_buffer_cb_t* p_cb) {
 }
 
 static bool is_buffer_empty(allocator_buffer_cb_t* p_cb) {
-    return (p_cb->head == p_cb->tail);
+    return (load_index(&p_cb->head) == load_index(&p_cb->tail));
+}
+
+static size_t get_alignment_padding(const uint8_t* p_address, size_t alignment) {
+    return (size_t)(-(uintptr_t)p_address & (alignment - 1));
+}
+
+// Bytes the producer skips from the head to align a block. A block can run into the
+// overhang past the end of the data buffer, but it has to start before it, so a block
+// whose aligned start would be past the end starts over aligned at the beginning
+static size_t get_head_padding(allocator_t* p_allocator, size_t head, size_t alignment) {
+    size_t max_capacity = p_allocator->data_cb.max_capacity;
+    size_t padding = get_alignment_padding(&p_allocator->p_buffer[head], alignment);
+
+    if (head + padding >= max_capacity) {
+        padding = max_capacity - head + get_alignment_padding(p_allocator->p_buffer, alignment);
+    }
+    return padding;
+}
+
+/**
+ * @brief       Finds the first byte of a block from the end of the block before it.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] data_index        index of the data buffer right after the previous block
+ * @param[in] size_index        index of the block in the size buffer
+ *
+ * @return size_t               index of the block in the data buffer
+ */
+static size_t get_block_start(allocator_t* p_allocator, size_t data_index, size_t size_index) {
+    // Published before the head of the first aligned block, which the caller has already loaded
+    uint16_t* p_block_padding = __atomic_load_n(&p_allocator->p_block_padding, __ATOMIC_ACQUIRE);
+
+    if (p_block_padding == NULL) {
+        return data_index;
+    }
+
+    size_t start = data_index + p_block_padding[size_index];
+    return (start >= p_allocator->data_cb.max_capacity) ? (start - p_allocator->data_cb.max_capacity) : start;
+}
+
+// Every statistics counter has a single writer, so a plain read-modify-write
+// is enough as long as readers can't see torn values
+static void stats_add(uint64_t* p_counter, uint64_t value) {
+    __atomic_store_n(p_counter, *p_counter + value, __ATOMIC_RELAXED);
+}
+
+static void stats_max(size_t* p_peak, size_t value) {
+    if (value > *p_peak) {
+        __atomic_store_n(p_peak, value, __ATOMIC_RELAXED);
+    }
+}
+
+static size_t get_histogram_bucket(size_t block_size) {
+    size_t bucket = 0;
+
+    while ((block_size >>= 1) != 0) {
+        bucket++;
+    }
+    return (bucket < ALLOCATOR_STATS_HISTOGRAM_BUCKETS) ? bucket : (ALLOCATOR_STATS_HISTOGRAM_BUCKETS - 1);
+}
+
+static void stats_record_alloc(allocator_t* p_allocator, size_t block_size) {
+    allocator_stats_t* p_stats = p_allocator->p_stats;
+
+    stats_add(&p_stats->allocs, 1);
+    stats_add(&p_stats->bytes_in, block_size);
+    stats_add(&p_stats->block_size_histogram[get_histogram_bucket(block_size)], 1);
+    stats_max(&p_stats->data_peak_utilization, get_buffer_utilization(&p_allocator->data_cb));
+    stats_max(&p_stats->size_peak_utilization, get_buffer_utilization(&p_allocator->size_cb));
+}
+
+// The flag is set by the producer and cleared by the consumer, the compare and
+// swap makes sure every crossing is reported exactly once
+static void check_high_watermark(allocator_t* p_allocator) {
+    bool expected = false;
+
+    if ((get_buffer_utilization(&p_allocator->data_cb) >= p_allocator->high_watermark) &&
+        (__atomic_compare_exchange_n(&p_allocator->above_high_watermark, &expected, true, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED) == true) &&
+        (p_allocator->watermark_callback != NULL)) {
+        p_allocator->watermark_callback(ALLOCATOR_WATERMARK_HIGH, p_allocator->p_watermark_context);
+    }
+}
+
+static void check_low_watermark(allocator_t* p_allocator) {
+    bool expected = true;
+
+    if ((__atomic_load_n(&p_allocator->above_high_watermark, __ATOMIC_RELAXED) == true) &&
+        (get_buffer_utilization(&p_allocator->data_cb) <= p_allocator->low_watermark) &&
+        (__atomic_compare_exchange_n(&p_allocator->above_high_watermark, &expected, false, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED) == true) &&
+        (p_allocator->watermark_callback != NULL)) {
+        p_allocator->watermark_callback(ALLOCATOR_WATERMARK_LOW, p_allocator->p_watermark_context);
+    }
+}
+
+static size_t get_unused_reservation(allocator_quota_t* p_quota, size_t used) {
+    return (used < p_quota->reserved) ? (p_quota->reserved - used) : 0;
+}
+
+// Space a tenant can take without eating into the reservations of the other tenants.
+// A consumer crediting the tenant lowers its bytes used before it gives the reservation back,
+// so in between the own unused reservation can be larger than the total one
+static size_t get_tenant_space_available(allocator_t* p_allocator, uint8_t tenant, size_t space_available) {
+    allocator_quota_t* p_quota = &p_allocator->p_quotas[tenant];
+    size_t own_unused = get_unused_reservation(p_quota, __atomic_load_n(&p_quota->used, __ATOMIC_RELAXED));
+    size_t reserved_unused = __atomic_load_n(&p_allocator->reserved_unused, __ATOMIC_RELAXED);
+    size_t others_unused = (reserved_unused > own_unused) ? (reserved_unused - own_unused) : 0;
+
+    return (space_available > others_unused) ? (space_available - others_unused) : 0;
+}
+
+// Accounts a block to its tenant. Producer and consumer both update the counters,
+// so they are updated atomically and the reservation deltas derived from the old value
+static void charge_tenant(allocator_t* p_allocator, uint8_t tenant, size_t block_size) {
+    allocator_quota_t* p_quota = &p_allocator->p_quotas[tenant];
+    size_t used = __atomic_fetch_add(&p_quota->used, block_size, __ATOMIC_RELAXED);
+    size_t consumed = get_unused_reservation(p_quota, used) - get_unused_reservation(p_quota, used + block_size);
+
+    if (consumed > 0) {
+        __atomic_fetch_sub(&p_allocator->reserved_unused, consumed, __ATOMIC_RELAXED);
+    }
+}
+
+static void credit_tenant(allocator_t* p_allocator, uint8_t tenant, size_t block_size) {
+    allocator_quota_t* p_quota = &p_allocator->p_quotas[tenant];
+    size_t used = __atomic_fetch_sub(&p_quota->used, block_size, __ATOMIC_RELAXED);
+    size_t returned = get_unused_reservation(p_quota, used - block_size) - get_unused_reservation(p_quota, used);
+
+    if (returned > 0) {
+        __atomic_fetch_add(&p_allocator->reserved_unused, returned, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief       Advances the tails of both buffers past the oldest block.
+ *
+ * @param[in] p_allocator       pointer to a non-empty allocator
+ *
+ * @return size_t               size of the block that was released
+ */
+static size_t release_oldest_block(allocator_t* p_allocator) {
+    // Save the block size we are about to free
+    size_t block_size = p_allocator->p_block_sizes[p_allocator->size_cb.tail];
+    size_t block_start = get_block_start(p_allocator, p_allocator->data_cb.tail, p_allocator->size_cb.tail);
+
+    if (p_allocator->p_quotas != NULL) {
+        credit_tenant(p_allocator, p_allocator->p_block_tenants[p_allocator->size_cb.tail], block_size);
+    }
+
+    if (p_allocator->p_stats != NULL) {
+        stats_add(&p_allocator->p_stats->frees, 1);
+        stats_add(&p_allocator->p_stats->bytes_out, block_size);
+    }
+
+    // Advance the tails of both buffers, the data buffer last because that's
+    // what the producer looks at to know if there's space available
+    store_index(&p_allocator->size_cb.tail, get_index_after_block(&p_allocator->size_cb, p_allocator->size_cb.tail, 1));
+    store_index(&p_allocator->data_cb.tail, get_index_after_block(&p_allocator->data_cb, block_start, block_size));
+    return block_size;
+}
+
+// Evicts the oldest blocks until block_space bytes fit in the data buffer
+static void evict_until_space_available(allocator_t* p_allocator, size_t block_space) {
+    while ((block_space > get_space_available(&p_allocator->data_cb)) &&
+           (is_buffer_empty(&p_allocator->data_cb) == false)) {
+        size_t evicted_block_size = release_oldest_block(p_allocator);
+
+        // Only the producer writes the counters, readers may load them at any time
+        __atomic_store_n(&p_allocator->dropped_blocks, p_allocator->dropped_blocks + 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&p_allocator->dropped_bytes, p_allocator->dropped_bytes + evicted_block_size, __ATOMIC_RELAXED);
+    }
+}
+
+// A cursor that isn't at the tail of the size buffer has already read the oldest block
+static bool is_oldest_block_consumed(allocator_t* p_allocator) {
+    for (size_t i = 0; i < ALLOCATOR_MAX_CURSORS; i++) {
+        allocator_cursor_t* p_cursor = &p_allocator->cursors[i];
+
+        if ((__atomic_load_n(&p_cursor->registered, __ATOMIC_ACQUIRE) == true) &&
+            (load_index(&p_cursor->size_tail) == p_allocator->size_cb.tail)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Returns the cursor with the given id, NULL if the id is out of range or not registered
+static allocator_cursor_t* get_registered_cursor(allocator_t* p_allocator, size_t cursor_id) {
+    if ((cursor_id >= ALLOCATOR_MAX_CURSORS) ||
+        (__atomic_load_n(&p_allocator->cursors[cursor_id].registered, __ATOMIC_ACQUIRE) == false)) {
+        return NULL;
+    }
+    return &p_allocator->cursors[cursor_id];
+}
+
+// Releases the blocks every cursor has advanced past. Only the producer moves
+// the tails, so the cursors can be advanced from different threads
+static void reclaim_consumed_blocks(allocator_t* p_allocator) {
+    while ((is_buffer_empty(&p_allocator->data_cb) == false) &&
+           (is_oldest_block_consumed(p_allocator) == true)) {
+        release_oldest_block(p_allocator);
+    }
+    check_low_watermark(p_allocator);
+}
+
+static void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ volatile("yield");
+#endif
+}
+
+static uint64_t get_elapsed_ns(const struct timespec* p_start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)(now.tv_sec - p_start->tv_sec) * 1000000000u + (uint64_t)(now.tv_nsec - p_start->tv_nsec);
+}
+
+static void futex_wait(uint32_t* p_word, uint32_t expected, uint64_t timeout_ns) {
+#if defined(__linux__)
+    struct timespec timeout;
+    timeout.tv_sec = (time_t)(timeout_ns / 1000000000u);
+    timeout.tv_nsec = (long)(timeout_ns % 1000000000u);
+    syscall(SYS_futex, p_word, FUTEX_WAIT_PRIVATE, expected, (timeout_ns == ALLOCATOR_WAIT_FOREVER) ? NULL : &timeout, NULL, 0);
+#else
+    (void)p_word;
+    (void)expected;
+    (void)timeout_ns;
+    sched_yield();
+#endif
+}
+
+static void futex_wake(uint32_t* p_word) {
+#if defined(__linux__)
+    syscall(SYS_futex, p_word, FUTEX_WAKE_PRIVATE, INT32_MAX, NULL, NULL, 0);
+#else
+    (void)p_word;
+#endif
+}
+
+// Called after every change that a waiter might be interested in. The syscall is
+// only issued when somebody is actually sleeping on the futex
+static void notify_waiters(allocator_t* p_allocator, uint32_t* p_seq, uint32_t* p_waiters) {
+    if (p_allocator->wait_strategy != ALLOCATOR_WAIT_FUTEX) {
+        return;
+    }
+
+    // Both operations are sequentially consistent so that either we see the waiter,
+    // or the waiter sees the new sequence number and doesn't go to sleep
+    __atomic_fetch_add(p_seq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(p_waiters, __ATOMIC_SEQ_CST) != 0) {
+        futex_wake(p_seq);
+    }
+}
+
+static void signal_event_fd(int fd) {
+#if defined(__linux__)
+    uint64_t value = 1;
+    ssize_t written = write(fd, &value, sizeof(value));
+    (void)written;
+#else
+    (void)fd;
+#endif
+}
+
+// Called by the producer right after publishing a new head
+static void notify_data_available(allocator_t* p_allocator, size_t previous_head) {
+    if (p_allocator->data_event_fd < 0) {
+        return;
+    }
+
+    // The consumer stores its tail and then looks at the head, and we store the head
+    // and then look at the tail. The fences make sure at least one of us sees the
+    // other's store, so the consumer never goes back to sleep on a non-empty buffer
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (load_index(&p_allocator->data_cb.tail) == previous_head) {
+        signal_event_fd(p_allocator->data_event_fd);
+    }
+}
+
+// Called by the consumer right after publishing a new tail
+static void notify_space_available(allocator_t* p_allocator, size_t freed_bytes) {
+    if (p_allocator->space_event_fd < 0) {
+        return;
+    }
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    size_t utilization = get_buffer_utilization(&p_allocator->data_cb);
+    if ((utilization < p_allocator->space_watermark) &&
+        (utilization + freed_bytes >= p_allocator->space_watermark)) {
+        signal_event_fd(p_allocator->space_event_fd);
+    }
+}
+
+static void wait_begin(wait_state_t* p_wait, uint64_t timeout_ns) {
+    p_wait->timeout_ns = timeout_ns;
+    p_wait->spins = 0;
+    clock_gettime(CLOCK_MONOTONIC, &p_wait->start);
+}
+
+/**
+ * @brief       Waits until the other side of the allocator makes progress.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] p_wait            pointer to the state of the current wait
+ * @param[in] p_seq             sequence number bumped by the other side
+ * @param[in] p_waiters         waiter counter checked by the other side
+ * @param[in] seen_seq          sequence number read before the last failed attempt
+ *
+ * @return bool                 false if the timeout expired, true otherwise
+ */
+static bool wait_for_progress(allocator_t* p_allocator,
+                              wait_state_t* p_wait,
+                              uint32_t* p_seq,
+                              uint32_t* p_waiters,
+                              uint32_t seen_seq) {
+    uint64_t elapsed_ns = get_elapsed_ns(&p_wait->start);
+    if ((p_wait->timeout_ns != ALLOCATOR_WAIT_FOREVER) && (elapsed_ns >= p_wait->timeout_ns)) {
+        return false;
+    }
+
+    switch (p_allocator->wait_strategy) {
+        case ALLOCATOR_WAIT_BUSY_SPIN:
+            cpu_relax();
+            break;
+
+        case ALLOCATOR_WAIT_SPIN_YIELD:
+            if (p_wait->spins < WAIT_SPIN_COUNT) {
+                p_wait->spins++;
+                cpu_relax();
+            } else {
+                sched_yield();
+            }
+            break;
+
+        case ALLOCATOR_WAIT_FUTEX:
+            // If the other side made progress since seen_seq was read, the
+            // futex wait returns immediately and we simply try again
+            __atomic_fetch_add(p_waiters, 1, __ATOMIC_SEQ_CST);
+            futex_wait(p_seq,
+                       seen_seq,
+                       (p_wait->timeout_ns == ALLOCATOR_WAIT_FOREVER) ? ALLOCATOR_WAIT_FOREVER : p_wait->timeout_ns - elapsed_ns);
+            __atomic_fetch_sub(p_waiters, 1, __ATOMIC_SEQ_CST);
+            break;
+    }
+
+    return true;
 }
 
 /**
@@ -57,13 +464,43 @@ allocator_t* allocator_init(size_t buffer_size,
         return NULL;
     }
 
+    p_allocator->p_block_padding = NULL;
     p_allocator->min_block_size = min_block_size;
     p_allocator->max_block_size = max_block_size;
+    p_allocator->wait_strategy = ALLOCATOR_WAIT_SPIN_YIELD;
+    p_allocator->data_seq = 0;
+    p_allocator->space_seq = 0;
+    p_allocator->data_waiters = 0;
+    p_allocator->space_waiters = 0;
+    p_allocator->data_event_fd = -1;
+    p_allocator->space_event_fd = -1;
+    p_allocator->space_watermark = 0;
+    p_allocator->overwrite_oldest = false;
+    p_allocator->dropped_blocks = 0;
+    p_allocator->dropped_bytes = 0;
+    p_allocator->cursor_count = 0;
+    p_allocator->p_quotas = NULL;
+    p_allocator->p_block_tenants = NULL;
+    p_allocator->tenant_count = 0;
+    p_allocator->reserved_unused = 0;
+    p_allocator->high_watermark = SIZE_MAX;
+    p_allocator->low_watermark = 0;
+    p_allocator->watermark_callback = NULL;
+    p_allocator->p_watermark_context = NULL;
+    p_allocator->above_high_watermark = false;
+    p_allocator->p_stats = NULL;
+    p_allocator->p_latency = NULL;
+    p_allocator->trace_id = 0;
+    p_allocator->trace_generation = 0;
+    for (size_t i = 0; i < ALLOCATOR_MAX_CURSORS; i++) {
+        p_allocator->cursors[i].registered = false;
+    }
 
     // Allocate a buffer of the requested size + 1,
-    // because we are using the circular buffer implementation that wastes a slot
+    // because we are using the circular buffer implementation that wastes a slot.
+    // Blocks that wrap around run into an overhang past the end so they stay contiguous
     p_allocator->data_cb.max_capacity = buffer_size + 1;
-    p_allocator->p_buffer = (uint8_t*)malloc(p_allocator->data_cb.max_capacity);
+    p_allocator->p_buffer = (uint8_t*)malloc(p_allocator->data_cb.max_capacity + max_block_size);
     p_allocator->data_cb.head = 0;
     p_allocator->data_cb.tail = 0;
 
@@ -87,6 +524,24 @@ allocator_t* allocator_init(size_t buffer_size,
         return NULL;
     }
 
+#if defined(ALLOCATOR_LATENCY)
+    p_allocator->p_latency = (allocator_latency_histogram_t*)calloc(ALLOCATOR_OP_COUNT, sizeof(allocator_latency_histogram_t));
+
+    // Check if we failed to allocate memory for the latency histograms
+    if (p_allocator->p_latency == NULL) {
+        free(p_allocator->p_block_sizes);
+        free(p_allocator->p_buffer);
+        free(p_allocator);
+        return NULL;
+    }
+#endif
+
+#if defined(ALLOCATOR_TRACE)
+    p_allocator->trace_id = allocator_trace_next_id();
+#endif
+    TRACE_RECORD(p_allocator, ALLOCATOR_TRACE_OP_INIT, 0, ALLOCATOR_SUCCESS);
+
+    ALLOCATOR_PROBE4(init, p_allocator, buffer_size, min_block_size, max_block_size);
     return p_allocator;
 }
 
@@ -96,6 +551,19 @@ allocator_t* allocator_init(size_t buffer_size,
  * @param[in] p_allocator       pointer to allocator instance
  */
 void allocator_uninit(allocator_t* p_allocator) {
+    ALLOCATOR_PROBE2(uninit, p_allocator, get_buffer_utilization(&p_allocator->data_cb));
+    TRACE_RECORD(p_allocator, ALLOCATOR_TRACE_OP_UNINIT, 0, ALLOCATOR_SUCCESS);
+#if defined(__linux__)
+    if (p_allocator->data_event_fd >= 0) {
+        close(p_allocator->data_event_fd);
+        close(p_allocator->space_event_fd);
+    }
+#endif
+    free(p_allocator->p_latency);
+    free(p_allocator->p_stats);
+    free(p_allocator->p_quotas);
+    free(p_allocator->p_block_tenants);
+    free(p_allocator->p_block_padding);
     free(p_allocator->p_block_sizes);
     free(p_allocator->p_buffer);
     free(p_allocator);
@@ -113,26 +581,105 @@ void allocator_uninit(allocator_t* p_allocator) {
  *                              - ALLOCATOR_ERROR_UNSUPPORTED_SIZE if the requested block size is not supported
  */
 allocator_error_t allocator_alloc(allocator_t* p_allocator, size_t block_size, uint8_t** pp_block) {
+    return allocator_alloc_tenant(p_allocator, 0, block_size, pp_block);
+}
+
+static bool is_alignment_supported(size_t alignment) {
+    return ((alignment > 0) && (alignment <= ALLOCATOR_MAX_ALIGNMENT) && ((alignment & (alignment - 1)) == 0));
+}
+
+// Does the actual work of allocate(), which wraps it to measure its latency
+static allocator_error_t alloc_block(allocator_t* p_allocator, uint8_t tenant, size_t block_size, size_t alignment, uint8_t** pp_block) {
     if ((block_size < p_allocator->min_block_size) ||
-        (block_size > p_allocator->max_block_size)) {
+        (block_size > p_allocator->max_block_size) ||
+        (is_alignment_supported(alignment) == false)) {
+        if (p_allocator->p_stats != NULL) {
+            stats_add(&p_allocator->p_stats->unsupported_size, 1);
+        }
         return ALLOCATOR_ERROR_UNSUPPORTED_SIZE;
     }
 
-    log_debug("Trying alloc - %lu data available, %lu size available", get_space_available(&p_allocator->data_cb), get_space_available(&p_allocator->size_cb));
-    if (block_size > get_space_available(&p_allocator->data_cb)) {
+    if (p_allocator->p_quotas != NULL) {
+        if (tenant >= p_allocator->tenant_count) {
+            return ALLOCATOR_ERROR_NOT_FOUND;
+        }
+
+        allocator_quota_t* p_quota = &p_allocator->p_quotas[tenant];
+        if (__atomic_load_n(&p_quota->used, __ATOMIC_RELAXED) + block_size > p_quota->ceiling) {
+            if (p_allocator->p_stats != NULL) {
+                stats_add(&p_allocator->p_stats->quota_exceeded, 1);
+            }
+            return ALLOCATOR_ERROR_QUOTA_EXCEEDED;
+        }
+    }
+
+    // The padding of every block has to be stored once some of them are aligned, the
+    // consumer can't tell how much the producer skipped to align a block otherwise
+    if ((alignment > 1) && (p_allocator->p_block_padding == NULL)) {
+        uint16_t* p_block_padding = (uint16_t*)calloc(p_allocator->size_cb.max_capacity, sizeof(uint16_t));
+        if (p_block_padding == NULL) {
+            return ALLOCATOR_ERROR_OUT_OF_MEMORY;
+        }
+        __atomic_store_n(&p_allocator->p_block_padding, p_block_padding, __ATOMIC_RELEASE);
+    }
+
+    // Only the producer moves the head, so the padding doesn't change while we make room
+    size_t previous_head = p_allocator->data_cb.head;
+    size_t padding = get_head_padding(p_allocator, previous_head, alignment);
+    size_t block_space = padding + block_size;
+
+    // With cursors registered, consumed blocks are only reclaimed once we need their space
+    if ((p_allocator->cursor_count > 0) &&
+        (block_space > get_space_available(&p_allocator->data_cb))) {
+        reclaim_consumed_blocks(p_allocator);
+    }
+
+    if (p_allocator->overwrite_oldest == true) {
+        evict_until_space_available(p_allocator, block_space);
+    }
+
+    size_t space_available = get_space_available(&p_allocator->data_cb);
+    if (p_allocator->p_quotas != NULL) {
+        space_available = get_tenant_space_available(p_allocator, tenant, space_available);
+    }
+
+    log_debug("Trying alloc - %lu data available, %lu size available", space_available, get_space_available(&p_allocator->size_cb));
+    if (block_space > space_available) {
+        if (p_allocator->p_stats != NULL) {
+            stats_add(&p_allocator->p_stats->out_of_memory, 1);
+        }
         return ALLOCATOR_ERROR_OUT_OF_MEMORY;
     }
 
-    // All sanity checks passed, we can return a pointer to the current head
+    // All sanity checks passed, we can return a pointer past the padding
     // with the certainty that we have the space requested by the user
-    *pp_block = &(p_allocator->p_buffer[p_allocator->data_cb.head]);
-
-    // Advance the head by the block size we just "allocated"
-    p_allocator->data_cb.head = get_index_after_block(&p_allocator->data_cb, p_allocator->data_cb.head, block_size);
+    size_t block_start = previous_head + padding;
+    if (block_start >= p_allocator->data_cb.max_capacity) {
+        block_start -= p_allocator->data_cb.max_capacity;
+    }
+    *pp_block = &(p_allocator->p_buffer[block_start]);
 
     // Save the block size we just allocated and advance the head of the block size buffer
     p_allocator->p_block_sizes[p_allocator->size_cb.head] = block_size;
-    p_allocator->size_cb.head = get_index_after_block(&p_allocator->size_cb, p_allocator->size_cb.head, 1);
+    if (p_allocator->p_block_padding != NULL) {
+        p_allocator->p_block_padding[p_allocator->size_cb.head] = (uint16_t)padding;
+    }
+    if (p_allocator->p_quotas != NULL) {
+        p_allocator->p_block_tenants[p_allocator->size_cb.head] = tenant;
+        charge_tenant(p_allocator, tenant, block_size);
+    }
+    store_index(&p_allocator->size_cb.head, get_index_after_block(&p_allocator->size_cb, p_allocator->size_cb.head, 1));
+
+    // Advance the head by the block size we just "allocated". This publishes the block
+    // to the consumer, so it has to happen after its size has been stored
+    store_index(&p_allocator->data_cb.head, get_index_after_block(&p_allocator->data_cb, block_start, block_size));
+    notify_waiters(p_allocator, &p_allocator->data_seq, &p_allocator->data_waiters);
+    notify_data_available(p_allocator, previous_head);
+    check_high_watermark(p_allocator);
+
+    if (p_allocator->p_stats != NULL) {
+        stats_record_alloc(p_allocator, block_size);
+    }
 
     log_debug("Alloc successful --------");
     log_debug("Data buffer: Head %lu, Utilization %lu, Space %lu", p_allocator->data_cb.head, get_buffer_utilization(&p_allocator->data_cb), get_space_available(&p_allocator->data_cb));
@@ -140,6 +687,70 @@ allocator_error_t allocator_alloc(allocator_t* p_allocator, size_t block_size, u
     return ALLOCATOR_SUCCESS;
 }
 
+// Measures, records and traces every allocation, whatever function it went through
+static allocator_error_t allocate(allocator_t* p_allocator, uint8_t tenant, size_t block_size, size_t alignment, uint8_t** pp_block) {
+    LATENCY_START();
+    allocator_error_t result = alloc_block(p_allocator, tenant, block_size, alignment, pp_block);
+    LATENCY_STOP(p_allocator, ALLOCATOR_OP_ALLOC);
+    TRACE_RECORD(p_allocator, ALLOCATOR_TRACE_OP_ALLOC, block_size, result);
+
+    if (result == ALLOCATOR_SUCCESS) {
+        ALLOCATOR_PROBE4(alloc, p_allocator, block_size, p_allocator->data_cb.head, load_index(&p_allocator->data_cb.tail));
+    } else {
+        ALLOCATOR_PROBE3(alloc_failed, p_allocator, block_size, result);
+    }
+    return result;
+}
+
+/**
+ * @brief       Allocates a block of a given size on behalf of a tenant.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[in]  tenant           id of the tenant, ignored if quotas are not enabled
+ * @param[in]  block_size       size of the block to allocate
+ * @param[out] pp_block         pointer to pointer to allocated block
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the block was allocated
+ *                              - ALLOCATOR_ERROR_OUT_OF_MEMORY if the allocator buffer is full
+ *                                or the free space is reserved for other tenants
+ *                              - ALLOCATOR_ERROR_UNSUPPORTED_SIZE if the requested block size is not supported
+ *                              - ALLOCATOR_ERROR_QUOTA_EXCEEDED if the tenant would go over its ceiling
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if the tenant doesn't exist
+ */
+allocator_error_t allocator_alloc_tenant(allocator_t* p_allocator, uint8_t tenant, size_t block_size, uint8_t** pp_block) {
+    return allocate(p_allocator, tenant, block_size, 1, pp_block);
+}
+
+/**
+ * @brief       Allocates a block of a given size at an aligned address.
+ *
+ * The bytes skipped to align the block are taken from the data buffer along with the block
+ * and given back when it's freed, so an aligned block can take up to alignment - 1 more bytes.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[in]  block_size       size of the block to allocate
+ * @param[in]  alignment        alignment of the block, a power of two up to ALLOCATOR_MAX_ALIGNMENT
+ * @param[out] pp_block         pointer to pointer to allocated block
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the block was allocated
+ *                              - ALLOCATOR_ERROR_OUT_OF_MEMORY if the allocator buffer is full
+ *                              - ALLOCATOR_ERROR_UNSUPPORTED_SIZE if the requested block size or alignment is not supported
+ */
+allocator_error_t allocator_alloc_aligned(allocator_t* p_allocator, size_t block_size, size_t alignment, uint8_t** pp_block) {
+    return allocate(p_allocator, 0, block_size, alignment, pp_block);
+}
+
+static allocator_error_t peek_block(allocator_t* p_allocator, uint8_t** pp_block, size_t* p_block_size) {
+    if (is_buffer_empty(&p_allocator->data_cb) == true) {
+        return ALLOCATOR_ERROR_NOT_FOUND;
+    }
+
+    size_t block_size = p_allocator->p_block_sizes[p_allocator->size_cb.tail];
+    *pp_block = &(p_allocator->p_buffer[get_block_start(p_allocator, p_allocator->data_cb.tail, p_allocator->size_cb.tail)]);
+    *p_block_size = block_size;
+    return ALLOCATOR_SUCCESS;
+}
+
 /**
  * @brief       Peeks at the oldest block allocated.
  * 
@@ -151,12 +762,38 @@ allocator_error_t allocator_alloc(allocator_t* p_allocator, size_t block_size, u
  *                              - ALLOCATOR_ERROR_NOT_FOUND otherwise
  */
 allocator_error_t allocator_peek(allocator_t* p_allocator, uint8_t** pp_block, size_t* p_block_size) {
+    LATENCY_START();
+    allocator_error_t result = peek_block(p_allocator, pp_block, p_block_size);
+    LATENCY_STOP(p_allocator, ALLOCATOR_OP_PEEK);
+
+    if (result == ALLOCATOR_SUCCESS) {
+        TRACE_RECORD(p_allocator, ALLOCATOR_TRACE_OP_PEEK, *p_block_size, result);
+        ALLOCATOR_PROBE4(peek, p_allocator, *p_block_size, load_index(&p_allocator->data_cb.head), p_allocator->data_cb.tail);
+    }
+    return result;
+}
+
+static allocator_error_t free_block(allocator_t* p_allocator) {
     if (is_buffer_empty(&p_allocator->data_cb) == true) {
         return ALLOCATOR_ERROR_NOT_FOUND;
     }
 
-    *pp_block = &(p_allocator->p_buffer[p_allocator->data_cb.tail]);
-    *p_block_size = p_allocator->p_block_sizes[p_allocator->size_cb.tail];
+    size_t previous_tail = p_allocator->data_cb.tail;
+    size_t freed_block_size = release_oldest_block(p_allocator);
+    TRACE_RECORD(p_allocator, ALLOCATOR_TRACE_OP_FREE, freed_block_size, ALLOCATOR_SUCCESS);
+    ALLOCATOR_PROBE4(free, p_allocator, freed_block_size, load_index(&p_allocator->data_cb.head), p_allocator->data_cb.tail);
+    notify_waiters(p_allocator, &p_allocator->space_seq, &p_allocator->space_waiters);
+
+    // The padding before the block is given back along with it
+    size_t freed_bytes = (p_allocator->data_cb.tail > previous_tail) ?
+                         (p_allocator->data_cb.tail - previous_tail) :
+                         (p_allocator->data_cb.max_capacity + p_allocator->data_cb.tail - previous_tail);
+    notify_space_available(p_allocator, freed_bytes);
+    check_low_watermark(p_allocator);
+
+    log_debug("Free successful --------");
+    log_debug("Data buffer: Tail %lu, Utilization %lu, Space %lu", p_allocator->data_cb.tail, get_buffer_utilization(&p_allocator->data_cb), get_space_available(&p_allocator->data_cb));
+    log_debug("Size buffer: Tail %lu, Utilization %lu, Space %lu", p_allocator->size_cb.tail, get_buffer_utilization(&p_allocator->size_cb), get_space_available(&p_allocator->size_cb));
     return ALLOCATOR_SUCCESS;
 }
 
@@ -169,19 +806,515 @@ allocator_error_t allocator_peek(allocator_t* p_allocator, uint8_t** pp_block, s
  *                              - ALLOCATOR_ERROR_NOT_FOUND if there was nothing to free
  */
 allocator_error_t allocator_free(allocator_t* p_allocator) {
-    if (is_buffer_empty(&p_allocator->data_cb) == true) {
+    LATENCY_START();
+    allocator_error_t result = free_block(p_allocator);
+    LATENCY_STOP(p_allocator, ALLOCATOR_OP_FREE);
+    return result;
+}
+
+/**
+ * @brief       Selects how the *_wait functions wait for space or data.
+ *
+ * The strategy should be selected before any thread starts waiting on the allocator.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] strategy          - ALLOCATOR_WAIT_BUSY_SPIN keeps polling the buffer
+ *                              - ALLOCATOR_WAIT_SPIN_YIELD polls for a while and then yields the CPU
+ *                              - ALLOCATOR_WAIT_FUTEX sleeps until the other side wakes it up
+ */
+void allocator_set_wait_strategy(allocator_t* p_allocator, allocator_wait_strategy_t strategy) {
+    p_allocator->wait_strategy = strategy;
+}
+
+/**
+ * @brief       Allocates a block of a given size, waiting for space if the buffer is full.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[in]  block_size       size of the block to allocate
+ * @param[out] pp_block         pointer to pointer to allocated block
+ * @param[in]  timeout_ns       maximum time to wait in nanoseconds, or ALLOCATOR_WAIT_FOREVER
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the block was allocated
+ *                              - ALLOCATOR_ERROR_OUT_OF_MEMORY if the buffer was still full after the timeout
+ *                              - ALLOCATOR_ERROR_UNSUPPORTED_SIZE if the requested block size is not supported
+ */
+allocator_error_t allocator_alloc_wait(allocator_t* p_allocator, size_t block_size, uint8_t** pp_block, uint64_t timeout_ns) {
+    wait_state_t wait;
+    wait_begin(&wait, timeout_ns);
+
+    while (true) {
+        // The sequence number has to be read before trying, otherwise a free
+        // happening right after our attempt could go unnoticed
+        uint32_t seen_seq = __atomic_load_n(&p_allocator->space_seq, __ATOMIC_SEQ_CST);
+
+        allocator_error_t result = allocator_alloc(p_allocator, block_size, pp_block);
+        if (result != ALLOCATOR_ERROR_OUT_OF_MEMORY) {
+            return result;
+        }
+
+        if (wait_for_progress(p_allocator, &wait, &p_allocator->space_seq, &p_allocator->space_waiters, seen_seq) == false) {
+            return result;
+        }
+    }
+}
+
+/**
+ * @brief       Peeks at the oldest block allocated, waiting for one if the buffer is empty.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[out] pp_block         pointer to pointer to data block
+ * @param[out] p_block_size     pointer to block size
+ * @param[in]  timeout_ns       maximum time to wait in nanoseconds, or ALLOCATOR_WAIT_FOREVER
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if there was a block to peek at
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if the buffer was still empty after the timeout
+ */
+allocator_error_t allocator_peek_wait(allocator_t* p_allocator, uint8_t** pp_block, size_t* p_block_size, uint64_t timeout_ns) {
+    wait_state_t wait;
+    wait_begin(&wait, timeout_ns);
+
+    while (true) {
+        uint32_t seen_seq = __atomic_load_n(&p_allocator->data_seq, __ATOMIC_SEQ_CST);
+
+        allocator_error_t result = allocator_peek(p_allocator, pp_block, p_block_size);
+        if (result != ALLOCATOR_ERROR_NOT_FOUND) {
+            return result;
+        }
+
+        if (wait_for_progress(p_allocator, &wait, &p_allocator->data_seq, &p_allocator->data_waiters, seen_seq) == false) {
+            return result;
+        }
+    }
+}
+
+/**
+ * @brief       Attaches a pair of eventfds to the allocator so it can be driven from an epoll loop.
+ *
+ * The data eventfd is signalled when the buffer goes from empty to non-empty, and the
+ * space eventfd when the utilization of the data buffer drops below space_watermark.
+ * Signals are only sent on those transitions, so after reading an eventfd the consumer
+ * should peek and free until ALLOCATOR_ERROR_NOT_FOUND, and the producer should allocate
+ * until ALLOCATOR_ERROR_OUT_OF_MEMORY. Both eventfds are non-blocking.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] space_watermark   utilization in bytes below which the space eventfd is signalled,
+ *                              it should leave room for at least one max_block_size block
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the eventfds were created
+ *                              - ALLOCATOR_ERROR_SYSTEM if the eventfds couldn't be created
+ */
+allocator_error_t allocator_enable_event_fds(allocator_t* p_allocator, size_t space_watermark) {
+#if defined(__linux__)
+    if (p_allocator->data_event_fd >= 0) {
+        p_allocator->space_watermark = space_watermark;
+        return ALLOCATOR_SUCCESS;
+    }
+
+    int data_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (data_event_fd < 0) {
+        return ALLOCATOR_ERROR_SYSTEM;
+    }
+
+    int space_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (space_event_fd < 0) {
+        close(data_event_fd);
+        return ALLOCATOR_ERROR_SYSTEM;
+    }
+
+    p_allocator->space_watermark = space_watermark;
+    p_allocator->space_event_fd = space_event_fd;
+    p_allocator->data_event_fd = data_event_fd;
+
+    // Blocks allocated before the eventfds existed would never be signalled otherwise
+    if (is_buffer_empty(&p_allocator->data_cb) == false) {
+        signal_event_fd(data_event_fd);
+    }
+
+    return ALLOCATOR_SUCCESS;
+#else
+    (void)p_allocator;
+    (void)space_watermark;
+    return ALLOCATOR_ERROR_SYSTEM;
+#endif
+}
+
+/**
+ * @brief       Returns the eventfd signalled when data becomes available.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ *
+ * @return int                  file descriptor, -1 if the eventfds are not enabled
+ */
+int allocator_get_data_event_fd(allocator_t* p_allocator) {
+    return p_allocator->data_event_fd;
+}
+
+/**
+ * @brief       Returns the eventfd signalled when space becomes available.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ *
+ * @return int                  file descriptor, -1 if the eventfds are not enabled
+ */
+int allocator_get_space_event_fd(allocator_t* p_allocator) {
+    return p_allocator->space_event_fd;
+}
+
+/**
+ * @brief       Enables or disables the overwrite-oldest (flight recorder) mode.
+ *
+ * In this mode allocator_alloc() never runs out of memory: it evicts the oldest blocks
+ * until the new block fits, so the buffer always holds the most recent data. Since the
+ * producer moves the tails, the consumer has to be synchronized with it externally.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] enable            true to evict the oldest blocks, false to fail with out of memory
+ */
+void allocator_set_overwrite_oldest(allocator_t* p_allocator, bool enable) {
+    p_allocator->overwrite_oldest = enable;
+}
+
+/**
+ * @brief       Reads how much data has been evicted in overwrite-oldest mode.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[out] p_blocks         pointer to number of blocks dropped, can be NULL
+ * @param[out] p_bytes          pointer to number of bytes dropped, can be NULL
+ */
+void allocator_get_dropped(allocator_t* p_allocator, uint64_t* p_blocks, uint64_t* p_bytes) {
+    if (p_blocks != NULL) {
+        *p_blocks = __atomic_load_n(&p_allocator->dropped_blocks, __ATOMIC_RELAXED);
+    }
+    if (p_bytes != NULL) {
+        *p_bytes = __atomic_load_n(&p_allocator->dropped_bytes, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief       Registers a consumer cursor that reads every block independently of the other cursors.
+ *
+ * The cursor starts at the oldest block in the allocator. While cursors are registered, blocks
+ * are consumed with allocator_cursor_peek() and allocator_cursor_advance() instead of
+ * allocator_peek() and allocator_free(), and the space of a block is reclaimed by the producer
+ * once every cursor has advanced past it. Cursors should be registered before the producer
+ * starts, and can't be combined with the overwrite-oldest mode.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[out] p_cursor_id      pointer to the id of the new cursor
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the cursor was registered
+ *                              - ALLOCATOR_ERROR_OUT_OF_MEMORY if all ALLOCATOR_MAX_CURSORS cursors are in use
+ */
+allocator_error_t allocator_cursor_register(allocator_t* p_allocator, size_t* p_cursor_id) {
+    for (size_t i = 0; i < ALLOCATOR_MAX_CURSORS; i++) {
+        allocator_cursor_t* p_cursor = &p_allocator->cursors[i];
+
+        if (p_cursor->registered == false) {
+            p_cursor->data_tail = load_index(&p_allocator->data_cb.tail);
+            p_cursor->size_tail = load_index(&p_allocator->size_cb.tail);
+            __atomic_store_n(&p_cursor->registered, true, __ATOMIC_RELEASE);
+            p_allocator->cursor_count++;
+
+            *p_cursor_id = i;
+            return ALLOCATOR_SUCCESS;
+        }
+    }
+
+    return ALLOCATOR_ERROR_OUT_OF_MEMORY;
+}
+
+/**
+ * @brief       Unregisters a consumer cursor, the blocks it hasn't read no longer wait for it.
+ *
+ * Ids of cursors that aren't registered are ignored.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] cursor_id         id of the cursor
+ */
+void allocator_cursor_unregister(allocator_t* p_allocator, size_t cursor_id) {
+    allocator_cursor_t* p_cursor = get_registered_cursor(p_allocator, cursor_id);
+
+    if (p_cursor != NULL) {
+        __atomic_store_n(&p_cursor->registered, false, __ATOMIC_RELEASE);
+        p_allocator->cursor_count--;
+        notify_waiters(p_allocator, &p_allocator->space_seq, &p_allocator->space_waiters);
+    }
+}
+
+/**
+ * @brief       Peeks at the oldest block the cursor hasn't advanced past yet.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[in]  cursor_id        id of the cursor
+ * @param[out] pp_block         pointer to pointer to data block
+ * @param[out] p_block_size     pointer to block size
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if there was a block to peek at
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if there wasn't or the cursor isn't registered
+ */
+allocator_error_t allocator_cursor_peek(allocator_t* p_allocator, size_t cursor_id, uint8_t** pp_block, size_t* p_block_size) {
+    allocator_cursor_t* p_cursor = get_registered_cursor(p_allocator, cursor_id);
+
+    if ((p_cursor == NULL) || (p_cursor->data_tail == load_index(&p_allocator->data_cb.head))) {
         return ALLOCATOR_ERROR_NOT_FOUND;
     }
 
-    // Save the block size we are about to free
-    size_t freed_block_size = p_allocator->p_block_sizes[p_allocator->size_cb.tail];
+    size_t block_size = p_allocator->p_block_sizes[p_cursor->size_tail];
+    *pp_block = &(p_allocator->p_buffer[get_block_start(p_allocator, p_cursor->data_tail, p_cursor->size_tail)]);
+    *p_block_size = block_size;
+    return ALLOCATOR_SUCCESS;
+}
 
-    // Advance the tails of both buffers
-    p_allocator->size_cb.tail = get_index_after_block(&p_allocator->size_cb, p_allocator->size_cb.tail, 1);
-    p_allocator->data_cb.tail = get_index_after_block(&p_allocator->data_cb, p_allocator->data_cb.tail, freed_block_size);
+/**
+ * @brief       Advances the cursor past its oldest block.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] cursor_id         id of the cursor
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the cursor was advanced
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if the cursor had nothing left to read
+ *                                or isn't registered
+ */
+allocator_error_t allocator_cursor_advance(allocator_t* p_allocator, size_t cursor_id) {
+    allocator_cursor_t* p_cursor = get_registered_cursor(p_allocator, cursor_id);
 
-    log_debug("Free successful --------");
-    log_debug("Data buffer: Tail %lu, Utilization %lu, Space %lu", p_allocator->data_cb.tail, get_buffer_utilization(&p_allocator->data_cb), get_space_available(&p_allocator->data_cb));
-    log_debug("Size buffer: Tail %lu, Utilization %lu, Space %lu", p_allocator->size_cb.tail, get_buffer_utilization(&p_allocator->size_cb), get_space_available(&p_allocator->size_cb));
+    if ((p_cursor == NULL) || (p_cursor->data_tail == load_index(&p_allocator->data_cb.head))) {
+        return ALLOCATOR_ERROR_NOT_FOUND;
+    }
+
+    size_t block_size = p_allocator->p_block_sizes[p_cursor->size_tail];
+
+    // The producer decides what can be reclaimed by looking at size_tail,
+    // so it's published last, once we are done with the block
+    size_t block_start = get_block_start(p_allocator, p_cursor->data_tail, p_cursor->size_tail);
+    p_cursor->data_tail = get_index_after_block(&p_allocator->data_cb, block_start, block_size);
+    store_index(&p_cursor->size_tail, get_index_after_block(&p_allocator->size_cb, p_cursor->size_tail, 1));
+    notify_waiters(p_allocator, &p_allocator->space_seq, &p_allocator->space_waiters);
+
+    return ALLOCATOR_SUCCESS;
+}
+
+/**
+ * @brief       Enables per-tenant quotas. Must be called while the allocator is empty.
+ *
+ * Every tenant starts without a reservation and without a ceiling. Blocks allocated
+ * with allocator_alloc() are accounted to tenant 0.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] tenant_count      number of tenants sharing the allocator
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if quotas were enabled
+ *                              - ALLOCATOR_ERROR_OUT_OF_MEMORY if the quota tables couldn't be allocated
+ */
+allocator_error_t allocator_enable_quotas(allocator_t* p_allocator, uint8_t tenant_count) {
+    allocator_quota_t* p_quotas = (allocator_quota_t*)malloc(tenant_count * sizeof(allocator_quota_t));
+    uint8_t* p_block_tenants = (uint8_t*)malloc(p_allocator->size_cb.max_capacity);
+
+    if ((p_quotas == NULL) || (p_block_tenants == NULL)) {
+        free(p_quotas);
+        free(p_block_tenants);
+        return ALLOCATOR_ERROR_OUT_OF_MEMORY;
+    }
+
+    for (size_t i = 0; i < tenant_count; i++) {
+        p_quotas[i].reserved = 0;
+        p_quotas[i].ceiling = SIZE_MAX;
+        p_quotas[i].used = 0;
+    }
+
+    free(p_allocator->p_quotas);
+    free(p_allocator->p_block_tenants);
+    p_allocator->p_quotas = p_quotas;
+    p_allocator->p_block_tenants = p_block_tenants;
+    p_allocator->tenant_count = tenant_count;
+    p_allocator->reserved_unused = 0;
+    return ALLOCATOR_SUCCESS;
+}
+
+/**
+ * @brief       Sets the quota of a tenant.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] tenant            id of the tenant
+ * @param[in] reserved          bytes of the data buffer that other tenants can't use
+ * @param[in] ceiling           maximum number of bytes the tenant can hold at once, SIZE_MAX for no limit
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the quota was set
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if quotas are not enabled or the tenant doesn't exist
+ */
+allocator_error_t allocator_set_quota(allocator_t* p_allocator, uint8_t tenant, size_t reserved, size_t ceiling) {
+    if ((p_allocator->p_quotas == NULL) || (tenant >= p_allocator->tenant_count)) {
+        return ALLOCATOR_ERROR_NOT_FOUND;
+    }
+
+    allocator_quota_t* p_quota = &p_allocator->p_quotas[tenant];
+    size_t used = __atomic_load_n(&p_quota->used, __ATOMIC_RELAXED);
+
+    __atomic_fetch_sub(&p_allocator->reserved_unused, get_unused_reservation(p_quota, used), __ATOMIC_RELAXED);
+    p_quota->reserved = reserved;
+    p_quota->ceiling = ceiling;
+    __atomic_fetch_add(&p_allocator->reserved_unused, get_unused_reservation(p_quota, used), __ATOMIC_RELAXED);
+    return ALLOCATOR_SUCCESS;
+}
+
+/**
+ * @brief       Returns the number of bytes in use in the data buffer.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ *
+ * @return size_t               bytes in use
+ */
+size_t allocator_get_utilization(allocator_t* p_allocator) {
+    return get_buffer_utilization(&p_allocator->data_cb);
+}
+
+/**
+ * @brief       Sets high and low watermarks on the utilization of the data buffer.
+ *
+ * The high watermark fires once when the utilization reaches high_watermark, and the
+ * low watermark fires once when it then drops to low_watermark or below, so producers
+ * can throttle before running out of memory and resume with some hysteresis.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] high_watermark    utilization in bytes at which producers should throttle
+ * @param[in] low_watermark     utilization in bytes at which producers can resume
+ * @param[in] callback          called on every crossing from the thread that caused it, can be NULL
+ * @param[in] p_context         passed to the callback
+ */
+void allocator_set_watermarks(allocator_t* p_allocator,
+                              size_t high_watermark,
+                              size_t low_watermark,
+                              allocator_watermark_callback_t callback,
+                              void* p_context) {
+    p_allocator->watermark_callback = callback;
+    p_allocator->p_watermark_context = p_context;
+    p_allocator->low_watermark = low_watermark;
+    p_allocator->high_watermark = high_watermark;
+    __atomic_store_n(&p_allocator->above_high_watermark, false, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief       Tells if the high watermark has been reached and the low watermark not yet.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ *
+ * @return bool                 true if producers should throttle, false otherwise
+ */
+bool allocator_is_above_high_watermark(allocator_t* p_allocator) {
+    return __atomic_load_n(&p_allocator->above_high_watermark, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief       Enables the statistics of the allocator, starting from zero.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the statistics were enabled
+ *                              - ALLOCATOR_ERROR_OUT_OF_MEMORY if they couldn't be allocated
+ */
+allocator_error_t allocator_enable_stats(allocator_t* p_allocator) {
+    if (p_allocator->p_stats != NULL) {
+        return ALLOCATOR_SUCCESS;
+    }
+
+    allocator_stats_t* p_stats = (allocator_stats_t*)calloc(1, sizeof(allocator_stats_t));
+    if (p_stats == NULL) {
+        return ALLOCATOR_ERROR_OUT_OF_MEMORY;
+    }
+
+    p_stats->data_peak_utilization = get_buffer_utilization(&p_allocator->data_cb);
+    p_stats->size_peak_utilization = get_buffer_utilization(&p_allocator->size_cb);
+    __atomic_store_n(&p_allocator->p_stats, p_stats, __ATOMIC_RELEASE);
+    return ALLOCATOR_SUCCESS;
+}
+
+/**
+ * @brief       Takes a snapshot of the statistics of the allocator.
+ *
+ * Each counter is written by a single thread, so the snapshot can be taken
+ * at any time without stopping producers or consumers.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[out] p_stats          pointer to the snapshot
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the snapshot was taken
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if the statistics are not enabled
+ */
+allocator_error_t allocator_get_stats(allocator_t* p_allocator, allocator_stats_t* p_stats) {
+    allocator_stats_t* p_source = __atomic_load_n(&p_allocator->p_stats, __ATOMIC_ACQUIRE);
+
+    if (p_source == NULL) {
+        return ALLOCATOR_ERROR_NOT_FOUND;
+    }
+
+    p_stats->allocs = __atomic_load_n(&p_source->allocs, __ATOMIC_RELAXED);
+    p_stats->frees = __atomic_load_n(&p_source->frees, __ATOMIC_RELAXED);
+    p_stats->bytes_in = __atomic_load_n(&p_source->bytes_in, __ATOMIC_RELAXED);
+    p_stats->bytes_out = __atomic_load_n(&p_source->bytes_out, __ATOMIC_RELAXED);
+    p_stats->data_peak_utilization = __atomic_load_n(&p_source->data_peak_utilization, __ATOMIC_RELAXED);
+    p_stats->size_peak_utilization = __atomic_load_n(&p_source->size_peak_utilization, __ATOMIC_RELAXED);
+    p_stats->out_of_memory = __atomic_load_n(&p_source->out_of_memory, __ATOMIC_RELAXED);
+    p_stats->unsupported_size = __atomic_load_n(&p_source->unsupported_size, __ATOMIC_RELAXED);
+    p_stats->quota_exceeded = __atomic_load_n(&p_source->quota_exceeded, __ATOMIC_RELAXED);
+    for (size_t i = 0; i < ALLOCATOR_STATS_HISTOGRAM_BUCKETS; i++) {
+        p_stats->block_size_histogram[i] = __atomic_load_n(&p_source->block_size_histogram[i], __ATOMIC_RELAXED);
+    }
+
+    return ALLOCATOR_SUCCESS;
+}
+
+/**
+ * @brief       Copies the latency histogram of an operation.
+ *
+ * Latencies are only recorded when the allocator is built with ALLOCATOR_LATENCY defined.
+ * Values are in ticks of timing_now_ticks(), use timing_ticks_to_ns() to convert them.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[in]  op               operation
+ * @param[out] p_histogram      pointer to the copy of the histogram
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the histogram was copied
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if latencies are not being recorded
+ */
+allocator_error_t allocator_get_latency(allocator_t* p_allocator, allocator_op_t op, allocator_latency_histogram_t* p_histogram) {
+    if ((p_allocator->p_latency == NULL) || (op >= ALLOCATOR_OP_COUNT)) {
+        return ALLOCATOR_ERROR_NOT_FOUND;
+    }
+
+    memcpy(p_histogram, &p_allocator->p_latency[op], sizeof(allocator_latency_histogram_t));
     return ALLOCATOR_SUCCESS;
 }
+
+/**
+ * @brief       Clears the latency histograms of all operations.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ */
+void allocator_reset_latency(allocator_t* p_allocator) {
+    if (p_allocator->p_latency == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < ALLOCATOR_OP_COUNT; i++) {
+        allocator_latency_histogram_reset(&p_allocator->p_latency[i]);
+    }
+}
+
+/**
+ * @brief       Prints the latency percentiles of all operations.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] p_file            file to print to
+ */
+void allocator_dump_latency(allocator_t* p_allocator, FILE* p_file) {
+    static const char* op_names[ALLOCATOR_OP_COUNT] = { "alloc", "peek", "free" };
+
+    if (p_allocator->p_latency == NULL) {
+        fprintf(p_file, "Latency histograms not available, build with ALLOCATOR_LATENCY\n");
+        return;
+    }
+
+    for (size_t i = 0; i < ALLOCATOR_OP_COUNT; i++) {
+        allocator_latency_histogram_print(&p_allocator->p_latency[i], op_names[i], p_file);
+    }
+}
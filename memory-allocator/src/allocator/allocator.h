@@ -1,8 +1,11 @@
 #ifndef ALLOCATOR_H_
 #define ALLOCATOR_H_
 
+#include "allocator_latency.h"
+#include "stdbool.h"
 #include "stddef.h"
 #include "stdint.h"
+#include "stdio.h"
 
 typedef struct {
     size_t head;
@@ -10,13 +13,94 @@ typedef struct {
     size_t max_capacity;
 } allocator_buffer_cb_t;
 
+// Largest alignment allocator_alloc_aligned() supports, enough for O_DIRECT I/O
+#define ALLOCATOR_MAX_ALIGNMENT 4096
+
+// Maximum number of consumer cursors that can be registered on one allocator
+#define ALLOCATOR_MAX_CURSORS 8
+
+typedef struct {
+    size_t data_tail;
+    size_t size_tail;
+    bool registered;
+} allocator_cursor_t;
+
+typedef struct {
+    size_t reserved;    // Bytes of the data buffer nobody else can take from the tenant
+    size_t ceiling;     // Maximum number of bytes the tenant can hold at once
+    size_t used;
+} allocator_quota_t;
+
+// One bucket per power of two up to the biggest block size that fits in a uint8_t
+#define ALLOCATOR_STATS_HISTOGRAM_BUCKETS 8
+
+typedef struct {
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    size_t data_peak_utilization;   // Peak number of bytes in the data buffer
+    size_t size_peak_utilization;   // Peak number of blocks in the size buffer
+    uint64_t out_of_memory;
+    uint64_t unsupported_size;
+    uint64_t quota_exceeded;
+    uint64_t block_size_histogram[ALLOCATOR_STATS_HISTOGRAM_BUCKETS];  // Bucket i counts sizes in [2^i, 2^(i+1))
+} allocator_stats_t;
+
+typedef enum {
+    ALLOCATOR_OP_ALLOC,
+    ALLOCATOR_OP_PEEK,
+    ALLOCATOR_OP_FREE,
+    ALLOCATOR_OP_COUNT,
+} allocator_op_t;
+
+typedef enum {
+    ALLOCATOR_WATERMARK_HIGH,
+    ALLOCATOR_WATERMARK_LOW,
+} allocator_watermark_t;
+
+typedef void (*allocator_watermark_callback_t)(allocator_watermark_t watermark, void* p_context);
+
+typedef enum {
+    ALLOCATOR_WAIT_BUSY_SPIN,
+    ALLOCATOR_WAIT_SPIN_YIELD,
+    ALLOCATOR_WAIT_FUTEX,
+} allocator_wait_strategy_t;
+
 typedef struct {
     allocator_buffer_cb_t data_cb;
     allocator_buffer_cb_t size_cb;
     uint8_t* p_buffer;
     uint8_t* p_block_sizes;
+    uint16_t* p_block_padding;  // Bytes skipped before each block to align it, NULL until the first aligned allocation
     uint8_t min_block_size;
     uint8_t max_block_size;
+    allocator_wait_strategy_t wait_strategy;
+    uint32_t data_seq;      // Bumped on every alloc when waiting on a futex
+    uint32_t space_seq;     // Bumped on every free when waiting on a futex
+    uint32_t data_waiters;  // Number of consumers sleeping on data_seq
+    uint32_t space_waiters; // Number of producers sleeping on space_seq
+    int data_event_fd;      // Signalled when the buffer goes from empty to non-empty, -1 if disabled
+    int space_event_fd;     // Signalled when the utilization drops below space_watermark, -1 if disabled
+    size_t space_watermark;
+    bool overwrite_oldest;  // Evict the oldest blocks instead of running out of memory
+    uint64_t dropped_blocks;
+    uint64_t dropped_bytes;
+    allocator_cursor_t cursors[ALLOCATOR_MAX_CURSORS];
+    size_t cursor_count;    // Number of registered cursors, blocks are reclaimed by the producer if non-zero
+    allocator_quota_t* p_quotas;
+    uint8_t* p_block_tenants;
+    size_t tenant_count;
+    size_t reserved_unused; // Sum of the reservations the tenants aren't using yet
+    size_t high_watermark;  // SIZE_MAX if watermarks are disabled
+    size_t low_watermark;
+    allocator_watermark_callback_t watermark_callback;
+    void* p_watermark_context;
+    bool above_high_watermark;
+    allocator_stats_t* p_stats;
+    allocator_latency_histogram_t* p_latency;  // One histogram per allocator_op_t, NULL unless built with ALLOCATOR_LATENCY
+    uint32_t trace_id;          // Identifies the allocator in traces, see allocator_trace.h
+    uint32_t trace_generation;  // Last trace the configuration of the allocator was recorded in
 } allocator_t;
 
 typedef enum {
@@ -24,8 +108,14 @@ typedef enum {
     ALLOCATOR_ERROR_OUT_OF_MEMORY,
     ALLOCATOR_ERROR_NOT_FOUND,
     ALLOCATOR_ERROR_UNSUPPORTED_SIZE,
+    ALLOCATOR_ERROR_SYSTEM,
+    ALLOCATOR_ERROR_QUOTA_EXCEEDED,
+    ALLOCATOR_ERROR_NOT_EMPTY,
 } allocator_error_t;
 
+// Timeout value that makes the *_wait functions block until they succeed
+#define ALLOCATOR_WAIT_FOREVER UINT64_MAX
+
 /**
  * @brief       Initializes an allocator instance.
  * 
@@ -62,6 +152,26 @@ allocator_error_t allocator_alloc(allocator_t* p_allocator,
                                   size_t block_size,
                                   uint8_t** pp_block);
 
+/**
+ * @brief       Allocates a block of a given size at an aligned address.
+ *
+ * The bytes skipped to align the block are taken from the data buffer along with the block
+ * and given back when it's freed, so an aligned block can take up to alignment - 1 more bytes.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[in]  block_size       size of the block to allocate
+ * @param[in]  alignment        alignment of the block, a power of two up to ALLOCATOR_MAX_ALIGNMENT
+ * @param[out] pp_block         pointer to pointer to allocated block
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the block was allocated
+ *                              - ALLOCATOR_ERROR_OUT_OF_MEMORY if the allocator buffer is full
+ *                              - ALLOCATOR_ERROR_UNSUPPORTED_SIZE if the requested block size or alignment is not supported
+ */
+allocator_error_t allocator_alloc_aligned(allocator_t* p_allocator,
+                                          size_t block_size,
+                                          size_t alignment,
+                                          uint8_t** pp_block);
+
 /**
  * @brief       Peeks at the oldest block allocated.
  * 
@@ -86,4 +196,315 @@ allocator_error_t allocator_peek(allocator_t* p_allocator,
  */
 allocator_error_t allocator_free(allocator_t* p_allocator);
 
+/**
+ * @brief       Selects how the *_wait functions wait for space or data.
+ *
+ * The strategy should be selected before any thread starts waiting on the allocator.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] strategy          - ALLOCATOR_WAIT_BUSY_SPIN keeps polling the buffer
+ *                              - ALLOCATOR_WAIT_SPIN_YIELD polls for a while and then yields the CPU
+ *                              - ALLOCATOR_WAIT_FUTEX sleeps until the other side wakes it up
+ */
+void allocator_set_wait_strategy(allocator_t* p_allocator,
+                                 allocator_wait_strategy_t strategy);
+
+/**
+ * @brief       Allocates a block of a given size, waiting for space if the buffer is full.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[in]  block_size       size of the block to allocate
+ * @param[out] pp_block         pointer to pointer to allocated block
+ * @param[in]  timeout_ns       maximum time to wait in nanoseconds, or ALLOCATOR_WAIT_FOREVER
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the block was allocated
+ *                              - ALLOCATOR_ERROR_OUT_OF_MEMORY if the buffer was still full after the timeout
+ *                              - ALLOCATOR_ERROR_UNSUPPORTED_SIZE if the requested block size is not supported
+ */
+allocator_error_t allocator_alloc_wait(allocator_t* p_allocator,
+                                       size_t block_size,
+                                       uint8_t** pp_block,
+                                       uint64_t timeout_ns);
+
+/**
+ * @brief       Peeks at the oldest block allocated, waiting for one if the buffer is empty.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[out] pp_block         pointer to pointer to data block
+ * @param[out] p_block_size     pointer to block size
+ * @param[in]  timeout_ns       maximum time to wait in nanoseconds, or ALLOCATOR_WAIT_FOREVER
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if there was a block to peek at
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if the buffer was still empty after the timeout
+ */
+allocator_error_t allocator_peek_wait(allocator_t* p_allocator,
+                                      uint8_t** pp_block,
+                                      size_t* p_block_size,
+                                      uint64_t timeout_ns);
+
+/**
+ * @brief       Attaches a pair of eventfds to the allocator so it can be driven from an epoll loop.
+ *
+ * The data eventfd is signalled when the buffer goes from empty to non-empty, and the
+ * space eventfd when the utilization of the data buffer drops below space_watermark.
+ * Signals are only sent on those transitions, so after reading an eventfd the consumer
+ * should peek and free until ALLOCATOR_ERROR_NOT_FOUND, and the producer should allocate
+ * until ALLOCATOR_ERROR_OUT_OF_MEMORY. Both eventfds are non-blocking.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] space_watermark   utilization in bytes below which the space eventfd is signalled,
+ *                              it should leave room for at least one max_block_size block
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the eventfds were created
+ *                              - ALLOCATOR_ERROR_SYSTEM if the eventfds couldn't be created
+ */
+allocator_error_t allocator_enable_event_fds(allocator_t* p_allocator,
+                                             size_t space_watermark);
+
+/**
+ * @brief       Returns the eventfd signalled when data becomes available.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ *
+ * @return int                  file descriptor, -1 if the eventfds are not enabled
+ */
+int allocator_get_data_event_fd(allocator_t* p_allocator);
+
+/**
+ * @brief       Returns the eventfd signalled when space becomes available.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ *
+ * @return int                  file descriptor, -1 if the eventfds are not enabled
+ */
+int allocator_get_space_event_fd(allocator_t* p_allocator);
+
+/**
+ * @brief       Enables or disables the overwrite-oldest (flight recorder) mode.
+ *
+ * In this mode allocator_alloc() never runs out of memory: it evicts the oldest blocks
+ * until the new block fits, so the buffer always holds the most recent data. Since the
+ * producer moves the tails, the consumer has to be synchronized with it externally.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] enable            true to evict the oldest blocks, false to fail with out of memory
+ */
+void allocator_set_overwrite_oldest(allocator_t* p_allocator,
+                                    bool enable);
+
+/**
+ * @brief       Reads how much data has been evicted in overwrite-oldest mode.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[out] p_blocks         pointer to number of blocks dropped, can be NULL
+ * @param[out] p_bytes          pointer to number of bytes dropped, can be NULL
+ */
+void allocator_get_dropped(allocator_t* p_allocator,
+                           uint64_t* p_blocks,
+                           uint64_t* p_bytes);
+
+/**
+ * @brief       Registers a consumer cursor that reads every block independently of the other cursors.
+ *
+ * The cursor starts at the oldest block in the allocator. While cursors are registered, blocks
+ * are consumed with allocator_cursor_peek() and allocator_cursor_advance() instead of
+ * allocator_peek() and allocator_free(), and the space of a block is reclaimed by the producer
+ * once every cursor has advanced past it. Cursors should be registered before the producer
+ * starts, and can't be combined with the overwrite-oldest mode.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[out] p_cursor_id      pointer to the id of the new cursor
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the cursor was registered
+ *                              - ALLOCATOR_ERROR_OUT_OF_MEMORY if all ALLOCATOR_MAX_CURSORS cursors are in use
+ */
+allocator_error_t allocator_cursor_register(allocator_t* p_allocator,
+                                            size_t* p_cursor_id);
+
+/**
+ * @brief       Unregisters a consumer cursor, the blocks it hasn't read no longer wait for it.
+ *
+ * Ids of cursors that aren't registered are ignored.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] cursor_id         id of the cursor
+ */
+void allocator_cursor_unregister(allocator_t* p_allocator,
+                                 size_t cursor_id);
+
+/**
+ * @brief       Peeks at the oldest block the cursor hasn't advanced past yet.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[in]  cursor_id        id of the cursor
+ * @param[out] pp_block         pointer to pointer to data block
+ * @param[out] p_block_size     pointer to block size
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if there was a block to peek at
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if there wasn't or the cursor isn't registered
+ */
+allocator_error_t allocator_cursor_peek(allocator_t* p_allocator,
+                                        size_t cursor_id,
+                                        uint8_t** pp_block,
+                                        size_t* p_block_size);
+
+/**
+ * @brief       Advances the cursor past its oldest block.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] cursor_id         id of the cursor
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the cursor was advanced
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if the cursor had nothing left to read
+ *                                or isn't registered
+ */
+allocator_error_t allocator_cursor_advance(allocator_t* p_allocator,
+                                           size_t cursor_id);
+
+/**
+ * @brief       Enables per-tenant quotas. Must be called while the allocator is empty.
+ *
+ * Every tenant starts without a reservation and without a ceiling. Blocks allocated
+ * with allocator_alloc() are accounted to tenant 0.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] tenant_count      number of tenants sharing the allocator
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if quotas were enabled
+ *                              - ALLOCATOR_ERROR_OUT_OF_MEMORY if the quota tables couldn't be allocated
+ */
+allocator_error_t allocator_enable_quotas(allocator_t* p_allocator,
+                                          uint8_t tenant_count);
+
+/**
+ * @brief       Sets the quota of a tenant.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] tenant            id of the tenant
+ * @param[in] reserved          bytes of the data buffer that other tenants can't use
+ * @param[in] ceiling           maximum number of bytes the tenant can hold at once, SIZE_MAX for no limit
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the quota was set
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if quotas are not enabled or the tenant doesn't exist
+ */
+allocator_error_t allocator_set_quota(allocator_t* p_allocator,
+                                      uint8_t tenant,
+                                      size_t reserved,
+                                      size_t ceiling);
+
+/**
+ * @brief       Allocates a block of a given size on behalf of a tenant.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[in]  tenant           id of the tenant, ignored if quotas are not enabled
+ * @param[in]  block_size       size of the block to allocate
+ * @param[out] pp_block         pointer to pointer to allocated block
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the block was allocated
+ *                              - ALLOCATOR_ERROR_OUT_OF_MEMORY if the allocator buffer is full
+ *                                or the free space is reserved for other tenants
+ *                              - ALLOCATOR_ERROR_UNSUPPORTED_SIZE if the requested block size is not supported
+ *                              - ALLOCATOR_ERROR_QUOTA_EXCEEDED if the tenant would go over its ceiling
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if the tenant doesn't exist
+ */
+allocator_error_t allocator_alloc_tenant(allocator_t* p_allocator,
+                                         uint8_t tenant,
+                                         size_t block_size,
+                                         uint8_t** pp_block);
+
+/**
+ * @brief       Returns the number of bytes in use in the data buffer.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ *
+ * @return size_t               bytes in use
+ */
+size_t allocator_get_utilization(allocator_t* p_allocator);
+
+/**
+ * @brief       Sets high and low watermarks on the utilization of the data buffer.
+ *
+ * The high watermark fires once when the utilization reaches high_watermark, and the
+ * low watermark fires once when it then drops to low_watermark or below, so producers
+ * can throttle before running out of memory and resume with some hysteresis.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] high_watermark    utilization in bytes at which producers should throttle
+ * @param[in] low_watermark     utilization in bytes at which producers can resume
+ * @param[in] callback          called on every crossing from the thread that caused it, can be NULL
+ * @param[in] p_context         passed to the callback
+ */
+void allocator_set_watermarks(allocator_t* p_allocator,
+                              size_t high_watermark,
+                              size_t low_watermark,
+                              allocator_watermark_callback_t callback,
+                              void* p_context);
+
+/**
+ * @brief       Tells if the high watermark has been reached and the low watermark not yet.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ *
+ * @return bool                 true if producers should throttle, false otherwise
+ */
+bool allocator_is_above_high_watermark(allocator_t* p_allocator);
+
+/**
+ * @brief       Enables the statistics of the allocator, starting from zero.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the statistics were enabled
+ *                              - ALLOCATOR_ERROR_OUT_OF_MEMORY if they couldn't be allocated
+ */
+allocator_error_t allocator_enable_stats(allocator_t* p_allocator);
+
+/**
+ * @brief       Takes a snapshot of the statistics of the allocator.
+ *
+ * Each counter is written by a single thread, so the snapshot can be taken
+ * at any time without stopping producers or consumers.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[out] p_stats          pointer to the snapshot
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the snapshot was taken
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if the statistics are not enabled
+ */
+allocator_error_t allocator_get_stats(allocator_t* p_allocator,
+                                      allocator_stats_t* p_stats);
+
+/**
+ * @brief       Copies the latency histogram of an operation.
+ *
+ * Latencies are only recorded when the allocator is built with ALLOCATOR_LATENCY defined.
+ * Values are in ticks of timing_now_ticks(), use timing_ticks_to_ns() to convert them.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[in]  op               operation
+ * @param[out] p_histogram      pointer to the copy of the histogram
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the histogram was copied
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if latencies are not being recorded
+ */
+allocator_error_t allocator_get_latency(allocator_t* p_allocator,
+                                        allocator_op_t op,
+                                        allocator_latency_histogram_t* p_histogram);
+
+/**
+ * @brief       Clears the latency histograms of all operations.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ */
+void allocator_reset_latency(allocator_t* p_allocator);
+
+/**
+ * @brief       Prints the latency percentiles of all operations.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] p_file            file to print to
+ */
+void allocator_dump_latency(allocator_t* p_allocator,
+                            FILE* p_file);
+
 #endif  // ALLOCATOR_H_
\ No newline at end of file
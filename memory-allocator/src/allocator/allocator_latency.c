@@ -0,0 +1,102 @@
+#include "allocator_latency.h"
+
+#include "string.h"
+#include "timing.h"
+
+static size_t get_bucket(uint64_t value) {
+    // Small values get a bucket each
+    if (value < ALLOCATOR_LATENCY_SUB_BUCKETS) {
+        return (size_t)value;
+    }
+
+    // Otherwise the most significant bit selects the power of two,
+    // and the bits right below it select the sub-bucket
+    size_t msb = 63 - (size_t)__builtin_clzll(value);
+    size_t shift = msb - ALLOCATOR_LATENCY_SUB_BUCKET_BITS;
+    size_t sub_bucket = (size_t)(value >> shift) & (ALLOCATOR_LATENCY_SUB_BUCKETS - 1);
+    return (shift + 1) * ALLOCATOR_LATENCY_SUB_BUCKETS + sub_bucket;
+}
+
+static uint64_t get_bucket_highest_value(size_t bucket) {
+    if (bucket < ALLOCATOR_LATENCY_SUB_BUCKETS) {
+        return bucket;
+    }
+
+    size_t shift = bucket / ALLOCATOR_LATENCY_SUB_BUCKETS - 1;
+    uint64_t lowest = (uint64_t)(ALLOCATOR_LATENCY_SUB_BUCKETS + bucket % ALLOCATOR_LATENCY_SUB_BUCKETS) << shift;
+    return lowest + ((uint64_t)1 << shift) - 1;
+}
+
+/**
+ * @brief       Clears all the values recorded in a histogram.
+ *
+ * @param[in] p_histogram       pointer to histogram
+ */
+void allocator_latency_histogram_reset(allocator_latency_histogram_t* p_histogram) {
+    memset(p_histogram, 0, sizeof(allocator_latency_histogram_t));
+}
+
+/**
+ * @brief       Records a value in a histogram.
+ *
+ * @param[in] p_histogram       pointer to histogram
+ * @param[in] value             value to record
+ */
+void allocator_latency_histogram_record(allocator_latency_histogram_t* p_histogram, uint64_t value) {
+    p_histogram->counts[get_bucket(value)]++;
+    p_histogram->total++;
+    if (value > p_histogram->max) {
+        p_histogram->max = value;
+    }
+}
+
+/**
+ * @brief       Returns the value below which a given percentage of the recorded values fall.
+ *
+ * @param[in] p_histogram       pointer to histogram
+ * @param[in] percentile        percentile between 0 and 100
+ *
+ * @return uint64_t             highest value of the bucket the percentile falls in,
+ *                              never more than the maximum value recorded
+ */
+uint64_t allocator_latency_histogram_percentile(const allocator_latency_histogram_t* p_histogram, double percentile) {
+    if (p_histogram->total == 0) {
+        return 0;
+    }
+
+    // Rank of the value we are looking for, counting from 1
+    uint64_t rank = (uint64_t)((percentile / 100.0) * (double)p_histogram->total + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < ALLOCATOR_LATENCY_BUCKETS; i++) {
+        seen += p_histogram->counts[i];
+        if (seen >= rank) {
+            uint64_t value = get_bucket_highest_value(i);
+            return (value < p_histogram->max) ? value : p_histogram->max;
+        }
+    }
+
+    return p_histogram->max;
+}
+
+/**
+ * @brief       Prints the count and the usual percentiles of a histogram of tick durations, in nanoseconds.
+ *
+ * @param[in] p_histogram       pointer to histogram of durations measured with timing_now_ticks()
+ * @param[in] p_name            name printed in front of the line
+ * @param[in] p_file            file to print to
+ */
+void allocator_latency_histogram_print(const allocator_latency_histogram_t* p_histogram, const char* p_name, FILE* p_file) {
+    fprintf(p_file,
+            "%-8s count %llu, p50 %llu ns, p90 %llu ns, p99 %llu ns, p99.9 %llu ns, max %llu ns\n",
+            p_name,
+            (unsigned long long)p_histogram->total,
+            (unsigned long long)timing_ticks_to_ns(allocator_latency_histogram_percentile(p_histogram, 50.0)),
+            (unsigned long long)timing_ticks_to_ns(allocator_latency_histogram_percentile(p_histogram, 90.0)),
+            (unsigned long long)timing_ticks_to_ns(allocator_latency_histogram_percentile(p_histogram, 99.0)),
+            (unsigned long long)timing_ticks_to_ns(allocator_latency_histogram_percentile(p_histogram, 99.9)),
+            (unsigned long long)timing_ticks_to_ns(p_histogram->max));
+}
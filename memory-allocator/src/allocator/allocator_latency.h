@@ -0,0 +1,58 @@
+#ifndef ALLOCATOR_LATENCY_H_
+#define ALLOCATOR_LATENCY_H_
+
+#include "stdint.h"
+#include "stdio.h"
+
+// Every power of two is split into 2^ALLOCATOR_LATENCY_SUB_BUCKET_BITS linear sub-buckets,
+// which bounds the relative error of a recorded value to 1 / 2^ALLOCATOR_LATENCY_SUB_BUCKET_BITS
+#define ALLOCATOR_LATENCY_SUB_BUCKET_BITS 3
+#define ALLOCATOR_LATENCY_SUB_BUCKETS     (1u << ALLOCATOR_LATENCY_SUB_BUCKET_BITS)
+#define ALLOCATOR_LATENCY_BUCKETS         ((64 - ALLOCATOR_LATENCY_SUB_BUCKET_BITS + 1) * ALLOCATOR_LATENCY_SUB_BUCKETS)
+
+typedef struct {
+    uint64_t counts[ALLOCATOR_LATENCY_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} allocator_latency_histogram_t;
+
+/**
+ * @brief       Clears all the values recorded in a histogram.
+ *
+ * @param[in] p_histogram       pointer to histogram
+ */
+void allocator_latency_histogram_reset(allocator_latency_histogram_t* p_histogram);
+
+/**
+ * @brief       Records a value in a histogram.
+ *
+ * @param[in] p_histogram       pointer to histogram
+ * @param[in] value             value to record
+ */
+void allocator_latency_histogram_record(allocator_latency_histogram_t* p_histogram,
+                                        uint64_t value);
+
+/**
+ * @brief       Returns the value below which a given percentage of the recorded values fall.
+ *
+ * @param[in] p_histogram       pointer to histogram
+ * @param[in] percentile        percentile between 0 and 100
+ *
+ * @return uint64_t             highest value of the bucket the percentile falls in,
+ *                              never more than the maximum value recorded
+ */
+uint64_t allocator_latency_histogram_percentile(const allocator_latency_histogram_t* p_histogram,
+                                                double percentile);
+
+/**
+ * @brief       Prints the count and the usual percentiles of a histogram of tick durations, in nanoseconds.
+ *
+ * @param[in] p_histogram       pointer to histogram of durations measured with timing_now_ticks()
+ * @param[in] p_name            name printed in front of the line
+ * @param[in] p_file            file to print to
+ */
+void allocator_latency_histogram_print(const allocator_latency_histogram_t* p_histogram,
+                                       const char* p_name,
+                                       FILE* p_file);
+
+#endif  // ALLOCATOR_LATENCY_H_
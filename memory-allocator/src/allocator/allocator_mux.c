@@ -0,0 +1,287 @@
+#include "allocator_mux.h"
+
+#include "stdbool.h"
+#include "stdlib.h"
+
+static void free_mux(allocator_mux_t* p_mux) {
+    if (p_mux->p_allocator != NULL) {
+        allocator_uninit(p_mux->p_allocator);
+    }
+    free(p_mux->p_streams);
+    free(p_mux->pp_slot_blocks);
+    free(p_mux->p_next_in_stream);
+    free(p_mux->p_next_in_lane);
+    free(p_mux->p_slot_streams);
+    free(p_mux->p_slot_freed);
+    free(p_mux);
+}
+
+// Drops the freed blocks at the front of a lane. A freed block further down the
+// lane can't be reclaimed before the blocks in front of it, so it stays valid
+// until it reaches the front and gets dropped here
+static void skip_freed_lane_blocks(allocator_mux_t* p_mux, allocator_mux_lane_t* p_lane) {
+    while ((p_lane->first_slot != ALLOCATOR_MUX_NO_SLOT) &&
+           (p_mux->p_slot_freed[p_lane->first_slot] == true)) {
+        p_lane->first_slot = p_mux->p_next_in_lane[p_lane->first_slot];
+    }
+
+    if (p_lane->first_slot == ALLOCATOR_MUX_NO_SLOT) {
+        p_lane->last_slot = ALLOCATOR_MUX_NO_SLOT;
+    }
+}
+
+// Frees the blocks of the shared buffer that have been freed by their streams,
+// stopping at the oldest block that is still in use
+static void reclaim_freed_blocks(allocator_mux_t* p_mux) {
+    allocator_t* p_allocator = p_mux->p_allocator;
+    uint8_t* p_block;
+    size_t block_size;
+
+    while ((allocator_peek(p_allocator, &p_block, &block_size) == ALLOCATOR_SUCCESS) &&
+           (p_mux->p_slot_freed[p_allocator->size_cb.tail] == true)) {
+        p_mux->p_slot_freed[p_allocator->size_cb.tail] = false;
+        allocator_free(p_allocator);
+    }
+}
+
+/**
+ * @brief       Initializes a multiplexed allocator hosting several logical streams in one buffer.
+ *
+ * Every block belongs to a stream, and each stream is peeked and freed in FIFO order
+ * independently of the others. Blocks freed out of order are reclaimed once all the
+ * blocks allocated before them have been freed as well.
+ *
+ * @param[in] buffer_size       size of the shared buffer
+ * @param[in] min_block_size    minimum size of a block in the shared buffer
+ * @param[in] max_block_size    maximum size of a block in the shared buffer
+ * @param[in] stream_count      number of streams, all of them start in lane 0
+ *
+ * @return allocator_mux_t*     pointer to allocator instance
+ *                              NULL in case of allocation error
+ */
+allocator_mux_t* allocator_mux_init(size_t buffer_size,
+                                    uint8_t min_block_size,
+                                    uint8_t max_block_size,
+                                    uint16_t stream_count) {
+    allocator_mux_t* p_mux = (allocator_mux_t*)calloc(1, sizeof(allocator_mux_t));
+
+    // Check if we failed to allocate memory for the allocator and fail early
+    if (p_mux == NULL) {
+        return NULL;
+    }
+
+    p_mux->p_allocator = allocator_init(buffer_size, min_block_size, max_block_size);
+    if (p_mux->p_allocator == NULL) {
+        free_mux(p_mux);
+        return NULL;
+    }
+
+    // The metadata of each block lives next to its size, so there is one slot per slot of the size buffer
+    size_t slot_count = p_mux->p_allocator->size_cb.max_capacity;
+    p_mux->stream_count = stream_count;
+    p_mux->p_streams = (allocator_mux_stream_t*)malloc(stream_count * sizeof(allocator_mux_stream_t));
+    p_mux->pp_slot_blocks = (uint8_t**)malloc(slot_count * sizeof(uint8_t*));
+    p_mux->p_next_in_stream = (size_t*)malloc(slot_count * sizeof(size_t));
+    p_mux->p_next_in_lane = (size_t*)malloc(slot_count * sizeof(size_t));
+    p_mux->p_slot_streams = (uint16_t*)malloc(slot_count * sizeof(uint16_t));
+    p_mux->p_slot_freed = (uint8_t*)calloc(slot_count, sizeof(uint8_t));
+
+    if ((p_mux->p_streams == NULL) ||
+        (p_mux->pp_slot_blocks == NULL) ||
+        (p_mux->p_next_in_stream == NULL) ||
+        (p_mux->p_next_in_lane == NULL) ||
+        (p_mux->p_slot_streams == NULL) ||
+        (p_mux->p_slot_freed == NULL)) {
+        free_mux(p_mux);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < stream_count; i++) {
+        p_mux->p_streams[i].first_slot = ALLOCATOR_MUX_NO_SLOT;
+        p_mux->p_streams[i].last_slot = ALLOCATOR_MUX_NO_SLOT;
+        p_mux->p_streams[i].block_count = 0;
+        p_mux->p_streams[i].lane = 0;
+    }
+
+    for (size_t i = 0; i < ALLOCATOR_MUX_LANES; i++) {
+        p_mux->lanes[i].first_slot = ALLOCATOR_MUX_NO_SLOT;
+        p_mux->lanes[i].last_slot = ALLOCATOR_MUX_NO_SLOT;
+    }
+
+    return p_mux;
+}
+
+/**
+ * @brief       Uninitializes a multiplexed allocator instance.
+ *
+ * @param[in] p_mux             pointer to allocator instance
+ */
+void allocator_mux_uninit(allocator_mux_t* p_mux) {
+    free_mux(p_mux);
+}
+
+/**
+ * @brief       Moves a stream to a different priority lane. The stream must be empty.
+ *
+ * @param[in] p_mux             pointer to allocator
+ * @param[in] stream_id         id of the stream
+ * @param[in] lane              lane from 0 (highest priority) to ALLOCATOR_MUX_LANES - 1
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the stream was moved
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if the stream doesn't exist
+ *                              - ALLOCATOR_ERROR_UNSUPPORTED_SIZE if the lane doesn't exist
+ *                              - ALLOCATOR_ERROR_NOT_EMPTY if the stream still holds blocks
+ */
+allocator_error_t allocator_mux_set_lane(allocator_mux_t* p_mux, uint16_t stream_id, uint8_t lane) {
+    if (stream_id >= p_mux->stream_count) {
+        return ALLOCATOR_ERROR_NOT_FOUND;
+    }
+    if (lane >= ALLOCATOR_MUX_LANES) {
+        return ALLOCATOR_ERROR_UNSUPPORTED_SIZE;
+    }
+
+    // The blocks of a stream are linked in the lane they were allocated in, moving
+    // them would break the order allocator_mux_peek_next() relies on
+    if (p_mux->p_streams[stream_id].block_count > 0) {
+        return ALLOCATOR_ERROR_NOT_EMPTY;
+    }
+
+    p_mux->p_streams[stream_id].lane = lane;
+    return ALLOCATOR_SUCCESS;
+}
+
+/**
+ * @brief       Allocates a block of a given size in a stream.
+ *
+ * @param[in]  p_mux            pointer to allocator
+ * @param[in]  stream_id        id of the stream
+ * @param[in]  block_size       size of the block to allocate
+ * @param[out] pp_block         pointer to pointer to allocated block
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the block was allocated
+ *                              - ALLOCATOR_ERROR_OUT_OF_MEMORY if the shared buffer is full
+ *                              - ALLOCATOR_ERROR_UNSUPPORTED_SIZE if the requested block size is not supported
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if the stream doesn't exist
+ */
+allocator_error_t allocator_mux_alloc(allocator_mux_t* p_mux, uint16_t stream_id, size_t block_size, uint8_t** pp_block) {
+    if (stream_id >= p_mux->stream_count) {
+        return ALLOCATOR_ERROR_NOT_FOUND;
+    }
+
+    // The block is going to take the slot at the head of the size buffer
+    size_t slot = p_mux->p_allocator->size_cb.head;
+    allocator_error_t result = allocator_alloc(p_mux->p_allocator, block_size, pp_block);
+
+    if (result != ALLOCATOR_SUCCESS) {
+        return result;
+    }
+
+    allocator_mux_stream_t* p_stream = &p_mux->p_streams[stream_id];
+    allocator_mux_lane_t* p_lane = &p_mux->lanes[p_stream->lane];
+
+    p_mux->pp_slot_blocks[slot] = *pp_block;
+    p_mux->p_slot_streams[slot] = stream_id;
+    p_mux->p_next_in_stream[slot] = ALLOCATOR_MUX_NO_SLOT;
+    p_mux->p_next_in_lane[slot] = ALLOCATOR_MUX_NO_SLOT;
+
+    // Append the block to the stream
+    if (p_stream->first_slot == ALLOCATOR_MUX_NO_SLOT) {
+        p_stream->first_slot = slot;
+    } else {
+        p_mux->p_next_in_stream[p_stream->last_slot] = slot;
+    }
+    p_stream->last_slot = slot;
+    p_stream->block_count++;
+
+    // And to its lane
+    if (p_lane->first_slot == ALLOCATOR_MUX_NO_SLOT) {
+        p_lane->first_slot = slot;
+    } else {
+        p_mux->p_next_in_lane[p_lane->last_slot] = slot;
+    }
+    p_lane->last_slot = slot;
+
+    return ALLOCATOR_SUCCESS;
+}
+
+/**
+ * @brief       Peeks at the oldest block allocated in a stream.
+ *
+ * @param[in]  p_mux            pointer to allocator
+ * @param[in]  stream_id        id of the stream
+ * @param[out] pp_block         pointer to pointer to data block
+ * @param[out] p_block_size     pointer to block size
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if there was a block to peek at
+ *                              - ALLOCATOR_ERROR_NOT_FOUND otherwise
+ */
+allocator_error_t allocator_mux_peek(allocator_mux_t* p_mux, uint16_t stream_id, uint8_t** pp_block, size_t* p_block_size) {
+    if ((stream_id >= p_mux->stream_count) || (p_mux->p_streams[stream_id].block_count == 0)) {
+        return ALLOCATOR_ERROR_NOT_FOUND;
+    }
+
+    size_t slot = p_mux->p_streams[stream_id].first_slot;
+    *pp_block = p_mux->pp_slot_blocks[slot];
+    *p_block_size = p_mux->p_allocator->p_block_sizes[slot];
+    return ALLOCATOR_SUCCESS;
+}
+
+/**
+ * @brief       Peeks at the oldest block of the highest priority lane that isn't empty.
+ *
+ * @param[in]  p_mux            pointer to allocator
+ * @param[out] p_stream_id      pointer to the id of the stream the block belongs to
+ * @param[out] pp_block         pointer to pointer to data block
+ * @param[out] p_block_size     pointer to block size
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if there was a block to peek at
+ *                              - ALLOCATOR_ERROR_NOT_FOUND otherwise
+ */
+allocator_error_t allocator_mux_peek_next(allocator_mux_t* p_mux, uint16_t* p_stream_id, uint8_t** pp_block, size_t* p_block_size) {
+    for (size_t i = 0; i < ALLOCATOR_MUX_LANES; i++) {
+        size_t slot = p_mux->lanes[i].first_slot;
+
+        // The oldest block of a lane is always the oldest block of its stream,
+        // so it can be freed with allocator_mux_free() on that stream
+        if (slot != ALLOCATOR_MUX_NO_SLOT) {
+            *p_stream_id = p_mux->p_slot_streams[slot];
+            *pp_block = p_mux->pp_slot_blocks[slot];
+            *p_block_size = p_mux->p_allocator->p_block_sizes[slot];
+            return ALLOCATOR_SUCCESS;
+        }
+    }
+
+    return ALLOCATOR_ERROR_NOT_FOUND;
+}
+
+/**
+ * @brief       Frees the oldest block allocated in a stream.
+ *
+ * @param[in] p_mux             pointer to allocator
+ * @param[in] stream_id         id of the stream
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if a block was freed
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if there was nothing to free
+ */
+allocator_error_t allocator_mux_free(allocator_mux_t* p_mux, uint16_t stream_id) {
+    if ((stream_id >= p_mux->stream_count) || (p_mux->p_streams[stream_id].block_count == 0)) {
+        return ALLOCATOR_ERROR_NOT_FOUND;
+    }
+
+    allocator_mux_stream_t* p_stream = &p_mux->p_streams[stream_id];
+    size_t slot = p_stream->first_slot;
+
+    // Remove the block from its stream
+    p_stream->first_slot = p_mux->p_next_in_stream[slot];
+    p_stream->block_count--;
+    if (p_stream->block_count == 0) {
+        p_stream->last_slot = ALLOCATOR_MUX_NO_SLOT;
+    }
+
+    // The block is only removed from its lane once it gets to the front of it
+    p_mux->p_slot_freed[slot] = true;
+    skip_freed_lane_blocks(p_mux, &p_mux->lanes[p_stream->lane]);
+
+    reclaim_freed_blocks(p_mux);
+    return ALLOCATOR_SUCCESS;
+}
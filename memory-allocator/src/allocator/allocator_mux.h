@@ -0,0 +1,145 @@
+#ifndef ALLOCATOR_MUX_H_
+#define ALLOCATOR_MUX_H_
+
+#include "allocator.h"
+#include "stddef.h"
+#include "stdint.h"
+
+// Number of priority lanes, lane 0 has the highest priority
+#define ALLOCATOR_MUX_LANES 4
+
+// Marks the end of the per-stream and per-lane lists of blocks
+#define ALLOCATOR_MUX_NO_SLOT SIZE_MAX
+
+typedef struct {
+    size_t first_slot;   // Oldest block of the stream that hasn't been freed
+    size_t last_slot;    // Newest block of the stream
+    size_t block_count;
+    uint8_t lane;
+} allocator_mux_stream_t;
+
+typedef struct {
+    size_t first_slot;   // Oldest block of the lane that hasn't been freed
+    size_t last_slot;    // Newest block of the lane
+} allocator_mux_lane_t;
+
+typedef struct {
+    allocator_t* p_allocator;
+    allocator_mux_stream_t* p_streams;
+    size_t stream_count;
+    allocator_mux_lane_t lanes[ALLOCATOR_MUX_LANES];
+
+    // Per block metadata, indexed by the slot of the block in the size buffer of p_allocator
+    uint8_t** pp_slot_blocks;
+    size_t* p_next_in_stream;
+    size_t* p_next_in_lane;
+    uint16_t* p_slot_streams;
+    uint8_t* p_slot_freed;
+} allocator_mux_t;
+
+/**
+ * @brief       Initializes a multiplexed allocator hosting several logical streams in one buffer.
+ *
+ * Every block belongs to a stream, and each stream is peeked and freed in FIFO order
+ * independently of the others. Blocks freed out of order are reclaimed once all the
+ * blocks allocated before them have been freed as well.
+ *
+ * @param[in] buffer_size       size of the shared buffer
+ * @param[in] min_block_size    minimum size of a block in the shared buffer
+ * @param[in] max_block_size    maximum size of a block in the shared buffer
+ * @param[in] stream_count      number of streams, all of them start in lane 0
+ *
+ * @return allocator_mux_t*     pointer to allocator instance
+ *                              NULL in case of allocation error
+ */
+allocator_mux_t* allocator_mux_init(size_t buffer_size,
+                                    uint8_t min_block_size,
+                                    uint8_t max_block_size,
+                                    uint16_t stream_count);
+
+/**
+ * @brief       Uninitializes a multiplexed allocator instance.
+ *
+ * @param[in] p_mux             pointer to allocator instance
+ */
+void allocator_mux_uninit(allocator_mux_t* p_mux);
+
+/**
+ * @brief       Moves a stream to a different priority lane. The stream must be empty.
+ *
+ * @param[in] p_mux             pointer to allocator
+ * @param[in] stream_id         id of the stream
+ * @param[in] lane              lane from 0 (highest priority) to ALLOCATOR_MUX_LANES - 1
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the stream was moved
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if the stream doesn't exist
+ *                              - ALLOCATOR_ERROR_UNSUPPORTED_SIZE if the lane doesn't exist
+ *                              - ALLOCATOR_ERROR_NOT_EMPTY if the stream still holds blocks
+ */
+allocator_error_t allocator_mux_set_lane(allocator_mux_t* p_mux,
+                                         uint16_t stream_id,
+                                         uint8_t lane);
+
+/**
+ * @brief       Allocates a block of a given size in a stream.
+ *
+ * @param[in]  p_mux            pointer to allocator
+ * @param[in]  stream_id        id of the stream
+ * @param[in]  block_size       size of the block to allocate
+ * @param[out] pp_block         pointer to pointer to allocated block
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the block was allocated
+ *                              - ALLOCATOR_ERROR_OUT_OF_MEMORY if the shared buffer is full
+ *                              - ALLOCATOR_ERROR_UNSUPPORTED_SIZE if the requested block size is not supported
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if the stream doesn't exist
+ */
+allocator_error_t allocator_mux_alloc(allocator_mux_t* p_mux,
+                                      uint16_t stream_id,
+                                      size_t block_size,
+                                      uint8_t** pp_block);
+
+/**
+ * @brief       Peeks at the oldest block allocated in a stream.
+ *
+ * @param[in]  p_mux            pointer to allocator
+ * @param[in]  stream_id        id of the stream
+ * @param[out] pp_block         pointer to pointer to data block
+ * @param[out] p_block_size     pointer to block size
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if there was a block to peek at
+ *                              - ALLOCATOR_ERROR_NOT_FOUND otherwise
+ */
+allocator_error_t allocator_mux_peek(allocator_mux_t* p_mux,
+                                     uint16_t stream_id,
+                                     uint8_t** pp_block,
+                                     size_t* p_block_size);
+
+/**
+ * @brief       Peeks at the oldest block of the highest priority lane that isn't empty.
+ *
+ * @param[in]  p_mux            pointer to allocator
+ * @param[out] p_stream_id      pointer to the id of the stream the block belongs to
+ * @param[out] pp_block         pointer to pointer to data block
+ * @param[out] p_block_size     pointer to block size
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if there was a block to peek at
+ *                              - ALLOCATOR_ERROR_NOT_FOUND otherwise
+ */
+allocator_error_t allocator_mux_peek_next(allocator_mux_t* p_mux,
+                                          uint16_t* p_stream_id,
+                                          uint8_t** pp_block,
+                                          size_t* p_block_size);
+
+/**
+ * @brief       Frees the oldest block allocated in a stream.
+ *
+ * @param[in] p_mux             pointer to allocator
+ * @param[in] stream_id         id of the stream
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if a block was freed
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if there was nothing to free
+ */
+allocator_error_t allocator_mux_free(allocator_mux_t* p_mux,
+                                     uint16_t stream_id);
+
+#endif  // ALLOCATOR_MUX_H_
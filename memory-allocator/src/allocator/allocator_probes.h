@@ -0,0 +1,30 @@
+#ifndef ALLOCATOR_PROBES_H_
+#define ALLOCATOR_PROBES_H_
+
+// Static tracepoints in the allocator provider, which can be attached to in a running process
+// with SystemTap, bpftrace or perf, e.g. `bpftrace -e 'usdt:./app:allocator:alloc { @[arg1] = count(); }'`.
+//
+// When sys/sdt.h is available every probe compiles to a single NOP plus a note in the .note.stapsdt
+// ELF section telling the tracer where to find the arguments. The arguments are still evaluated every
+// time the probe is passed, traced or not, so they should stay as cheap as a field or an atomic load.
+// Without sys/sdt.h, or when ALLOCATOR_NO_PROBES is defined, the probes compile to nothing. Their
+// arguments are then only named in sizeof, which doesn't evaluate them, so they don't go unused.
+
+#if !defined(ALLOCATOR_NO_PROBES) && defined(__has_include)
+#if __has_include("sys/sdt.h")
+#include "sys/sdt.h"
+#define ALLOCATOR_PROBES_ENABLED
+#endif
+#endif
+
+#if defined(ALLOCATOR_PROBES_ENABLED)
+#define ALLOCATOR_PROBE2(name, a1, a2)             DTRACE_PROBE2(allocator, name, a1, a2)
+#define ALLOCATOR_PROBE3(name, a1, a2, a3)         DTRACE_PROBE3(allocator, name, a1, a2, a3)
+#define ALLOCATOR_PROBE4(name, a1, a2, a3, a4)     DTRACE_PROBE4(allocator, name, a1, a2, a3, a4)
+#else
+#define ALLOCATOR_PROBE2(name, a1, a2)             do { (void)sizeof(a1); (void)sizeof(a2); } while (0)
+#define ALLOCATOR_PROBE3(name, a1, a2, a3)         do { ALLOCATOR_PROBE2(name, a1, a2); (void)sizeof(a3); } while (0)
+#define ALLOCATOR_PROBE4(name, a1, a2, a3, a4)     do { ALLOCATOR_PROBE3(name, a1, a2, a3); (void)sizeof(a4); } while (0)
+#endif
+
+#endif  // ALLOCATOR_PROBES_H_
@@ -0,0 +1,207 @@
+#include "allocator_segmented.h"
+
+#include "stdlib.h"
+
+static allocator_segment_t* create_segment(allocator_segmented_t* p_allocator) {
+    allocator_segment_t* p_segment = (allocator_segment_t*)malloc(sizeof(allocator_segment_t));
+
+    if (p_segment == NULL) {
+        return NULL;
+    }
+
+    p_segment->p_allocator = allocator_init(p_allocator->segment_size,
+                                            p_allocator->min_block_size,
+                                            p_allocator->max_block_size);
+    p_segment->p_next = NULL;
+
+    if (p_segment->p_allocator == NULL) {
+        free(p_segment);
+        return NULL;
+    }
+
+    return p_segment;
+}
+
+static void destroy_segment(allocator_segment_t* p_segment) {
+    allocator_uninit(p_segment->p_allocator);
+    free(p_segment);
+}
+
+static void destroy_segment_list(allocator_segment_t* p_segment) {
+    while (p_segment != NULL) {
+        allocator_segment_t* p_next = p_segment->p_next;
+        destroy_segment(p_segment);
+        p_segment = p_next;
+    }
+}
+
+// Takes an empty segment from the pool, or creates a new one if the pool is empty
+static allocator_segment_t* acquire_segment(allocator_segmented_t* p_allocator) {
+    allocator_segment_t* p_segment = p_allocator->p_pool;
+
+    if (p_segment == NULL) {
+        return create_segment(p_allocator);
+    }
+
+    p_allocator->p_pool = p_segment->p_next;
+    p_allocator->pooled_count--;
+    p_segment->p_next = NULL;
+    return p_segment;
+}
+
+// Returns an empty segment to the pool, or destroys it if the pool is full
+static void release_segment(allocator_segmented_t* p_allocator, allocator_segment_t* p_segment) {
+    if (p_allocator->pooled_count >= p_allocator->max_pooled_segments) {
+        destroy_segment(p_segment);
+        return;
+    }
+
+    // Rewind the empty segment so that it's filled from the start of its buffer when reused
+    p_segment->p_allocator->data_cb.head = 0;
+    p_segment->p_allocator->data_cb.tail = 0;
+    p_segment->p_allocator->size_cb.head = 0;
+    p_segment->p_allocator->size_cb.tail = 0;
+
+    p_segment->p_next = p_allocator->p_pool;
+    p_allocator->p_pool = p_segment;
+    p_allocator->pooled_count++;
+}
+
+/**
+ * @brief       Initializes a segmented allocator instance.
+ *
+ * A segmented allocator is a chain of ring buffer segments. When the newest segment is full
+ * a new one is linked at the head, and segments left empty by the tail are returned to a pool,
+ * so the memory used follows the actual backlog. Blocks are never copied or moved.
+ *
+ * @param[in] segment_size          size of the buffer of each segment, at least max_block_size
+ * @param[in] min_block_size        minimum size of a block in the allocator
+ * @param[in] max_block_size        maximum size of a block in the allocator
+ * @param[in] max_pooled_segments   number of empty segments kept around for reuse
+ *
+ * @return allocator_segmented_t*   pointer to allocator instance
+ *                                  NULL in case of allocation error or invalid sizes
+ */
+allocator_segmented_t* allocator_segmented_init(size_t segment_size,
+                                                uint8_t min_block_size,
+                                                uint8_t max_block_size,
+                                                size_t max_pooled_segments) {
+    // A segment that can't hold the biggest block would make us add segments forever
+    if ((min_block_size == 0) || (segment_size < max_block_size)) {
+        return NULL;
+    }
+
+    allocator_segmented_t* p_allocator = (allocator_segmented_t*)malloc(sizeof(allocator_segmented_t));
+
+    if (p_allocator == NULL) {
+        return NULL;
+    }
+
+    p_allocator->segment_size = segment_size;
+    p_allocator->min_block_size = min_block_size;
+    p_allocator->max_block_size = max_block_size;
+    p_allocator->max_pooled_segments = max_pooled_segments;
+    p_allocator->p_pool = NULL;
+    p_allocator->pooled_count = 0;
+
+    // There is always at least one segment in the chain
+    p_allocator->p_head = create_segment(p_allocator);
+    p_allocator->p_tail = p_allocator->p_head;
+    p_allocator->segment_count = 1;
+
+    if (p_allocator->p_head == NULL) {
+        free(p_allocator);
+        return NULL;
+    }
+
+    return p_allocator;
+}
+
+/**
+ * @brief       Uninitializes a segmented allocator instance.
+ *
+ * @param[in] p_allocator       pointer to allocator instance
+ */
+void allocator_segmented_uninit(allocator_segmented_t* p_allocator) {
+    destroy_segment_list(p_allocator->p_tail);
+    destroy_segment_list(p_allocator->p_pool);
+    free(p_allocator);
+}
+
+/**
+ * @brief       Allocates a block of a given size, adding a segment if needed.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[in]  block_size       size of the block to allocate
+ * @param[out] pp_block         pointer to pointer to allocated block
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the block was allocated
+ *                              - ALLOCATOR_ERROR_OUT_OF_MEMORY if a new segment couldn't be allocated
+ *                              - ALLOCATOR_ERROR_UNSUPPORTED_SIZE if the requested block size is not supported
+ */
+allocator_error_t allocator_segmented_alloc(allocator_segmented_t* p_allocator, size_t block_size, uint8_t** pp_block) {
+    allocator_error_t result = allocator_alloc(p_allocator->p_head->p_allocator, block_size, pp_block);
+
+    if (result != ALLOCATOR_ERROR_OUT_OF_MEMORY) {
+        return result;
+    }
+
+    // The newest segment is full, link a new one at the head. The blocks in the
+    // full segment stay where they are until the tail gets to them
+    allocator_segment_t* p_segment = acquire_segment(p_allocator);
+
+    if (p_segment == NULL) {
+        return ALLOCATOR_ERROR_OUT_OF_MEMORY;
+    }
+
+    p_allocator->p_head->p_next = p_segment;
+    p_allocator->p_head = p_segment;
+    p_allocator->segment_count++;
+
+    return allocator_alloc(p_segment->p_allocator, block_size, pp_block);
+}
+
+/**
+ * @brief       Peeks at the oldest block allocated.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[out] pp_block         pointer to pointer to data block
+ * @param[out] p_block_size     pointer to block size
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if there was a block to peek at
+ *                              - ALLOCATOR_ERROR_NOT_FOUND otherwise
+ */
+allocator_error_t allocator_segmented_peek(allocator_segmented_t* p_allocator, uint8_t** pp_block, size_t* p_block_size) {
+    // Empty segments are released as soon as the tail leaves them, so if the
+    // oldest segment is empty the whole allocator is empty
+    return allocator_peek(p_allocator->p_tail->p_allocator, pp_block, p_block_size);
+}
+
+/**
+ * @brief       Frees the oldest block allocated, releasing its segment if it becomes empty.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if a block was freed
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if there was nothing to free
+ */
+allocator_error_t allocator_segmented_free(allocator_segmented_t* p_allocator) {
+    allocator_segment_t* p_segment = p_allocator->p_tail;
+    allocator_error_t result = allocator_free(p_segment->p_allocator);
+
+    if (result != ALLOCATOR_SUCCESS) {
+        return result;
+    }
+
+    // The newest segment is kept even when empty, we still need somewhere to allocate
+    uint8_t* p_block;
+    size_t block_size;
+    if ((p_segment != p_allocator->p_head) &&
+        (allocator_peek(p_segment->p_allocator, &p_block, &block_size) == ALLOCATOR_ERROR_NOT_FOUND)) {
+        p_allocator->p_tail = p_segment->p_next;
+        p_allocator->segment_count--;
+        release_segment(p_allocator, p_segment);
+    }
+
+    return ALLOCATOR_SUCCESS;
+}
@@ -0,0 +1,91 @@
+#ifndef ALLOCATOR_SEGMENTED_H_
+#define ALLOCATOR_SEGMENTED_H_
+
+#include "allocator.h"
+#include "stddef.h"
+#include "stdint.h"
+
+typedef struct allocator_segment {
+    allocator_t* p_allocator;
+    struct allocator_segment* p_next;  // Next newer segment in the chain, or next segment in the pool
+} allocator_segment_t;
+
+typedef struct {
+    allocator_segment_t* p_head;  // Newest segment, blocks are allocated here
+    allocator_segment_t* p_tail;  // Oldest segment, blocks are peeked and freed here
+    allocator_segment_t* p_pool;  // Empty segments waiting to be reused
+    size_t segment_size;
+    size_t segment_count;         // Number of segments in the chain
+    size_t pooled_count;          // Number of segments in the pool
+    size_t max_pooled_segments;
+    uint8_t min_block_size;
+    uint8_t max_block_size;
+} allocator_segmented_t;
+
+/**
+ * @brief       Initializes a segmented allocator instance.
+ *
+ * A segmented allocator is a chain of ring buffer segments. When the newest segment is full
+ * a new one is linked at the head, and segments left empty by the tail are returned to a pool,
+ * so the memory used follows the actual backlog. Blocks are never copied or moved.
+ *
+ * @param[in] segment_size          size of the buffer of each segment, at least max_block_size
+ * @param[in] min_block_size        minimum size of a block in the allocator
+ * @param[in] max_block_size        maximum size of a block in the allocator
+ * @param[in] max_pooled_segments   number of empty segments kept around for reuse
+ *
+ * @return allocator_segmented_t*   pointer to allocator instance
+ *                                  NULL in case of allocation error or invalid sizes
+ */
+allocator_segmented_t* allocator_segmented_init(size_t segment_size,
+                                                uint8_t min_block_size,
+                                                uint8_t max_block_size,
+                                                size_t max_pooled_segments);
+
+/**
+ * @brief       Uninitializes a segmented allocator instance.
+ *
+ * @param[in] p_allocator       pointer to allocator instance
+ */
+void allocator_segmented_uninit(allocator_segmented_t* p_allocator);
+
+/**
+ * @brief       Allocates a block of a given size, adding a segment if needed.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[in]  block_size       size of the block to allocate
+ * @param[out] pp_block         pointer to pointer to allocated block
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if the block was allocated
+ *                              - ALLOCATOR_ERROR_OUT_OF_MEMORY if a new segment couldn't be allocated
+ *                              - ALLOCATOR_ERROR_UNSUPPORTED_SIZE if the requested block size is not supported
+ */
+allocator_error_t allocator_segmented_alloc(allocator_segmented_t* p_allocator,
+                                            size_t block_size,
+                                            uint8_t** pp_block);
+
+/**
+ * @brief       Peeks at the oldest block allocated.
+ *
+ * @param[in]  p_allocator      pointer to allocator
+ * @param[out] pp_block         pointer to pointer to data block
+ * @param[out] p_block_size     pointer to block size
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if there was a block to peek at
+ *                              - ALLOCATOR_ERROR_NOT_FOUND otherwise
+ */
+allocator_error_t allocator_segmented_peek(allocator_segmented_t* p_allocator,
+                                           uint8_t** pp_block,
+                                           size_t* p_block_size);
+
+/**
+ * @brief       Frees the oldest block allocated, releasing its segment if it becomes empty.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ *
+ * @return allocator_error_t    - ALLOCATOR_SUCCESS if a block was freed
+ *                              - ALLOCATOR_ERROR_NOT_FOUND if there was nothing to free
+ */
+allocator_error_t allocator_segmented_free(allocator_segmented_t* p_allocator);
+
+#endif  // ALLOCATOR_SEGMENTED_H_
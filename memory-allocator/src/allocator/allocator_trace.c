@@ -0,0 +1,291 @@
+#include "allocator_trace.h"
+#include "timing.h"
+
+#include "errno.h"
+#include "fcntl.h"
+#include "pthread.h"
+#include "stdlib.h"
+#include "string.h"
+#include "unistd.h"
+
+typedef struct {
+    uint8_t data[ALLOCATOR_TRACE_BUFFER_SIZE];
+    size_t length;
+    uint32_t generation;  // Trace the records in the buffer belong to
+} trace_buffer_t;
+
+uint32_t allocator_trace_generation = 0;
+
+static __thread trace_buffer_t* p_thread_buffer = NULL;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t buffer_key;
+
+// Protect the file and the start of the trace, the buffers themselves are only touched by their thread
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int trace_fd = -1;
+static uint64_t start_ticks = 0;
+static uint32_t last_generation = 0;
+static uint32_t next_allocator_id = 0;
+
+static void write_all(const uint8_t* p_data, size_t size) {
+    while (size > 0) {
+        ssize_t result = write(trace_fd, p_data, size);
+        if (result < 0) {
+            // Retry if interrupted, anything else would only make the trace incomplete
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        p_data += result;
+        size -= (size_t)result;
+    }
+}
+
+// Records hold ticks while buffered, they are only converted to nanoseconds when written.
+// Must be called with trace_mutex held
+static void write_buffer_locked(trace_buffer_t* p_buffer) {
+    if ((p_buffer->generation == allocator_trace_generation) && (trace_fd >= 0)) {
+        for (size_t offset = 0; offset < p_buffer->length; offset += sizeof(allocator_trace_record_t)) {
+            allocator_trace_record_t* p_record = (allocator_trace_record_t*)&p_buffer->data[offset];
+            p_record->time_ns = (p_record->time_ns > start_ticks) ? timing_ticks_to_ns(p_record->time_ns - start_ticks) : 0;
+            if (p_record->op == ALLOCATOR_TRACE_OP_INIT) {
+                offset += sizeof(allocator_trace_config_t);
+            }
+        }
+        write_all(p_buffer->data, p_buffer->length);
+    }
+    p_buffer->length = 0;
+}
+
+static void write_buffer(trace_buffer_t* p_buffer) {
+    pthread_mutex_lock(&trace_mutex);
+    write_buffer_locked(p_buffer);
+    pthread_mutex_unlock(&trace_mutex);
+}
+
+static void release_buffer(void* p_buffer) {
+    write_buffer((trace_buffer_t*)p_buffer);
+    free(p_buffer);
+}
+
+static void create_key(void) {
+    pthread_key_create(&buffer_key, release_buffer);
+}
+
+static trace_buffer_t* get_thread_buffer(void) {
+    if (p_thread_buffer == NULL) {
+        pthread_once(&key_once, create_key);
+        p_thread_buffer = (trace_buffer_t*)malloc(sizeof(trace_buffer_t));
+        if (p_thread_buffer != NULL) {
+            p_thread_buffer->length = 0;
+            p_thread_buffer->generation = 0;
+            pthread_setspecific(buffer_key, p_thread_buffer);
+        }
+    }
+    return p_thread_buffer;
+}
+
+// Makes room for size bytes in the buffer and returns where to put them
+static uint8_t* reserve(trace_buffer_t* p_buffer, size_t size) {
+    if (p_buffer->length + size > ALLOCATOR_TRACE_BUFFER_SIZE) {
+        write_buffer(p_buffer);
+    }
+    uint8_t* p_data = &p_buffer->data[p_buffer->length];
+    p_buffer->length += size;
+    return p_data;
+}
+
+#if defined(ALLOCATOR_TRACE)
+__attribute__((constructor)) static void start_from_environment(void) {
+    const char* p_path = getenv("ALLOCATOR_TRACE");
+    if ((p_path != NULL) && (*p_path != '\0') && (allocator_trace_start(p_path) == true)) {
+        atexit(allocator_trace_stop);
+    }
+}
+#endif
+
+/**
+ * @brief       Starts recording the operations of every allocator to a file.
+ *
+ * Operations are only recorded when the allocator is built with ALLOCATOR_TRACE defined. The trace is
+ * also started at startup when the ALLOCATOR_TRACE environment variable holds a path, and stopped at exit.
+ *
+ * @param[in] p_path            path of the trace, truncated if it exists
+ *
+ * @return bool                 - true if the trace was started
+ *                              - false if a trace is already being recorded or the file couldn't be created
+ */
+bool allocator_trace_start(const char* p_path) {
+    // Calibrating takes a few milliseconds, better done before anything is being timed
+    timing_calibrate();
+
+    pthread_mutex_lock(&trace_mutex);
+    if (trace_fd >= 0) {
+        pthread_mutex_unlock(&trace_mutex);
+        return false;
+    }
+
+    trace_fd = open(p_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (trace_fd < 0) {
+        pthread_mutex_unlock(&trace_mutex);
+        return false;
+    }
+
+    const allocator_trace_header_t header = {
+        .magic = ALLOCATOR_TRACE_MAGIC,
+        .version = ALLOCATOR_TRACE_VERSION,
+    };
+    write_all((const uint8_t*)&header, sizeof(header));
+
+    // Generations tell the records of this trace apart from the ones left in buffers by previous traces
+    start_ticks = timing_now_ticks();
+    last_generation++;
+    if (last_generation == 0) {
+        last_generation++;
+    }
+    __atomic_store_n(&allocator_trace_generation, last_generation, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&trace_mutex);
+    return true;
+}
+
+/**
+ * @brief       Stops recording and closes the trace.
+ *
+ * The buffer of the calling thread is written out. Other threads write theirs when they call
+ * allocator_trace_flush(), when their buffer is full and when they exit, so records they still
+ * hold once the trace is stopped are lost.
+ */
+void allocator_trace_stop(void) {
+    pthread_mutex_lock(&trace_mutex);
+    if (p_thread_buffer != NULL) {
+        write_buffer_locked(p_thread_buffer);
+    }
+    __atomic_store_n(&allocator_trace_generation, 0, __ATOMIC_RELEASE);
+    if (trace_fd >= 0) {
+        close(trace_fd);
+        trace_fd = -1;
+    }
+    pthread_mutex_unlock(&trace_mutex);
+}
+
+/**
+ * @brief       Writes the buffer of the calling thread to the trace.
+ */
+void allocator_trace_flush(void) {
+    if ((p_thread_buffer != NULL) && (p_thread_buffer->length > 0)) {
+        write_buffer(p_thread_buffer);
+    }
+}
+
+/**
+ * @brief       Returns a new allocator id, called by allocator_init().
+ *
+ * @return uint32_t             id, unique within the process
+ */
+uint32_t allocator_trace_next_id(void) {
+    return __atomic_fetch_add(&next_allocator_id, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief       Records an operation in the buffer of the calling thread.
+ *
+ * The configuration of the allocator is recorded first if it isn't in the trace yet,
+ * so allocators created before the trace was started can be replayed as well.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] op                one of ALLOCATOR_TRACE_OP_*
+ * @param[in] size              block size
+ * @param[in] result            result of the operation
+ */
+void allocator_trace_record(allocator_t* p_allocator, allocator_trace_op_t op, size_t size, allocator_error_t result) {
+    uint32_t generation = __atomic_load_n(&allocator_trace_generation, __ATOMIC_ACQUIRE);
+    if (generation == 0) {
+        return;
+    }
+
+    uint64_t ticks = timing_now_ticks();
+    trace_buffer_t* p_buffer = get_thread_buffer();
+    if (p_buffer == NULL) {
+        return;
+    }
+
+    // Drop whatever a previous trace left behind
+    if (p_buffer->generation != generation) {
+        p_buffer->length = 0;
+        p_buffer->generation = generation;
+    }
+
+    // Whichever thread first touches the allocator in this trace records its configuration.
+    // The plain load keeps the locked exchange out of the common path
+    if ((__atomic_load_n(&p_allocator->trace_generation, __ATOMIC_RELAXED) != generation) &&
+        (__atomic_exchange_n(&p_allocator->trace_generation, generation, __ATOMIC_RELAXED) != generation)) {
+        allocator_trace_record_t* p_init = (allocator_trace_record_t*)reserve(p_buffer, sizeof(allocator_trace_record_t) + sizeof(allocator_trace_config_t));
+        p_init->time_ns = ticks;
+        p_init->allocator_id = p_allocator->trace_id;
+        p_init->size = 0;
+        p_init->op = ALLOCATOR_TRACE_OP_INIT;
+        p_init->result = ALLOCATOR_SUCCESS;
+
+        allocator_trace_config_t* p_config = (allocator_trace_config_t*)&p_init[1];
+        memset(p_config, 0, sizeof(allocator_trace_config_t));
+        p_config->buffer_size = p_allocator->data_cb.max_capacity - 1;
+        p_config->min_block_size = p_allocator->min_block_size;
+        p_config->max_block_size = p_allocator->max_block_size;
+
+        if (op == ALLOCATOR_TRACE_OP_INIT) {
+            return;
+        }
+    }
+
+    allocator_trace_record_t* p_record = (allocator_trace_record_t*)reserve(p_buffer, sizeof(allocator_trace_record_t));
+    p_record->time_ns = ticks;
+    p_record->allocator_id = p_allocator->trace_id;
+    p_record->size = (size < UINT16_MAX) ? (uint16_t)size : UINT16_MAX;
+    p_record->op = (uint8_t)op;
+    p_record->result = (uint8_t)result;
+}
+
+/**
+ * @brief       Opens a trace for reading and checks its header.
+ *
+ * @param[in] p_path            path of the trace
+ *
+ * @return FILE*                file positioned at the first record, to be closed with fclose()
+ *                              NULL if it couldn't be opened or isn't a trace
+ */
+FILE* allocator_trace_open(const char* p_path) {
+    FILE* p_file = fopen(p_path, "rb");
+    if (p_file == NULL) {
+        return NULL;
+    }
+
+    allocator_trace_header_t header;
+    if ((fread(&header, sizeof(header), 1, p_file) != 1) ||
+        (header.magic != ALLOCATOR_TRACE_MAGIC) ||
+        (header.version != ALLOCATOR_TRACE_VERSION)) {
+        fclose(p_file);
+        return NULL;
+    }
+    return p_file;
+}
+
+/**
+ * @brief       Reads the next record of a trace.
+ *
+ * @param[in]  p_file           file returned by allocator_trace_open()
+ * @param[out] p_record         pointer to the record
+ * @param[out] p_config         pointer to the configuration, only written for ALLOCATOR_TRACE_OP_INIT
+ *
+ * @return bool                 - true if a record was read
+ *                              - false at the end of the trace, or if it is truncated
+ */
+bool allocator_trace_read(FILE* p_file, allocator_trace_record_t* p_record, allocator_trace_config_t* p_config) {
+    if (fread(p_record, sizeof(allocator_trace_record_t), 1, p_file) != 1) {
+        return false;
+    }
+    if (p_record->op == ALLOCATOR_TRACE_OP_INIT) {
+        return fread(p_config, sizeof(allocator_trace_config_t), 1, p_file) == 1;
+    }
+    return p_record->op < ALLOCATOR_TRACE_OP_COUNT;
+}
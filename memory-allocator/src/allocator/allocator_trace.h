@@ -0,0 +1,125 @@
+#ifndef ALLOCATOR_TRACE_H_
+#define ALLOCATOR_TRACE_H_
+
+#include "allocator.h"
+#include "stdbool.h"
+#include "stdint.h"
+#include "stdio.h"
+
+// A trace file is an allocator_trace_header_t followed by allocator_trace_record_t records.
+// Every ALLOCATOR_TRACE_OP_INIT record is followed by the allocator_trace_config_t of the allocator.
+// Records of one thread are in order, records of different threads come in chunks of up to
+// ALLOCATOR_TRACE_BUFFER_SIZE bytes and have to be sorted by time_ns for a global order.
+#define ALLOCATOR_TRACE_MAGIC   0x43525441u  // "ATRC"
+#define ALLOCATOR_TRACE_VERSION 1
+
+// Size of the buffer of every traced thread, in bytes
+#define ALLOCATOR_TRACE_BUFFER_SIZE 65536
+
+typedef enum {
+    ALLOCATOR_TRACE_OP_INIT,
+    ALLOCATOR_TRACE_OP_UNINIT,
+    ALLOCATOR_TRACE_OP_ALLOC,
+    ALLOCATOR_TRACE_OP_PEEK,
+    ALLOCATOR_TRACE_OP_FREE,
+    ALLOCATOR_TRACE_OP_COUNT,
+} allocator_trace_op_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+} allocator_trace_header_t;
+
+typedef struct {
+    uint64_t time_ns;       // Since the trace was started
+    uint32_t allocator_id;  // Assigned by allocator_init(), in creation order
+    uint16_t size;          // Block size, 0 for ALLOCATOR_TRACE_OP_INIT and ALLOCATOR_TRACE_OP_UNINIT
+    uint8_t op;             // One of ALLOCATOR_TRACE_OP_*
+    uint8_t result;         // One of ALLOCATOR_*, only alloc can fail since failed peeks and frees aren't recorded
+} allocator_trace_record_t;
+
+typedef struct {
+    uint64_t buffer_size;
+    uint8_t min_block_size;
+    uint8_t max_block_size;
+    uint8_t reserved[6];
+} allocator_trace_config_t;
+
+// Generation of the trace being recorded, 0 while not recording. Read by the hooks in allocator.c
+extern uint32_t allocator_trace_generation;
+
+/**
+ * @brief       Starts recording the operations of every allocator to a file.
+ *
+ * Operations are only recorded when the allocator is built with ALLOCATOR_TRACE defined. The trace is
+ * also started at startup when the ALLOCATOR_TRACE environment variable holds a path, and stopped at exit.
+ *
+ * @param[in] p_path            path of the trace, truncated if it exists
+ *
+ * @return bool                 - true if the trace was started
+ *                              - false if a trace is already being recorded or the file couldn't be created
+ */
+bool allocator_trace_start(const char* p_path);
+
+/**
+ * @brief       Stops recording and closes the trace.
+ *
+ * The buffer of the calling thread is written out. Other threads write theirs when they call
+ * allocator_trace_flush(), when their buffer is full and when they exit, so records they still
+ * hold once the trace is stopped are lost.
+ */
+void allocator_trace_stop(void);
+
+/**
+ * @brief       Writes the buffer of the calling thread to the trace.
+ */
+void allocator_trace_flush(void);
+
+/**
+ * @brief       Returns a new allocator id, called by allocator_init().
+ *
+ * @return uint32_t             id, unique within the process
+ */
+uint32_t allocator_trace_next_id(void);
+
+/**
+ * @brief       Records an operation in the buffer of the calling thread.
+ *
+ * The configuration of the allocator is recorded first if it isn't in the trace yet,
+ * so allocators created before the trace was started can be replayed as well.
+ *
+ * @param[in] p_allocator       pointer to allocator
+ * @param[in] op                one of ALLOCATOR_TRACE_OP_*
+ * @param[in] size              block size
+ * @param[in] result            result of the operation
+ */
+void allocator_trace_record(allocator_t* p_allocator,
+                            allocator_trace_op_t op,
+                            size_t size,
+                            allocator_error_t result);
+
+/**
+ * @brief       Opens a trace for reading and checks its header.
+ *
+ * @param[in] p_path            path of the trace
+ *
+ * @return FILE*                file positioned at the first record, to be closed with fclose()
+ *                              NULL if it couldn't be opened or isn't a trace
+ */
+FILE* allocator_trace_open(const char* p_path);
+
+/**
+ * @brief       Reads the next record of a trace.
+ *
+ * @param[in]  p_file           file returned by allocator_trace_open()
+ * @param[out] p_record         pointer to the record
+ * @param[out] p_config         pointer to the configuration, only written for ALLOCATOR_TRACE_OP_INIT
+ *
+ * @return bool                 - true if a record was read
+ *                              - false at the end of the trace, or if it is truncated
+ */
+bool allocator_trace_read(FILE* p_file,
+                          allocator_trace_record_t* p_record,
+                          allocator_trace_config_t* p_config);
+
+#endif  // ALLOCATOR_TRACE_H_
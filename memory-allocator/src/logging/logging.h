@@ -7,6 +7,26 @@
 
 #include <stdio.h>
 #include <logging_groups.h>
+#include <logging_levels.h>
+#include <logging_limits.h>
+#include <logging_stamp.h>
+
+#include <logging_backend.h>
+
+#if (LOG_BACKEND == LOG_BACKEND_ASYNC) || (LOG_BACKEND == LOG_BACKEND_COMPACT)
+#define LOG_BACKEND_QUEUED		1
+#include <logging_async.h>
+#else
+#define LOG_BACKEND_QUEUED		0
+#endif
+
+#if LOG_BACKEND == LOG_BACKEND_BUFFERED
+#include <logging_sink.h>
+#endif
+
+#if LOG_BACKEND == LOG_BACKEND_FLIGHT
+#include <logging_flight.h>
+#endif
 
 #define LOG_LEVEL_OFF 			0
 #define LOG_LEVEL_ERROR			1
@@ -68,10 +88,81 @@
 #error Missing log configuration: No log level is defined
 #endif
 
+#ifndef LOG_MODULE_GROUP_ID
+#define LOG_MODULE_GROUP_ID LOG_GROUP_ID_DEFAULT
+#endif
+
+// Levels above the LOG_LEVEL of the module are compiled out, the rest are checked against the runtime level
+#define log_enabled(lvl)	(LOG_MODULE_GROUP && LOG_LEVEL >= lvl && log_level_enabled(LOG_MODULE_GROUP_ID, lvl))
+
+#if LOG_BACKEND_QUEUED || (LOG_BACKEND == LOG_BACKEND_FLIGHT)
+
+#if LOG_BACKEND == LOG_BACKEND_FLIGHT
+#define log_binary_write		log_flight_write
+#define log_flush_internal()
+#else
+#define log_binary_write		log_async_write
+#define log_flush_internal()	log_async_flush()
+#endif
+
+// The format string is the first argument of every log macro
+#define log_format(...)				log_format_first(__VA_ARGS__, "")
+#define log_format_first(format, ...)	format
+
+// The call site is described once in a static and the record only carries a pointer to it.
+// Call sites are collected in the log_sites section, where their index is their id in compact streams
+#define log_internal(lvl, color, ...) do { 										\
+	if (log_enabled(lvl))	 													\
+	{																			\
+		static const log_site_t log_site LOG_SITE_ATTRIBUTES = {					\
+			__FILENAME__, log_format(__VA_ARGS__), color, __LINE__, lvl 		\
+		};																		\
+		log_binary_write(&log_site, __VA_ARGS__);								\
+	}																			\
+} while( 0 )
+
+#define log_internal_raw(lvl, ...) do{				 							\
+	if (log_enabled(lvl))														\
+	{																			\
+		static const log_site_t log_site LOG_SITE_ATTRIBUTES = {					\
+			__FILENAME__, log_format(__VA_ARGS__), NULL, __LINE__, lvl 			\
+		};																		\
+		log_binary_write(&log_site, __VA_ARGS__);								\
+	}																			\
+} while( 0 )
+
+#elif LOG_BACKEND == LOG_BACKEND_BUFFERED
+
+#define log_internal(lvl, color, ...) do { 										\
+	if (log_enabled(lvl))	 													\
+	{																			\
+		log_sink_write(color, __FILENAME__, __LINE__, __VA_ARGS__);				\
+	}																			\
+} while( 0 )
+
+#define log_internal_raw(lvl, ...) do{				 							\
+	if (log_enabled(lvl))														\
+	{																			\
+		log_sink_write(NULL, __FILENAME__, __LINE__, __VA_ARGS__);				\
+	}																			\
+} while( 0 )
+
+#define log_flush_internal()	log_sink_flush()
+
+#else
+
+// Records are stamped with the time and the thread they were logged from when LOG_TIMESTAMPS is defined
+#if defined(LOG_TIMESTAMPS)
+#define log_print_stamp()		log_stamp_print()
+#else
+#define log_print_stamp()
+#endif
+
 #define log_internal(lvl, color, ...) do { 										\
-	if (LOG_MODULE_GROUP && LOG_LEVEL >= lvl) 									\
+	if (log_enabled(lvl))	 													\
 	{																			\
 		printf(color); 															\
+		log_print_stamp();														\
 		printf(	"%-28s:%4d: ",		 											\
 			__FILENAME__, 														\
 			__LINE__);			 												\
@@ -81,7 +172,7 @@
 } while( 0 )
 
 #define log_internal_raw(lvl, ...) do{				 							\
-	if (LOG_MODULE_GROUP && LOG_LEVEL >= lvl)									\
+	if (log_enabled(lvl))														\
 	{																			\
 		printf(__VA_ARGS__ ); 													\
 	}																			\
@@ -89,6 +180,8 @@
 
 #define log_flush_internal()
 
+#endif
+
 
 #define log_error(...) 			log_internal(LOG_LEVEL_ERROR, LOG_ERROR_COLOR, __VA_ARGS__)
 #define log_warning(...) 		log_internal(LOG_LEVEL_WARNING, LOG_WARNING_COLOR, __VA_ARGS__)
@@ -107,4 +200,64 @@
 
 #define log_flush() 			log_flush_internal()
 
+// <e> Helper macros for rate limited logging, each call site keeps its own state.
+// When a call site emits again, the number of records it suppressed meanwhile is logged first
+#define log_internal_limited(lvl, color, allow, ...) do {						\
+	if (log_enabled(lvl))	 													\
+	{																			\
+		static uint64_t log_limit_state = 0;									\
+		static uint32_t log_suppressed = 0;										\
+		(void)log_limit_state;													\
+		if (allow)																\
+		{																		\
+			uint32_t log_dropped = __atomic_exchange_n(&log_suppressed, 0, __ATOMIC_RELAXED);	\
+			if (log_dropped > 0)												\
+			{																	\
+				log_internal(lvl, color, "%u records suppressed", log_dropped);	\
+			}																	\
+			log_internal(lvl, color, __VA_ARGS__);								\
+		}																		\
+		else																	\
+		{																		\
+			__atomic_add_fetch(&log_suppressed, 1, __ATOMIC_RELAXED);			\
+		}																		\
+	}																			\
+} while( 0 )
+
+// Emits the 1st, (n+1)th, (2n+1)th... record of the call site, none when n is 0
+#define log_internal_every_n(lvl, color, n, ...) \
+	log_internal_limited(lvl, color, ((n) != 0) && ((__atomic_fetch_add(&log_limit_state, 1, __ATOMIC_RELAXED) % (n)) == 0), __VA_ARGS__)
+
+// Emits each record of the call site with probability p
+#define log_internal_sampled(lvl, color, p, ...) \
+	log_internal_limited(lvl, color, log_sample(p), __VA_ARGS__)
+
+// Emits up to per_second records of the call site per second, with bursts of up to one second worth
+#define log_internal_ratelimited(lvl, color, per_second, ...) \
+	log_internal_limited(lvl, color, log_ratelimit(&log_limit_state, per_second), __VA_ARGS__)
+
+#define log_error_every_n(n, ...)               log_internal_every_n(LOG_LEVEL_ERROR, LOG_ERROR_COLOR, n, __VA_ARGS__)
+#define log_warning_every_n(n, ...)             log_internal_every_n(LOG_LEVEL_WARNING, LOG_WARNING_COLOR, n, __VA_ARGS__)
+#define log_info_every_n(n, ...)                log_internal_every_n(LOG_LEVEL_INFO, LOG_INFO_COLOR, n, __VA_ARGS__)
+#define log_debug_every_n(n, ...)               log_internal_every_n(LOG_LEVEL_DEBUG, LOG_DEBUG_COLOR, n, __VA_ARGS__)
+#define log_trace_every_n(n, ...)               log_internal_every_n(LOG_LEVEL_TRACE, LOG_TRACE_COLOR, n, __VA_ARGS__)
+#define log_trace2_every_n(n, ...)              log_internal_every_n(LOG_LEVEL_TRACE2, LOG_TRACE2_COLOR, n, __VA_ARGS__)
+#define log_highlight_every_n(n, ...)           log_internal_every_n(LOG_LEVEL_HIGHLIGHT, LOG_HIGHLIGHT_COLOR, n, __VA_ARGS__)
+
+#define log_error_sampled(p, ...)               log_internal_sampled(LOG_LEVEL_ERROR, LOG_ERROR_COLOR, p, __VA_ARGS__)
+#define log_warning_sampled(p, ...)             log_internal_sampled(LOG_LEVEL_WARNING, LOG_WARNING_COLOR, p, __VA_ARGS__)
+#define log_info_sampled(p, ...)                log_internal_sampled(LOG_LEVEL_INFO, LOG_INFO_COLOR, p, __VA_ARGS__)
+#define log_debug_sampled(p, ...)               log_internal_sampled(LOG_LEVEL_DEBUG, LOG_DEBUG_COLOR, p, __VA_ARGS__)
+#define log_trace_sampled(p, ...)               log_internal_sampled(LOG_LEVEL_TRACE, LOG_TRACE_COLOR, p, __VA_ARGS__)
+#define log_trace2_sampled(p, ...)              log_internal_sampled(LOG_LEVEL_TRACE2, LOG_TRACE2_COLOR, p, __VA_ARGS__)
+#define log_highlight_sampled(p, ...)           log_internal_sampled(LOG_LEVEL_HIGHLIGHT, LOG_HIGHLIGHT_COLOR, p, __VA_ARGS__)
+
+#define log_error_ratelimited(per_second, ...)  log_internal_ratelimited(LOG_LEVEL_ERROR, LOG_ERROR_COLOR, per_second, __VA_ARGS__)
+#define log_warning_ratelimited(per_second, ...) log_internal_ratelimited(LOG_LEVEL_WARNING, LOG_WARNING_COLOR, per_second, __VA_ARGS__)
+#define log_info_ratelimited(per_second, ...)   log_internal_ratelimited(LOG_LEVEL_INFO, LOG_INFO_COLOR, per_second, __VA_ARGS__)
+#define log_debug_ratelimited(per_second, ...)  log_internal_ratelimited(LOG_LEVEL_DEBUG, LOG_DEBUG_COLOR, per_second, __VA_ARGS__)
+#define log_trace_ratelimited(per_second, ...)  log_internal_ratelimited(LOG_LEVEL_TRACE, LOG_TRACE_COLOR, per_second, __VA_ARGS__)
+#define log_trace2_ratelimited(per_second, ...) log_internal_ratelimited(LOG_LEVEL_TRACE2, LOG_TRACE2_COLOR, per_second, __VA_ARGS__)
+#define log_highlight_ratelimited(per_second, ...) log_internal_ratelimited(LOG_LEVEL_HIGHLIGHT, LOG_HIGHLIGHT_COLOR, per_second, __VA_ARGS__)
+
 #endif //TEMPLATE_LOGGING_H
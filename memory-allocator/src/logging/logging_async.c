@@ -0,0 +1,296 @@
+#include "logging_async.h"
+#include "logging_backend.h"
+#include "logging_compact.h"
+
+#include "errno.h"
+#include "pthread.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+#include "unistd.h"
+
+// How long the background thread sleeps when it finds every ring empty
+#define IDLE_SLEEP_NS 1000000
+
+// Formatted text is collected up to this size before being written with a single call
+#define OUTPUT_BUFFER_SIZE 65536
+
+typedef struct log_async_ring_t {
+    uint8_t buffer[LOG_ASYNC_RING_SIZE];
+    size_t head;              // Free running, only written by the thread that owns the ring
+    size_t tail;              // Free running, only written by the background thread
+    uint64_t dropped;
+    uint64_t reported_dropped;  // Only accessed by the background thread
+    bool owned;
+    struct log_async_ring_t* p_next;
+} log_async_ring_t;
+
+// Rings are never freed, the ring of a thread that exits is taken over by the next thread that logs
+static log_async_ring_t* p_rings = NULL;
+static __thread log_async_ring_t* p_thread_ring = NULL;
+static pthread_once_t start_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ring_key;
+static bool started = false;
+static int output_fd = STDOUT_FILENO;
+static bool compact_output = (LOG_BACKEND == LOG_BACKEND_COMPACT);
+static uint32_t output_generation = 0;  // Changes with the output, which then needs a new dictionary
+static uint64_t flush_requested = 0;
+static uint64_t flush_completed = 0;
+
+// Only accessed by the background thread
+static char output_buffer[OUTPUT_BUFFER_SIZE];
+static size_t output_length = 0;
+static uint32_t dictionary_generation = UINT32_MAX;
+
+static void ring_copy_in(log_async_ring_t* p_ring, size_t position, const uint8_t* p_data, size_t size) {
+    size_t offset = position & (LOG_ASYNC_RING_SIZE - 1);
+    size_t first_part = (size < LOG_ASYNC_RING_SIZE - offset) ? size : (LOG_ASYNC_RING_SIZE - offset);
+    memcpy(&p_ring->buffer[offset], p_data, first_part);
+    memcpy(p_ring->buffer, p_data + first_part, size - first_part);
+}
+
+static void ring_copy_out(const log_async_ring_t* p_ring, size_t position, uint8_t* p_data, size_t size) {
+    size_t offset = position & (LOG_ASYNC_RING_SIZE - 1);
+    size_t first_part = (size < LOG_ASYNC_RING_SIZE - offset) ? size : (LOG_ASYNC_RING_SIZE - offset);
+    memcpy(p_data, &p_ring->buffer[offset], first_part);
+    memcpy(p_data + first_part, p_ring->buffer, size - first_part);
+}
+
+static void write_output(void) {
+    size_t written = 0;
+    int fd = __atomic_load_n(&output_fd, __ATOMIC_RELAXED);
+
+    while (written < output_length) {
+        ssize_t result = write(fd, &output_buffer[written], output_length - written);
+        if (result < 0) {
+            // Retry if interrupted, anything else is not worth reporting from the logger
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        written += (size_t)result;
+    }
+    output_length = 0;
+}
+
+static void append_output(const char* p_text, size_t length) {
+    if (output_length + length > OUTPUT_BUFFER_SIZE) {
+        write_output();
+    }
+    memcpy(&output_buffer[output_length], p_text, length);
+    output_length += length;
+}
+
+static void append_record(const uint8_t* p_record, bool compact) {
+    log_record_header_t header;
+    memcpy(&header, p_record, sizeof(header));
+    const uint8_t* p_arguments = p_record + sizeof(header);
+    size_t arguments_size = header.size - sizeof(header);
+    log_stamp_t stamp;
+    bool stamped = log_record_get_stamp(&header, &stamp);
+
+    if (compact == true) {
+        const log_compact_record_t compact_record = {
+            .site_id = log_compact_get_site_id(header.p_site),
+            .arguments_size = (uint16_t)arguments_size,
+            .flags = (stamped == true) ? LOG_COMPACT_FLAG_STAMPED : 0,
+        };
+        append_output((const char*)&compact_record, sizeof(compact_record));
+        if (stamped == true) {
+            append_output((const char*)&stamp, sizeof(stamp));
+        }
+        append_output((const char*)p_arguments, arguments_size);
+    } else {
+        char text[LOG_RECORD_MAX_TEXT];
+        append_output(text, log_record_format(header.p_site, (stamped == true) ? &stamp : NULL, p_arguments, arguments_size, text, sizeof(text)));
+    }
+}
+
+static size_t drain_ring(log_async_ring_t* p_ring, bool compact) {
+    size_t head = __atomic_load_n(&p_ring->head, __ATOMIC_ACQUIRE);
+    size_t tail = p_ring->tail;
+    size_t records = 0;
+    uint8_t record[LOG_RECORD_MAX_SIZE];
+
+    while (tail != head) {
+        log_record_header_t header;
+        ring_copy_out(p_ring, tail, (uint8_t*)&header, sizeof(header));
+        ring_copy_out(p_ring, tail, record, header.size);
+        append_record(record, compact);
+        tail += header.size;
+        records++;
+    }
+    __atomic_store_n(&p_ring->tail, tail, __ATOMIC_RELEASE);
+
+    // Compact streams have no way to tell about drops
+    uint64_t dropped = __atomic_load_n(&p_ring->dropped, __ATOMIC_RELAXED);
+    if ((compact == false) && (dropped != p_ring->reported_dropped)) {
+        char text[LOG_RECORD_MAX_TEXT];
+        int length = snprintf(text, sizeof(text), "%llu log records dropped\n", (unsigned long long)(dropped - p_ring->reported_dropped));
+        append_output(text, (size_t)length);
+        p_ring->reported_dropped = dropped;
+    }
+    return records;
+}
+
+static void* run_background_thread(void* p_argument) {
+    (void)p_argument;
+
+    while (true) {
+        // Every record queued before a flush was requested is visible once the request is
+        uint64_t requested = __atomic_load_n(&flush_requested, __ATOMIC_ACQUIRE);
+
+        // Every compact stream starts with the dictionary of call sites
+        bool compact = __atomic_load_n(&compact_output, __ATOMIC_RELAXED);
+        uint32_t generation = __atomic_load_n(&output_generation, __ATOMIC_RELAXED);
+        if ((compact == true) && (generation != dictionary_generation)) {
+            log_compact_write_dictionary(append_output);
+            dictionary_generation = generation;
+        }
+
+        size_t records = 0;
+        for (log_async_ring_t* p_ring = __atomic_load_n(&p_rings, __ATOMIC_ACQUIRE); p_ring != NULL; p_ring = p_ring->p_next) {
+            records += drain_ring(p_ring, compact);
+        }
+        write_output();
+        __atomic_store_n(&flush_completed, requested, __ATOMIC_RELEASE);
+
+        if (records == 0) {
+            struct timespec idle = { .tv_sec = 0, .tv_nsec = IDLE_SLEEP_NS };
+            nanosleep(&idle, NULL);
+        }
+    }
+    return NULL;
+}
+
+static void release_ring(void* p_ring) {
+    __atomic_store_n(&((log_async_ring_t*)p_ring)->owned, false, __ATOMIC_RELEASE);
+}
+
+static void start_background_thread(void) {
+    pthread_t thread;
+
+    if (pthread_key_create(&ring_key, release_ring) != 0) {
+        return;
+    }
+    if (pthread_create(&thread, NULL, run_background_thread, NULL) != 0) {
+        return;
+    }
+    pthread_detach(thread);
+
+    // Don't lose the records still queued when the process exits normally
+    atexit(log_async_flush);
+    __atomic_store_n(&started, true, __ATOMIC_RELEASE);
+}
+
+static log_async_ring_t* get_thread_ring(void) {
+    if (p_thread_ring != NULL) {
+        return p_thread_ring;
+    }
+
+    pthread_once(&start_once, start_background_thread);
+    if (__atomic_load_n(&started, __ATOMIC_ACQUIRE) == false) {
+        return NULL;
+    }
+
+    // Take over the ring of a thread that has exited if there is one
+    for (log_async_ring_t* p_ring = __atomic_load_n(&p_rings, __ATOMIC_ACQUIRE); p_ring != NULL; p_ring = p_ring->p_next) {
+        bool expected = false;
+        if (__atomic_compare_exchange_n(&p_ring->owned, &expected, true, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) == true) {
+            p_thread_ring = p_ring;
+            break;
+        }
+    }
+
+    if (p_thread_ring == NULL) {
+        log_async_ring_t* p_ring = (log_async_ring_t*)calloc(1, sizeof(log_async_ring_t));
+        if (p_ring == NULL) {
+            return NULL;
+        }
+
+        p_ring->owned = true;
+        p_ring->p_next = __atomic_load_n(&p_rings, __ATOMIC_RELAXED);
+        while (__atomic_compare_exchange_n(&p_rings, &p_ring->p_next, p_ring, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED) == false) {
+        }
+        p_thread_ring = p_ring;
+    }
+
+    pthread_setspecific(ring_key, p_thread_ring);
+    return p_thread_ring;
+}
+
+/**
+ * @brief       Queues a log record on the ring of the calling thread.
+ *
+ * The arguments are encoded as a binary record, which is formatted and written later by a background thread.
+ * Nothing is locked and nothing is formatted on the calling thread. If the ring is full the record is dropped,
+ * and the number of dropped records is reported by the background thread.
+ *
+ * @param[in] p_site            pointer to the call site
+ * @param[in] p_format          format string of the call site, only used to let the compiler check the arguments
+ */
+void log_async_write(const log_site_t* p_site, const char* p_format, ...) {
+    (void)p_format;
+
+    log_async_ring_t* p_ring = get_thread_ring();
+    if (p_ring == NULL) {
+        return;
+    }
+
+    uint8_t record[LOG_RECORD_MAX_SIZE];
+    va_list args;
+    va_start(args, p_format);
+    size_t size = log_record_encode(record, sizeof(record), p_site, args);
+    va_end(args);
+
+    size_t head = p_ring->head;
+    size_t tail = __atomic_load_n(&p_ring->tail, __ATOMIC_ACQUIRE);
+    if (LOG_ASYNC_RING_SIZE - (head - tail) < size) {
+        __atomic_add_fetch(&p_ring->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    // Publish the record only once it has been copied completely
+    ring_copy_in(p_ring, head, record, size);
+    __atomic_store_n(&p_ring->head, head + size, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief       Waits until every record queued before the call has been written.
+ */
+void log_async_flush(void) {
+    if (__atomic_load_n(&started, __ATOMIC_ACQUIRE) == false) {
+        return;
+    }
+
+    uint64_t ticket = __atomic_add_fetch(&flush_requested, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&flush_completed, __ATOMIC_ACQUIRE) < ticket) {
+        struct timespec pause = { .tv_sec = 0, .tv_nsec = IDLE_SLEEP_NS / 10 };
+        nanosleep(&pause, NULL);
+    }
+}
+
+/**
+ * @brief       Selects the file descriptor the background thread writes to, stdout by default.
+ *
+ * @param[in] fd                file descriptor
+ */
+void log_async_set_output(int fd) {
+    __atomic_store_n(&output_fd, fd, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&output_generation, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief       Selects whether the background thread writes compact binary records or text.
+ *
+ * Compact output is the default of the compact backend, see logging_compact.h for the format.
+ *
+ * @param[in] enable            true to write compact records
+ */
+void log_async_set_compact(bool enable) {
+    __atomic_store_n(&compact_output, enable, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&output_generation, 1, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,45 @@
+#ifndef LOGGING_ASYNC_H_
+#define LOGGING_ASYNC_H_
+
+#include "logging_record.h"
+#include "stdbool.h"
+
+// Size of the ring of every logging thread, in bytes. Must be a power of two
+#define LOG_ASYNC_RING_SIZE 65536
+
+/**
+ * @brief       Queues a log record on the ring of the calling thread.
+ *
+ * The arguments are encoded as a binary record, which is formatted and written later by a background thread.
+ * Nothing is locked and nothing is formatted on the calling thread. If the ring is full the record is dropped,
+ * and the number of dropped records is reported by the background thread.
+ *
+ * @param[in] p_site            pointer to the call site
+ * @param[in] p_format          format string of the call site, only used to let the compiler check the arguments
+ */
+void log_async_write(const log_site_t* p_site,
+                     const char* p_format,
+                     ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief       Waits until every record queued before the call has been written.
+ */
+void log_async_flush(void);
+
+/**
+ * @brief       Selects the file descriptor the background thread writes to, stdout by default.
+ *
+ * @param[in] fd                file descriptor
+ */
+void log_async_set_output(int fd);
+
+/**
+ * @brief       Selects whether the background thread writes compact binary records or text.
+ *
+ * Compact output is the default of the compact backend, see logging_compact.h for the format.
+ *
+ * @param[in] enable            true to write compact records
+ */
+void log_async_set_compact(bool enable);
+
+#endif  // LOGGING_ASYNC_H_
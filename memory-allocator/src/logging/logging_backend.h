@@ -0,0 +1,20 @@
+#ifndef LOGGING_BACKEND_H_
+#define LOGGING_BACKEND_H_
+
+// Backends of logging.h, selected with the LOG_BACKEND CMake option
+// printf:   every record is formatted and printed on the calling thread
+// async:    records are queued in binary form and formatted by a background thread, see logging_async.h
+// compact:  like async, but the background thread writes the binary records, see logging_compact.h
+// buffered: records are formatted on the calling thread into a buffer written in batches, see logging_sink.h
+// flight:   records are kept in binary form in an in-memory ring, dumped on demand or on crash, see logging_flight.h
+#define LOG_BACKEND_PRINTF   0
+#define LOG_BACKEND_ASYNC    1
+#define LOG_BACKEND_COMPACT  2
+#define LOG_BACKEND_BUFFERED 3
+#define LOG_BACKEND_FLIGHT   4
+
+#ifndef LOG_BACKEND
+#define LOG_BACKEND LOG_BACKEND_PRINTF
+#endif
+
+#endif  // LOGGING_BACKEND_H_
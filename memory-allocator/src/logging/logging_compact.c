@@ -0,0 +1,181 @@
+#include "logging_compact.h"
+
+#include "stdlib.h"
+#include "string.h"
+
+// Defined by the linker only if there is something in the log_sites section
+extern const log_site_t __start_log_sites[] __attribute__((weak));
+extern const log_site_t __stop_log_sites[] __attribute__((weak));
+
+static char* read_string(FILE* p_file) {
+    char buffer[LOG_RECORD_MAX_TEXT];
+    size_t length = 0;
+    int character;
+
+    while ((length < sizeof(buffer)) && ((character = fgetc(p_file)) != EOF)) {
+        buffer[length++] = (char)character;
+        if (character == '\0') {
+            return strdup(buffer);
+        }
+    }
+    return NULL;
+}
+
+static void free_sites(log_compact_reader_t* p_reader) {
+    for (uint32_t i = 0; i < p_reader->site_count; i++) {
+        free((char*)p_reader->p_sites[i].p_file);
+        free((char*)p_reader->p_sites[i].p_format);
+        free((char*)p_reader->p_sites[i].p_color);
+    }
+    free(p_reader->p_sites);
+    p_reader->p_sites = NULL;
+    p_reader->site_count = 0;
+}
+
+static bool read_dictionary(log_compact_reader_t* p_reader, uint32_t site_count) {
+    free_sites(p_reader);
+
+    p_reader->p_sites = (log_site_t*)calloc((site_count > 0) ? site_count : 1, sizeof(log_site_t));
+    if (p_reader->p_sites == NULL) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < site_count; i++) {
+        log_site_t* p_site = &p_reader->p_sites[i];
+        uint8_t fixed[4];
+
+        // Count the site right away so that whatever is read gets freed
+        p_reader->site_count = i + 1;
+        if (fread(fixed, sizeof(fixed), 1, p_reader->p_file) != 1) {
+            return false;
+        }
+        memcpy(&p_site->line, fixed, sizeof(p_site->line));
+        p_site->level = fixed[2];
+
+        p_site->p_file = read_string(p_reader->p_file);
+        p_site->p_format = read_string(p_reader->p_file);
+        p_site->p_color = read_string(p_reader->p_file);
+        if ((p_site->p_file == NULL) || (p_site->p_format == NULL) || (p_site->p_color == NULL)) {
+            return false;
+        }
+
+        if ((fixed[3] & LOG_COMPACT_FLAG_RAW) != 0) {
+            free((char*)p_site->p_color);
+            p_site->p_color = NULL;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief       Returns the id of a call site, its index in the log_sites section.
+ *
+ * @param[in] p_site            pointer to the call site
+ *
+ * @return uint32_t             id of the call site
+ *                              LOG_COMPACT_UNKNOWN_SITE if the site is not in the log_sites section
+ */
+uint32_t log_compact_get_site_id(const log_site_t* p_site) {
+    if ((p_site < __start_log_sites) || (p_site >= __stop_log_sites)) {
+        return LOG_COMPACT_UNKNOWN_SITE;
+    }
+    return (uint32_t)(p_site - __start_log_sites);
+}
+
+/**
+ * @brief       Writes the dictionary that starts a compact stream.
+ *
+ * @param[in] write             function called with each part of the dictionary
+ */
+void log_compact_write_dictionary(log_compact_write_t write) {
+    const log_compact_header_t header = {
+        .magic = LOG_COMPACT_MAGIC,
+        .site_count = (uint32_t)(__stop_log_sites - __start_log_sites),
+    };
+    write((const char*)&header, sizeof(header));
+
+    for (const log_site_t* p_site = __start_log_sites; p_site < __stop_log_sites; p_site++) {
+        const char* p_color = (p_site->p_color != NULL) ? p_site->p_color : "";
+        char fixed[4];
+
+        memcpy(fixed, &p_site->line, sizeof(p_site->line));
+        fixed[2] = (char)p_site->level;
+        fixed[3] = (p_site->p_color == NULL) ? LOG_COMPACT_FLAG_RAW : 0;
+        write(fixed, sizeof(fixed));
+        write(p_site->p_file, strlen(p_site->p_file) + 1);
+        write(p_site->p_format, strlen(p_site->p_format) + 1);
+        write(p_color, strlen(p_color) + 1);
+    }
+}
+
+/**
+ * @brief       Starts reading a compact stream.
+ *
+ * @param[out] p_reader         pointer to reader
+ * @param[in]  p_file           file the stream is read from
+ */
+void log_compact_reader_init(log_compact_reader_t* p_reader, FILE* p_file) {
+    p_reader->p_file = p_file;
+    p_reader->p_sites = NULL;
+    p_reader->site_count = 0;
+}
+
+/**
+ * @brief       Frees the dictionary held by a reader.
+ *
+ * @param[in] p_reader          pointer to reader
+ */
+void log_compact_reader_uninit(log_compact_reader_t* p_reader) {
+    free_sites(p_reader);
+}
+
+/**
+ * @brief       Reads the next record of a compact stream and formats it.
+ *
+ * @param[in]  p_reader         pointer to reader
+ * @param[out] p_text           pointer to text buffer
+ * @param[in]  text_size        size of the text buffer, at least 2
+ *
+ * @return bool                 - true if a record was read
+ *                              - false at the end of the stream or if the stream is corrupt
+ */
+bool log_compact_read(log_compact_reader_t* p_reader, char* p_text, size_t text_size) {
+    log_compact_record_t record;
+    uint8_t arguments[LOG_RECORD_MAX_SIZE];
+
+    while (true) {
+        if (fread(&record.site_id, sizeof(record.site_id), 1, p_reader->p_file) != 1) {
+            return false;
+        }
+
+        // A new stream starts with its own dictionary
+        if (record.site_id == LOG_COMPACT_MAGIC) {
+            uint32_t site_count;
+            if ((fread(&site_count, sizeof(site_count), 1, p_reader->p_file) != 1) ||
+                (read_dictionary(p_reader, site_count) == false)) {
+                return false;
+            }
+            continue;
+        }
+
+        if (fread((uint8_t*)&record + sizeof(record.site_id), sizeof(record) - sizeof(record.site_id), 1, p_reader->p_file) != 1) {
+            return false;
+        }
+        log_stamp_t stamp;
+        bool stamped = ((record.flags & LOG_COMPACT_FLAG_STAMPED) != 0);
+        if ((stamped == true) && (fread(&stamp, sizeof(stamp), 1, p_reader->p_file) != 1)) {
+            return false;
+        }
+        if ((record.arguments_size > sizeof(arguments)) ||
+            ((record.arguments_size > 0) && (fread(arguments, record.arguments_size, 1, p_reader->p_file) != 1))) {
+            return false;
+        }
+
+        if (record.site_id >= p_reader->site_count) {
+            snprintf(p_text, text_size, "Unknown log call site %u\n", record.site_id);
+        } else {
+            log_record_format(&p_reader->p_sites[record.site_id], (stamped == true) ? &stamp : NULL, arguments, record.arguments_size, p_text, text_size);
+        }
+        return true;
+    }
+}
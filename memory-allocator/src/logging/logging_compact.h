@@ -0,0 +1,84 @@
+#ifndef LOGGING_COMPACT_H_
+#define LOGGING_COMPACT_H_
+
+#include "logging_record.h"
+#include "stdbool.h"
+#include "stdio.h"
+
+// A compact stream starts with a dictionary of every call site in the log_sites section:
+//   log_compact_header_t, then for every site in id order:
+//   uint16_t line, uint8_t level, uint8_t flags, file, format and color as terminated strings
+// followed by records made of a log_compact_record_t, a log_stamp_t if the record is stamped, and the binary arguments.
+// A stream can be followed by another one, which starts with its own dictionary.
+#define LOG_COMPACT_MAGIC        0x43474f4cu  // "LOGC"
+#define LOG_COMPACT_UNKNOWN_SITE UINT32_MAX   // Call site not in the log_sites section
+#define LOG_COMPACT_FLAG_RAW     0x01         // Flag of a call site in the dictionary
+#define LOG_COMPACT_FLAG_STAMPED 0x0001       // Flag of a record followed by its stamp
+
+typedef struct {
+    uint32_t magic;
+    uint32_t site_count;
+} log_compact_header_t;
+
+typedef struct {
+    uint32_t site_id;
+    uint16_t arguments_size;
+    uint16_t flags;
+} log_compact_record_t;
+
+typedef void (*log_compact_write_t)(const char* p_data, size_t size);
+
+typedef struct {
+    FILE* p_file;
+    log_site_t* p_sites;
+    uint32_t site_count;
+} log_compact_reader_t;
+
+/**
+ * @brief       Returns the id of a call site, its index in the log_sites section.
+ *
+ * @param[in] p_site            pointer to the call site
+ *
+ * @return uint32_t             id of the call site
+ *                              LOG_COMPACT_UNKNOWN_SITE if the site is not in the log_sites section
+ */
+uint32_t log_compact_get_site_id(const log_site_t* p_site);
+
+/**
+ * @brief       Writes the dictionary that starts a compact stream.
+ *
+ * @param[in] write             function called with each part of the dictionary
+ */
+void log_compact_write_dictionary(log_compact_write_t write);
+
+/**
+ * @brief       Starts reading a compact stream.
+ *
+ * @param[out] p_reader         pointer to reader
+ * @param[in]  p_file           file the stream is read from
+ */
+void log_compact_reader_init(log_compact_reader_t* p_reader,
+                             FILE* p_file);
+
+/**
+ * @brief       Frees the dictionary held by a reader.
+ *
+ * @param[in] p_reader          pointer to reader
+ */
+void log_compact_reader_uninit(log_compact_reader_t* p_reader);
+
+/**
+ * @brief       Reads the next record of a compact stream and formats it.
+ *
+ * @param[in]  p_reader         pointer to reader
+ * @param[out] p_text           pointer to text buffer
+ * @param[in]  text_size        size of the text buffer, at least 2
+ *
+ * @return bool                 - true if a record was read
+ *                              - false at the end of the stream or if the stream is corrupt
+ */
+bool log_compact_read(log_compact_reader_t* p_reader,
+                      char* p_text,
+                      size_t text_size);
+
+#endif  // LOGGING_COMPACT_H_
@@ -0,0 +1,153 @@
+#include "logging_flight.h"
+#include "logging_compact.h"
+
+#include "errno.h"
+#include "fcntl.h"
+#include "signal.h"
+#include "stdarg.h"
+#include "string.h"
+#include "unistd.h"
+
+typedef struct {
+    uint64_t sequence;  // Sequence number of the record + 1 once it is complete, 0 while it is being written
+    uint8_t record[LOG_FLIGHT_SLOT_SIZE - sizeof(uint64_t)];
+} log_flight_slot_t;
+
+static log_flight_slot_t slots[LOG_FLIGHT_SLOTS];
+static uint64_t next_sequence = 0;
+
+// Only used while dumping
+static int dump_fd = -1;
+static char crash_path[256];
+static const int crash_signals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+
+static void write_dump(const char* p_data, size_t size) {
+    while (size > 0) {
+        ssize_t result = write(dump_fd, p_data, size);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        p_data += result;
+        size -= (size_t)result;
+    }
+}
+
+static void handle_crash(int signal_number) {
+    // errno is restored in case the signal interrupted code that was checking it
+    int saved_errno = errno;
+    int fd = open(crash_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        log_flight_dump(fd);
+        close(fd);
+    }
+    errno = saved_errno;
+
+    // SA_RESETHAND has restored the default action already
+    raise(signal_number);
+}
+
+/**
+ * @brief       Records a log call in the flight recorder.
+ *
+ * The arguments are copied in binary form into the next slot of a ring shared by all threads.
+ * Nothing is formatted and nothing is written until the ring is dumped.
+ *
+ * @param[in] p_site            pointer to the call site, which must be in the log_sites section to be dumped
+ * @param[in] p_format          format string of the call site, only used to let the compiler check the arguments
+ */
+void log_flight_write(const log_site_t* p_site, const char* p_format, ...) {
+    uint64_t sequence = __atomic_fetch_add(&next_sequence, 1, __ATOMIC_RELAXED);
+    log_flight_slot_t* p_slot = &slots[sequence & (LOG_FLIGHT_SLOTS - 1)];
+
+    // Mark the slot as being written before touching the record, so that a dump never takes a torn one
+    __atomic_store_n(&p_slot->sequence, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    va_list args;
+    va_start(args, p_format);
+    log_record_encode(p_slot->record, sizeof(p_slot->record), p_site, args);
+    va_end(args);
+
+    __atomic_store_n(&p_slot->sequence, sequence + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief       Writes the records in the flight recorder, oldest first, as a compact stream.
+ *
+ * The stream can be turned into text with the log_decode tool. Only async-signal-safe functions are called,
+ * so the recorder can be dumped from a signal handler. Records being written while dumping are skipped.
+ *
+ * @param[in] fd                file descriptor to write to
+ */
+void log_flight_dump(int fd) {
+    dump_fd = fd;
+    log_compact_write_dictionary(write_dump);
+
+    uint64_t end = __atomic_load_n(&next_sequence, __ATOMIC_ACQUIRE);
+    uint64_t start = (end > LOG_FLIGHT_SLOTS) ? (end - LOG_FLIGHT_SLOTS) : 0;
+    uint8_t record[sizeof(slots[0].record)];
+
+    for (uint64_t sequence = start; sequence < end; sequence++) {
+        log_flight_slot_t* p_slot = &slots[sequence & (LOG_FLIGHT_SLOTS - 1)];
+
+        // Copy the record and check that it wasn't overwritten meanwhile
+        if (__atomic_load_n(&p_slot->sequence, __ATOMIC_ACQUIRE) != sequence + 1) {
+            continue;
+        }
+        memcpy(record, p_slot->record, sizeof(record));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&p_slot->sequence, __ATOMIC_RELAXED) != sequence + 1) {
+            continue;
+        }
+
+        log_record_header_t header;
+        log_stamp_t stamp;
+        memcpy(&header, record, sizeof(header));
+        bool stamped = log_record_get_stamp(&header, &stamp);
+        const log_compact_record_t compact_record = {
+            .site_id = log_compact_get_site_id(header.p_site),
+            .arguments_size = (uint16_t)(header.size - sizeof(header)),
+            .flags = (stamped == true) ? LOG_COMPACT_FLAG_STAMPED : 0,
+        };
+        write_dump((const char*)&compact_record, sizeof(compact_record));
+        if (stamped == true) {
+            write_dump((const char*)&stamp, sizeof(stamp));
+        }
+        write_dump((const char*)&record[sizeof(header)], compact_record.arguments_size);
+    }
+    dump_fd = -1;
+}
+
+/**
+ * @brief       Dumps the flight recorder to a file when the process crashes.
+ *
+ * Handlers are installed for SIGSEGV, SIGBUS, SIGILL, SIGFPE and SIGABRT. After dumping, the default action
+ * of the signal is restored and the signal is raised again.
+ *
+ * @param[in] p_path            path of the file, truncated if it exists
+ *
+ * @return bool                 - true if the handlers were installed
+ *                              - false otherwise
+ */
+bool log_flight_dump_on_crash(const char* p_path) {
+    if (strlen(p_path) >= sizeof(crash_path)) {
+        return false;
+    }
+    strcpy(crash_path, p_path);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_crash;
+    action.sa_flags = SA_RESETHAND | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+
+    for (size_t i = 0; i < sizeof(crash_signals) / sizeof(crash_signals[0]); i++) {
+        if (sigaction(crash_signals[i], &action, NULL) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
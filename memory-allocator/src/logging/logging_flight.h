@@ -0,0 +1,49 @@
+#ifndef LOGGING_FLIGHT_H_
+#define LOGGING_FLIGHT_H_
+
+#include "logging_record.h"
+#include "stdbool.h"
+
+// Number of records kept by the flight recorder, the oldest ones are overwritten. Must be a power of two
+#define LOG_FLIGHT_SLOTS 4096
+
+// Space for each record, arguments that don't fit are left out when the record is dumped
+#define LOG_FLIGHT_SLOT_SIZE 256
+
+/**
+ * @brief       Records a log call in the flight recorder.
+ *
+ * The arguments are copied in binary form into the next slot of a ring shared by all threads.
+ * Nothing is formatted and nothing is written until the ring is dumped.
+ *
+ * @param[in] p_site            pointer to the call site, which must be in the log_sites section to be dumped
+ * @param[in] p_format          format string of the call site, only used to let the compiler check the arguments
+ */
+void log_flight_write(const log_site_t* p_site,
+                      const char* p_format,
+                      ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief       Writes the records in the flight recorder, oldest first, as a compact stream.
+ *
+ * The stream can be turned into text with the log_decode tool. Only async-signal-safe functions are called,
+ * so the recorder can be dumped from a signal handler. Records being written while dumping are skipped.
+ *
+ * @param[in] fd                file descriptor to write to
+ */
+void log_flight_dump(int fd);
+
+/**
+ * @brief       Dumps the flight recorder to a file when the process crashes.
+ *
+ * Handlers are installed for SIGSEGV, SIGBUS, SIGILL, SIGFPE and SIGABRT. After dumping, the default action
+ * of the signal is restored and the signal is raised again.
+ *
+ * @param[in] p_path            path of the file, truncated if it exists
+ *
+ * @return bool                 - true if the handlers were installed
+ *                              - false otherwise
+ */
+bool log_flight_dump_on_crash(const char* p_path);
+
+#endif  // LOGGING_FLIGHT_H_
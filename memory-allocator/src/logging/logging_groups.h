@@ -11,4 +11,14 @@
 #define LOG_GROUP_DEFAULT 1
 #endif
 
+#ifndef LOG_GROUP_ALLOCATOR
+#define LOG_GROUP_ALLOCATOR 1
+#endif
+
+// Ids of the groups, used to look up their runtime level. Names are in logging_levels.c
+
+#define LOG_GROUP_ID_DEFAULT	0
+#define LOG_GROUP_ID_ALLOCATOR	1
+#define LOG_GROUP_COUNT			2
+
 #endif //TEMPLATE_LOGGING_GROUPS_H
@@ -0,0 +1,154 @@
+#include "logging_levels.h"
+#include "logging_groups.h"
+
+#include "signal.h"
+#include "stdlib.h"
+#include "string.h"
+
+// Indexed by LOG_GROUP_ID_*
+static const char* group_names[LOG_GROUP_COUNT] = { "default", "allocator" };
+
+// Indexed by LOG_LEVEL_*
+static const char* level_names[] = { "off", "error", "warning", "info", "debug", "trace", "trace2" };
+#define LEVEL_COUNT (sizeof(level_names) / sizeof(level_names[0]))
+
+uint8_t log_levels[LOG_GROUP_COUNT] = { [0 ... LOG_GROUP_COUNT - 1] = LOG_RUNTIME_LEVEL_DEFAULT };
+
+// Levels once LOG_LEVELS has been applied, restored by SIGUSR2
+static uint8_t startup_levels[LOG_GROUP_COUNT];
+
+static bool parse_level(const char* p_name, uint8_t* p_level) {
+    for (size_t i = 0; i < LEVEL_COUNT; i++) {
+        if (strcmp(p_name, level_names[i]) == 0) {
+            *p_level = (uint8_t)i;
+            return true;
+        }
+    }
+
+    char* p_end;
+    long level = strtol(p_name, &p_end, 10);
+    if ((*p_name == '\0') || (*p_end != '\0') || (level < 0) || (level >= (long)LEVEL_COUNT)) {
+        return false;
+    }
+    *p_level = (uint8_t)level;
+    return true;
+}
+
+static bool apply_pair(const char* p_pair, size_t length) {
+    char pair[64];
+    if (length >= sizeof(pair)) {
+        return false;
+    }
+    memcpy(pair, p_pair, length);
+    pair[length] = '\0';
+
+    char* p_separator = strchr(pair, '=');
+    uint8_t level;
+    if ((p_separator == NULL) || (parse_level(p_separator + 1, &level) == false)) {
+        return false;
+    }
+    *p_separator = '\0';
+
+    bool found = false;
+    for (uint8_t i = 0; i < LOG_GROUP_COUNT; i++) {
+        if ((strcmp(pair, "all") == 0) || (strcmp(pair, group_names[i]) == 0)) {
+            log_set_level(i, level);
+            found = true;
+        }
+    }
+    return found;
+}
+
+static void handle_signal(int signal_number) {
+    for (size_t i = 0; i < LOG_GROUP_COUNT; i++) {
+        if (signal_number == SIGUSR1) {
+            uint8_t level = __atomic_load_n(&log_levels[i], __ATOMIC_RELAXED);
+            if (level + 1u < LEVEL_COUNT) {
+                __atomic_store_n(&log_levels[i], level + 1, __ATOMIC_RELAXED);
+            }
+        } else {
+            __atomic_store_n(&log_levels[i], startup_levels[i], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+__attribute__((constructor)) static void load_startup_levels(void) {
+    const char* p_levels = getenv("LOG_LEVELS");
+    if (p_levels != NULL) {
+        log_set_levels(p_levels);
+    }
+    memcpy(startup_levels, log_levels, sizeof(startup_levels));
+}
+
+/**
+ * @brief       Sets the runtime level of a group.
+ *
+ * @param[in] group_id          id of the group, one of LOG_GROUP_ID_*
+ * @param[in] level             one of LOG_LEVEL_*
+ */
+void log_set_level(uint8_t group_id, uint8_t level) {
+    if (group_id < LOG_GROUP_COUNT) {
+        __atomic_store_n(&log_levels[group_id], level, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief       Returns the runtime level of a group.
+ *
+ * @param[in] group_id          id of the group, one of LOG_GROUP_ID_*
+ *
+ * @return uint8_t              one of LOG_LEVEL_*
+ */
+uint8_t log_get_level(uint8_t group_id) {
+    if (group_id >= LOG_GROUP_COUNT) {
+        return 0;
+    }
+    return __atomic_load_n(&log_levels[group_id], __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief       Sets runtime levels from a list of group=level pairs separated by commas.
+ *
+ * Groups are named as LOG_GROUP_ID_* in lower case, "all" sets every group. Levels are named as LOG_LEVEL_*
+ * in lower case or given as numbers, e.g. "all=warning,allocator=debug".
+ *
+ * @param[in] p_levels          pointer to the list
+ *
+ * @return bool                 - true if the whole list was valid
+ *                              - false if some pair was not, the valid pairs are still applied
+ */
+bool log_set_levels(const char* p_levels) {
+    bool valid = true;
+
+    while (*p_levels != '\0') {
+        const char* p_comma = strchr(p_levels, ',');
+        size_t length = (p_comma != NULL) ? (size_t)(p_comma - p_levels) : strlen(p_levels);
+
+        if (apply_pair(p_levels, length) == false) {
+            valid = false;
+        }
+        p_levels += length;
+        if (*p_levels == ',') {
+            p_levels++;
+        }
+    }
+    return valid;
+}
+
+/**
+ * @brief       Installs handlers for SIGUSR1, which raises every group by one level,
+ *              and SIGUSR2, which restores the levels set at startup.
+ *
+ * @return bool                 - true if the handlers were installed
+ *                              - false otherwise
+ */
+bool log_levels_handle_signals(void) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    return (sigaction(SIGUSR1, &action, NULL) == 0) &&
+           (sigaction(SIGUSR2, &action, NULL) == 0);
+}
@@ -0,0 +1,64 @@
+#ifndef LOGGING_LEVELS_H_
+#define LOGGING_LEVELS_H_
+
+#include "stdbool.h"
+#include "stdint.h"
+
+// Runtime levels only lower what the LOG_LEVEL of a module lets through at compile time.
+// They start at LOG_RUNTIME_LEVEL_DEFAULT, which lets everything through, and can be changed:
+// - by calling log_set_level()
+// - at startup with the LOG_LEVELS environment variable, e.g. LOG_LEVELS=default=info,allocator=debug
+// - with SIGUSR1, which raises every group by one level, and SIGUSR2, which restores the startup levels,
+//   once log_levels_handle_signals() has been called
+#ifndef LOG_RUNTIME_LEVEL_DEFAULT
+#define LOG_RUNTIME_LEVEL_DEFAULT 6  // LOG_LEVEL_TRACE2
+#endif
+
+// Runtime level of every group, indexed by LOG_GROUP_ID_*
+extern uint8_t log_levels[];
+
+// Single relaxed load, predicted to fail because most records are above the level in production
+#define log_level_enabled(group_id, lvl) \
+    __builtin_expect(__atomic_load_n(&log_levels[group_id], __ATOMIC_RELAXED) >= (lvl), 0)
+
+/**
+ * @brief       Sets the runtime level of a group.
+ *
+ * @param[in] group_id          id of the group, one of LOG_GROUP_ID_*
+ * @param[in] level             one of LOG_LEVEL_*
+ */
+void log_set_level(uint8_t group_id,
+                   uint8_t level);
+
+/**
+ * @brief       Returns the runtime level of a group.
+ *
+ * @param[in] group_id          id of the group, one of LOG_GROUP_ID_*
+ *
+ * @return uint8_t              one of LOG_LEVEL_*
+ */
+uint8_t log_get_level(uint8_t group_id);
+
+/**
+ * @brief       Sets runtime levels from a list of group=level pairs separated by commas.
+ *
+ * Groups are named as LOG_GROUP_ID_* in lower case, "all" sets every group. Levels are named as LOG_LEVEL_*
+ * in lower case or given as numbers, e.g. "all=warning,allocator=debug".
+ *
+ * @param[in] p_levels          pointer to the list
+ *
+ * @return bool                 - true if the whole list was valid
+ *                              - false if some pair was not, the valid pairs are still applied
+ */
+bool log_set_levels(const char* p_levels);
+
+/**
+ * @brief       Installs handlers for SIGUSR1, which raises every group by one level,
+ *              and SIGUSR2, which restores the levels set at startup.
+ *
+ * @return bool                 - true if the handlers were installed
+ *                              - false otherwise
+ */
+bool log_levels_handle_signals(void);
+
+#endif  // LOGGING_LEVELS_H_
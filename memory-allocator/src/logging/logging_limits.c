@@ -0,0 +1,73 @@
+#include "logging_limits.h"
+
+#include "time.h"
+
+static __thread uint64_t sample_state = 0;
+
+static uint64_t get_coarse_ns(void) {
+    struct timespec now;
+#if defined(CLOCK_MONOTONIC_COARSE)
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#endif
+    return ((uint64_t)now.tv_sec * 1000000000u) + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief       Decides whether to emit a sampled record.
+ *
+ * Uses a generator local to the calling thread, so nothing is shared between threads.
+ *
+ * @param[in] probability       probability of emitting the record, between 0 and 1
+ *
+ * @return bool                 true if the record should be emitted
+ */
+bool log_sample(double probability) {
+    // Seed every thread differently, the address of the state is unique to the thread
+    if (sample_state == 0) {
+        sample_state = ((uint64_t)(uintptr_t)&sample_state ^ get_coarse_ns()) | 1;
+    }
+
+    // xorshift64*
+    sample_state ^= sample_state >> 12;
+    sample_state ^= sample_state << 25;
+    sample_state ^= sample_state >> 27;
+    uint64_t random = sample_state * 0x2545F4914F6CDD1Dull;
+
+    // Top 53 bits as a number in [0, 1)
+    return ((double)(random >> 11) * (1.0 / 9007199254740992.0)) < probability;
+}
+
+/**
+ * @brief       Decides whether to emit a rate limited record.
+ *
+ * Works as a token bucket holding up to one second worth of records, refilled at per_second records per second.
+ * The bucket is kept as the time at which it will be full again, so it is updated with a single compare and swap.
+ *
+ * @param[in] p_state           pointer to the state of the call site, initially 0
+ * @param[in] per_second        records allowed per second
+ *
+ * @return bool                 true if the record should be emitted
+ */
+bool log_ratelimit(uint64_t* p_state, uint32_t per_second) {
+    if (per_second == 0) {
+        return false;
+    }
+
+    const uint64_t interval_ns = 1000000000u / per_second;
+    const uint64_t burst_ns = 1000000000u;
+    uint64_t now_ns = get_coarse_ns();
+    uint64_t full_at_ns = __atomic_load_n(p_state, __ATOMIC_RELAXED);
+
+    while (true) {
+        // Each record takes one interval from the bucket, which is empty once it is a second away from full
+        uint64_t new_full_at_ns = ((full_at_ns > now_ns) ? full_at_ns : now_ns) + interval_ns;
+        if (new_full_at_ns - now_ns > burst_ns) {
+            return false;
+        }
+        if (__atomic_compare_exchange_n(p_state, &full_at_ns, new_full_at_ns, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED) == true) {
+            return true;
+        }
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef LOGGING_LIMITS_H_
+#define LOGGING_LIMITS_H_
+
+#include "stdbool.h"
+#include "stdint.h"
+
+/**
+ * @brief       Decides whether to emit a sampled record.
+ *
+ * Uses a generator local to the calling thread, so nothing is shared between threads.
+ *
+ * @param[in] probability       probability of emitting the record, between 0 and 1
+ *
+ * @return bool                 true if the record should be emitted
+ */
+bool log_sample(double probability);
+
+/**
+ * @brief       Decides whether to emit a rate limited record.
+ *
+ * Works as a token bucket holding up to one second worth of records, refilled at per_second records per second.
+ * The bucket is kept as the time at which it will be full again, so it is updated with a single compare and swap.
+ *
+ * @param[in] p_state           pointer to the state of the call site, initially 0
+ * @param[in] per_second        records allowed per second
+ *
+ * @return bool                 true if the record should be emitted
+ */
+bool log_ratelimit(uint64_t* p_state,
+                   uint32_t per_second);
+
+#endif  // LOGGING_LIMITS_H_
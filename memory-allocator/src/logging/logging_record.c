@@ -0,0 +1,482 @@
+#include "logging_record.h"
+
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+typedef enum {
+    LENGTH_NONE,
+    LENGTH_HH,
+    LENGTH_H,
+    LENGTH_L,
+    LENGTH_LL,
+    LENGTH_J,
+    LENGTH_Z,
+    LENGTH_T,
+    LENGTH_LONG_DOUBLE,
+} length_t;
+
+typedef struct {
+    const char* p_flags;
+    size_t flags_length;
+    const char* p_width;
+    size_t width_length;
+    const char* p_precision;  // NULL if the conversion has no precision
+    size_t precision_length;
+    length_t length;
+    char conversion;
+} conversion_t;
+
+static bool is_star(const char* p_field, size_t field_length) {
+    return (field_length == 1) && (p_field[0] == '*');
+}
+
+static const char* skip_digits(const char* p_format) {
+    while ((*p_format >= '0') && (*p_format <= '9')) {
+        p_format++;
+    }
+    return p_format;
+}
+
+// Parses the conversion specification that follows a '%' and returns a pointer right after it
+static const char* parse_conversion(const char* p_format, conversion_t* p_conversion) {
+    p_conversion->p_flags = p_format;
+    while ((*p_format != '\0') && (strchr("-+ #0'", *p_format) != NULL)) {
+        p_format++;
+    }
+    p_conversion->flags_length = (size_t)(p_format - p_conversion->p_flags);
+
+    p_conversion->p_width = p_format;
+    p_format = (*p_format == '*') ? (p_format + 1) : skip_digits(p_format);
+    p_conversion->width_length = (size_t)(p_format - p_conversion->p_width);
+
+    p_conversion->p_precision = NULL;
+    p_conversion->precision_length = 0;
+    if (*p_format == '.') {
+        p_format++;
+        p_conversion->p_precision = p_format;
+        p_format = (*p_format == '*') ? (p_format + 1) : skip_digits(p_format);
+        p_conversion->precision_length = (size_t)(p_format - p_conversion->p_precision);
+    }
+
+    p_conversion->length = LENGTH_NONE;
+    switch (*p_format) {
+        case 'h':
+            p_conversion->length = (p_format[1] == 'h') ? LENGTH_HH : LENGTH_H;
+            break;
+        case 'l':
+            p_conversion->length = (p_format[1] == 'l') ? LENGTH_LL : LENGTH_L;
+            break;
+        case 'j':
+            p_conversion->length = LENGTH_J;
+            break;
+        case 'z':
+            p_conversion->length = LENGTH_Z;
+            break;
+        case 't':
+            p_conversion->length = LENGTH_T;
+            break;
+        case 'L':
+            p_conversion->length = LENGTH_LONG_DOUBLE;
+            break;
+        default:
+            break;
+    }
+    if ((p_conversion->length == LENGTH_HH) || (p_conversion->length == LENGTH_LL)) {
+        p_format += 2;
+    } else if (p_conversion->length != LENGTH_NONE) {
+        p_format += 1;
+    }
+
+    p_conversion->conversion = *p_format;
+    if (*p_format != '\0') {
+        p_format++;
+    }
+    return p_format;
+}
+
+static int64_t read_signed(va_list* p_args, length_t length) {
+    switch (length) {
+        case LENGTH_HH:
+            return (signed char)va_arg(*p_args, int);
+        case LENGTH_H:
+            return (short)va_arg(*p_args, int);
+        case LENGTH_L:
+            return va_arg(*p_args, long);
+        case LENGTH_LL:
+            return va_arg(*p_args, long long);
+        case LENGTH_J:
+            return va_arg(*p_args, intmax_t);
+        case LENGTH_Z:
+            return (int64_t)va_arg(*p_args, size_t);
+        case LENGTH_T:
+            return va_arg(*p_args, ptrdiff_t);
+        default:
+            return va_arg(*p_args, int);
+    }
+}
+
+static uint64_t read_unsigned(va_list* p_args, length_t length) {
+    switch (length) {
+        case LENGTH_HH:
+            return (unsigned char)va_arg(*p_args, unsigned int);
+        case LENGTH_H:
+            return (unsigned short)va_arg(*p_args, unsigned int);
+        case LENGTH_L:
+            return va_arg(*p_args, unsigned long);
+        case LENGTH_LL:
+            return va_arg(*p_args, unsigned long long);
+        case LENGTH_J:
+            return va_arg(*p_args, uintmax_t);
+        case LENGTH_Z:
+            return va_arg(*p_args, size_t);
+        case LENGTH_T:
+            return (uint64_t)va_arg(*p_args, ptrdiff_t);
+        default:
+            return va_arg(*p_args, unsigned int);
+    }
+}
+
+static bool put_value(uint8_t* p_record, size_t record_size, size_t* p_used, uint64_t value) {
+    if (*p_used + sizeof(value) > record_size) {
+        return false;
+    }
+
+    memcpy(&p_record[*p_used], &value, sizeof(value));
+    *p_used += sizeof(value);
+    return true;
+}
+
+static bool get_value(const uint8_t** pp_data, const uint8_t* p_end, uint64_t* p_value) {
+    if ((size_t)(p_end - *pp_data) < sizeof(*p_value)) {
+        return false;
+    }
+
+    memcpy(p_value, *pp_data, sizeof(*p_value));
+    *pp_data += sizeof(*p_value);
+    return true;
+}
+
+// Appends to the text, which is always kept terminated and never overflows
+static void append(char* p_text, size_t text_size, size_t* p_length, const char* p_format, ...) {
+    if (*p_length + 1 >= text_size) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, p_format);
+    int written = vsnprintf(&p_text[*p_length], text_size - *p_length, p_format, args);
+    va_end(args);
+
+    if (written > 0) {
+        *p_length += (size_t)written;
+        if (*p_length >= text_size) {
+            *p_length = text_size - 1;
+        }
+    }
+}
+
+// Appends a conversion whose spec has been rebuilt up to the length modifier, reading its argument from the record
+static bool append_conversion(char* p_text, size_t text_size, size_t* p_length, char conversion, char* p_spec, size_t spec_size, const uint8_t** pp_data, const uint8_t* p_end) {
+    uint64_t value;
+    size_t spec_length = strlen(p_spec);
+
+    switch (conversion) {
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            if (get_value(pp_data, p_end, &value) == false) {
+                return false;
+            }
+            snprintf(&p_spec[spec_length], spec_size - spec_length, "ll%c", conversion);
+            if ((conversion == 'd') || (conversion == 'i')) {
+                append(p_text, text_size, p_length, p_spec, (long long)value);
+            } else {
+                append(p_text, text_size, p_length, p_spec, (unsigned long long)value);
+            }
+            break;
+        case 'c':
+            if (get_value(pp_data, p_end, &value) == false) {
+                return false;
+            }
+            snprintf(&p_spec[spec_length], spec_size - spec_length, "c");
+            append(p_text, text_size, p_length, p_spec, (int)value);
+            break;
+        case 'p':
+            if (get_value(pp_data, p_end, &value) == false) {
+                return false;
+            }
+            snprintf(&p_spec[spec_length], spec_size - spec_length, "p");
+            append(p_text, text_size, p_length, p_spec, (void*)(uintptr_t)value);
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A': {
+            if (get_value(pp_data, p_end, &value) == false) {
+                return false;
+            }
+            double number;
+            memcpy(&number, &value, sizeof(number));
+            snprintf(&p_spec[spec_length], spec_size - spec_length, "%c", conversion);
+            append(p_text, text_size, p_length, p_spec, number);
+            break;
+        }
+        case 's': {
+            size_t string_length = strnlen((const char*)*pp_data, (size_t)(p_end - (*pp_data)));
+            if (string_length == (size_t)(p_end - (*pp_data))) {
+                return false;
+            }
+            snprintf(&p_spec[spec_length], spec_size - spec_length, "s");
+            append(p_text, text_size, p_length, p_spec, (const char*)*pp_data);
+            *pp_data += string_length + 1;
+            break;
+        }
+        case 'n':
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief       Encodes the arguments of a log call into a binary record.
+ *
+ * Instead of formatting the message, the format string is walked to copy the raw bytes of every argument,
+ * so that the record can be formatted later by log_record_format(). Integers, floating point numbers and
+ * pointers take 8 bytes each, strings are copied with their terminator. With LOG_TIMESTAMPS the header
+ * also gets the ticks and the id of the calling thread.
+ *
+ * @param[out] p_record         pointer to record buffer
+ * @param[in]  record_size      size of the record buffer, at least sizeof(log_record_header_t)
+ * @param[in]  p_site           pointer to the call site
+ * @param[in]  args             arguments matching the format string of the call site
+ *
+ * @return size_t               size of the encoded record
+ */
+size_t log_record_encode(uint8_t* p_record, size_t record_size, const log_site_t* p_site, va_list args) {
+    size_t used = sizeof(log_record_header_t);
+    const char* p_format = p_site->p_format;
+    bool full = false;
+    va_list local_args;
+    va_copy(local_args, args);
+
+    while ((*p_format != '\0') && (full == false)) {
+        if (*p_format++ != '%') {
+            continue;
+        }
+
+        conversion_t conversion;
+        p_format = parse_conversion(p_format, &conversion);
+
+        // Precisions taken from the arguments also limit how much of a string is read
+        int64_t precision = -1;
+        if (is_star(conversion.p_width, conversion.width_length) == true) {
+            full = !put_value(p_record, record_size, &used, (uint64_t)(int64_t)va_arg(local_args, int));
+        }
+        if (is_star(conversion.p_precision, conversion.precision_length) == true) {
+            precision = va_arg(local_args, int);
+            full = full || !put_value(p_record, record_size, &used, (uint64_t)precision);
+        } else if (conversion.p_precision != NULL) {
+            precision = strtol(conversion.p_precision, NULL, 10);
+        }
+        if (full == true) {
+            break;
+        }
+
+        switch (conversion.conversion) {
+            case 'd':
+            case 'i':
+                full = !put_value(p_record, record_size, &used, (uint64_t)read_signed(&local_args, conversion.length));
+                break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                full = !put_value(p_record, record_size, &used, read_unsigned(&local_args, conversion.length));
+                break;
+            case 'c':
+                full = !put_value(p_record, record_size, &used, (uint64_t)va_arg(local_args, int));
+                break;
+            case 'p':
+                full = !put_value(p_record, record_size, &used, (uint64_t)(uintptr_t)va_arg(local_args, void*));
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A': {
+                double value = (conversion.length == LENGTH_LONG_DOUBLE) ? (double)va_arg(local_args, long double)
+                                                                         : va_arg(local_args, double);
+                uint64_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                full = !put_value(p_record, record_size, &used, bits);
+                break;
+            }
+            case 's': {
+                const char* p_string = va_arg(local_args, const char*);
+                if (p_string == NULL) {
+                    p_string = "(null)";
+                }
+                if (used >= record_size) {
+                    full = true;
+                    break;
+                }
+
+                // Strings are truncated to the space left, keeping room for the terminator
+                size_t max_length = record_size - used - 1;
+                if ((precision >= 0) && ((size_t)precision < max_length)) {
+                    max_length = (size_t)precision;
+                }
+                size_t length = strnlen(p_string, max_length);
+                memcpy(&p_record[used], p_string, length);
+                p_record[used + length] = '\0';
+                used += length + 1;
+                break;
+            }
+            case 'n':
+                (void)va_arg(local_args, void*);
+                break;
+            case '%':
+                break;
+            default:
+                // The type of the argument is unknown, so none of the following arguments can be read
+                full = true;
+                break;
+        }
+    }
+    va_end(local_args);
+
+    log_record_header_t header = {
+        .size = (uint16_t)used,
+        .p_site = p_site,
+#if defined(LOG_TIMESTAMPS)
+        .ticks = log_stamp_now_ticks(),
+        .thread_id = log_stamp_get_thread_id(),
+#endif
+    };
+    memcpy(p_record, &header, sizeof(header));
+    return used;
+}
+
+/**
+ * @brief       Returns the stamp of a record.
+ *
+ * @param[in]  p_header         pointer to the header of the record
+ * @param[out] p_stamp          pointer to stamp
+ *
+ * @return bool                 - true if the record has a stamp
+ *                              - false if records are not stamped, LOG_TIMESTAMPS is not defined
+ */
+bool log_record_get_stamp(const log_record_header_t* p_header, log_stamp_t* p_stamp) {
+#if defined(LOG_TIMESTAMPS)
+    log_stamp_from_ticks(p_stamp, p_header->ticks, p_header->thread_id);
+    return true;
+#else
+    (void)p_header;
+    (void)p_stamp;
+    return false;
+#endif
+}
+
+/**
+ * @brief       Formats the arguments of a binary record into a line of text.
+ *
+ * The line looks exactly like the ones written by the printf backend.
+ *
+ * @param[in]  p_site           pointer to the call site of the record
+ * @param[in]  p_stamp          pointer to the stamp of the record, NULL if it has none
+ * @param[in]  p_arguments      pointer to the arguments, right after the record header
+ * @param[in]  arguments_size   size of the arguments
+ * @param[out] p_text           pointer to text buffer
+ * @param[in]  text_size        size of the text buffer, at least 2
+ *
+ * @return size_t               length of the text, without the terminator
+ */
+size_t log_record_format(const log_site_t* p_site, const log_stamp_t* p_stamp, const uint8_t* p_arguments, size_t arguments_size, char* p_text, size_t text_size) {
+    const uint8_t* p_data = p_arguments;
+    const uint8_t* p_end = p_arguments + arguments_size;
+    const char* p_format = p_site->p_format;
+    size_t length = 0;
+    p_text[0] = '\0';
+
+    // Raw records continue the line of a previous one, so they get neither a stamp nor a location
+    if (p_site->p_color != NULL) {
+        char stamp[LOG_STAMP_MAX_TEXT] = "";
+        if (p_stamp != NULL) {
+            log_stamp_format(p_stamp, stamp, sizeof(stamp));
+        }
+        append(p_text, text_size, &length, "%s%s%-28s:%4d: ", p_site->p_color, stamp, p_site->p_file, p_site->line);
+    }
+
+    while (*p_format != '\0') {
+        // Copy the text up to the next conversion
+        const char* p_percent = strchr(p_format, '%');
+        size_t literal_length = (p_percent != NULL) ? (size_t)(p_percent - p_format) : strlen(p_format);
+        append(p_text, text_size, &length, "%.*s", (int)literal_length, p_format);
+        if (p_percent == NULL) {
+            break;
+        }
+
+        conversion_t conversion;
+        p_format = parse_conversion(p_percent + 1, &conversion);
+        if (conversion.conversion == '%') {
+            append(p_text, text_size, &length, "%%");
+            continue;
+        }
+
+        // Rebuild the conversion with the values of the star fields filled in
+        // and the length modifier replaced by the one of the stored type
+        char spec[64];
+        uint64_t value;
+        int spec_length = snprintf(spec, sizeof(spec), "%%%.*s", (int)conversion.flags_length, conversion.p_flags);
+        if (is_star(conversion.p_width, conversion.width_length) == true) {
+            if (get_value(&p_data, p_end, &value) == false) {
+                break;
+            }
+            spec_length += snprintf(&spec[spec_length], sizeof(spec) - spec_length, "%d", (int)(int64_t)value);
+        } else {
+            spec_length += snprintf(&spec[spec_length], sizeof(spec) - spec_length, "%.*s", (int)conversion.width_length, conversion.p_width);
+        }
+        if (is_star(conversion.p_precision, conversion.precision_length) == true) {
+            if (get_value(&p_data, p_end, &value) == false) {
+                break;
+            }
+            // A negative precision is taken as if it was omitted
+            if ((int64_t)value >= 0) {
+                spec_length += snprintf(&spec[spec_length], sizeof(spec) - spec_length, ".%d", (int)(int64_t)value);
+            }
+        } else if (conversion.p_precision != NULL) {
+            spec_length += snprintf(&spec[spec_length], sizeof(spec) - spec_length, ".%.*s", (int)conversion.precision_length, conversion.p_precision);
+        }
+        if (spec_length >= (int)sizeof(spec) - 4) {
+            break;
+        }
+
+        if (append_conversion(p_text, text_size, &length, conversion.conversion, spec, sizeof(spec), &p_data, p_end) == false) {
+            break;
+        }
+    }
+
+    // Raw records don't get a newline, every other line keeps it even when truncated
+    if (p_site->p_color != NULL) {
+        if (length + 2 > text_size) {
+            length = text_size - 2;
+        }
+        p_text[length++] = '\n';
+        p_text[length] = '\0';
+    }
+    return length;
+}
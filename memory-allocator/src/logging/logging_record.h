@@ -0,0 +1,90 @@
+#ifndef LOGGING_RECORD_H_
+#define LOGGING_RECORD_H_
+
+#include "logging_stamp.h"
+#include "stdarg.h"
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+// Largest binary record, arguments that don't fit are left out and strings are truncated
+#define LOG_RECORD_MAX_SIZE 512
+
+// Largest line produced by formatting a record
+#define LOG_RECORD_MAX_TEXT 1024
+
+// Everything about a log call that is known at compile time, there is one static instance per call site
+typedef struct {
+    const char* p_file;
+    const char* p_format;
+    const char* p_color;  // NULL for raw records, which are printed without color, location or newline
+    uint16_t line;
+    uint8_t level;
+} log_site_t;
+
+// Places a call site in the log_sites section, which the linker delimits with __start_log_sites and __stop_log_sites
+#define LOG_SITE_ATTRIBUTES __attribute__((section("log_sites"), used, aligned(8)))
+
+typedef struct {
+    uint16_t size;  // Size of the whole record, including this header
+    const log_site_t* p_site;
+#if defined(LOG_TIMESTAMPS)
+    uint64_t ticks;  // When the record was logged, see log_stamp_now_ticks()
+    uint32_t thread_id;
+#endif
+} log_record_header_t;
+
+/**
+ * @brief       Encodes the arguments of a log call into a binary record.
+ *
+ * Instead of formatting the message, the format string is walked to copy the raw bytes of every argument,
+ * so that the record can be formatted later by log_record_format(). Integers, floating point numbers and
+ * pointers take 8 bytes each, strings are copied with their terminator. With LOG_TIMESTAMPS the header
+ * also gets the ticks and the id of the calling thread.
+ *
+ * @param[out] p_record         pointer to record buffer
+ * @param[in]  record_size      size of the record buffer, at least sizeof(log_record_header_t)
+ * @param[in]  p_site           pointer to the call site
+ * @param[in]  args             arguments matching the format string of the call site
+ *
+ * @return size_t               size of the encoded record
+ */
+size_t log_record_encode(uint8_t* p_record,
+                         size_t record_size,
+                         const log_site_t* p_site,
+                         va_list args);
+
+/**
+ * @brief       Returns the stamp of a record.
+ *
+ * @param[in]  p_header         pointer to the header of the record
+ * @param[out] p_stamp          pointer to stamp
+ *
+ * @return bool                 - true if the record has a stamp
+ *                              - false if records are not stamped, LOG_TIMESTAMPS is not defined
+ */
+bool log_record_get_stamp(const log_record_header_t* p_header,
+                          log_stamp_t* p_stamp);
+
+/**
+ * @brief       Formats the arguments of a binary record into a line of text.
+ *
+ * The line looks exactly like the ones written by the printf backend.
+ *
+ * @param[in]  p_site           pointer to the call site of the record
+ * @param[in]  p_stamp          pointer to the stamp of the record, NULL if it has none
+ * @param[in]  p_arguments      pointer to the arguments, right after the record header
+ * @param[in]  arguments_size   size of the arguments
+ * @param[out] p_text           pointer to text buffer
+ * @param[in]  text_size        size of the text buffer, at least 2
+ *
+ * @return size_t               length of the text, without the terminator
+ */
+size_t log_record_format(const log_site_t* p_site,
+                         const log_stamp_t* p_stamp,
+                         const uint8_t* p_arguments,
+                         size_t arguments_size,
+                         char* p_text,
+                         size_t text_size);
+
+#endif  // LOGGING_RECORD_H_
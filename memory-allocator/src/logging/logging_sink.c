@@ -0,0 +1,170 @@
+#include "logging_sink.h"
+#include "logging_stamp.h"
+
+#include "errno.h"
+#include "pthread.h"
+#include "stdarg.h"
+#include "stdbool.h"
+#include "stdint.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "time.h"
+#include "unistd.h"
+
+typedef struct {
+    char data[LOG_SINK_BUFFER_SIZE];
+    size_t length;
+    uint64_t oldest_ns;  // When the oldest record in the buffer was added
+} log_sink_buffer_t;
+
+static __thread log_sink_buffer_t* p_thread_buffer = NULL;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t buffer_key;
+static int output_fd = STDOUT_FILENO;
+
+// Coarse clocks are read without a syscall and are precise enough for a flush interval
+static uint64_t get_coarse_ns(void) {
+    struct timespec now;
+#if defined(CLOCK_MONOTONIC_COARSE)
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#endif
+    return ((uint64_t)now.tv_sec * 1000000000u) + (uint64_t)now.tv_nsec;
+}
+
+static void write_buffer(log_sink_buffer_t* p_buffer) {
+    size_t written = 0;
+    int fd = __atomic_load_n(&output_fd, __ATOMIC_RELAXED);
+
+    while (written < p_buffer->length) {
+        ssize_t result = write(fd, &p_buffer->data[written], p_buffer->length - written);
+        if (result < 0) {
+            // Retry if interrupted, anything else is not worth reporting from the logger
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        written += (size_t)result;
+    }
+    p_buffer->length = 0;
+}
+
+static void release_buffer(void* p_buffer) {
+    write_buffer((log_sink_buffer_t*)p_buffer);
+    free(p_buffer);
+}
+
+static void create_key(void) {
+    pthread_key_create(&buffer_key, release_buffer);
+
+    // Threads flush when they exit, but the main thread exits the process instead
+    atexit(log_sink_flush);
+}
+
+static log_sink_buffer_t* get_thread_buffer(void) {
+    if (p_thread_buffer == NULL) {
+        pthread_once(&key_once, create_key);
+        p_thread_buffer = (log_sink_buffer_t*)malloc(sizeof(log_sink_buffer_t));
+        if (p_thread_buffer != NULL) {
+            p_thread_buffer->length = 0;
+            pthread_setspecific(buffer_key, p_thread_buffer);
+        }
+    }
+    return p_thread_buffer;
+}
+
+// Formats a whole record like the printf backend does and returns its length, even if it didn't fit
+static size_t format_record(char* p_text, size_t size, const char* p_color, const char* p_file, int line, const char* p_format, va_list args) {
+    size_t length = 0;
+
+    if (p_color != NULL) {
+        char stamp[LOG_STAMP_MAX_TEXT] = "";
+#if defined(LOG_TIMESTAMPS)
+        log_stamp_t now;
+        log_stamp_now(&now);
+        log_stamp_format(&now, stamp, sizeof(stamp));
+#endif
+        length += (size_t)snprintf(p_text, size, "%s%s%-28s:%4d: ", p_color, stamp, p_file, line);
+    }
+    length += (size_t)vsnprintf(&p_text[(length < size) ? length : size], (length < size) ? (size - length) : 0, p_format, args);
+    if (p_color != NULL) {
+        if (length + 1 < size) {
+            p_text[length] = '\n';
+            p_text[length + 1] = '\0';
+        }
+        length++;
+    }
+    return length;
+}
+
+/**
+ * @brief       Formats a record into the buffer of the calling thread.
+ *
+ * The buffer is written with a single write() when the record doesn't fit, when the oldest record in it
+ * is older than LOG_SINK_FLUSH_INTERVAL_NS, on log_sink_flush(), and when the thread exits.
+ * Records are never split across writes, so lines of different threads don't interleave.
+ *
+ * @param[in] p_color           color of the record, NULL for raw records without color, location or newline
+ * @param[in] p_file            file the record was logged from
+ * @param[in] line              line the record was logged from
+ * @param[in] p_format          format string of the record, followed by its arguments
+ */
+void log_sink_write(const char* p_color, const char* p_file, int line, const char* p_format, ...) {
+    log_sink_buffer_t* p_buffer = get_thread_buffer();
+    if (p_buffer == NULL) {
+        return;
+    }
+
+    uint64_t now_ns = get_coarse_ns();
+    if ((p_buffer->length > 0) && (now_ns - p_buffer->oldest_ns >= LOG_SINK_FLUSH_INTERVAL_NS)) {
+        write_buffer(p_buffer);
+    }
+
+    // Format straight into the buffer, and if the record doesn't fit write the buffer out and try again
+    for (int attempt = 0; attempt < 2; attempt++) {
+        size_t space = LOG_SINK_BUFFER_SIZE - p_buffer->length;
+        va_list args;
+        va_start(args, p_format);
+        size_t length = format_record(&p_buffer->data[p_buffer->length], space, p_color, p_file, line, p_format, args);
+        va_end(args);
+
+        if (length < space) {
+            if (p_buffer->length == 0) {
+                p_buffer->oldest_ns = now_ns;
+            }
+            p_buffer->length += length;
+            return;
+        }
+
+        // Records larger than the whole buffer are truncated, keeping their newline
+        if (p_buffer->length == 0) {
+            p_buffer->length = LOG_SINK_BUFFER_SIZE - 1;
+            if (p_color != NULL) {
+                p_buffer->data[p_buffer->length - 1] = '\n';
+            }
+            write_buffer(p_buffer);
+            return;
+        }
+        write_buffer(p_buffer);
+    }
+}
+
+/**
+ * @brief       Writes the buffer of the calling thread.
+ */
+void log_sink_flush(void) {
+    if ((p_thread_buffer != NULL) && (p_thread_buffer->length > 0)) {
+        write_buffer(p_thread_buffer);
+    }
+}
+
+/**
+ * @brief       Selects the file descriptor the buffers are written to, stdout by default.
+ *
+ * @param[in] fd                file descriptor
+ */
+void log_sink_set_output(int fd) {
+    __atomic_store_n(&output_fd, fd, __ATOMIC_RELAXED);
+}
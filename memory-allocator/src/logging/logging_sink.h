@@ -0,0 +1,40 @@
+#ifndef LOGGING_SINK_H_
+#define LOGGING_SINK_H_
+
+// Size of the buffer of every logging thread, in bytes
+#define LOG_SINK_BUFFER_SIZE 16384
+
+// A buffer is written once its oldest record is this old, checked whenever the thread logs
+#define LOG_SINK_FLUSH_INTERVAL_NS 100000000
+
+/**
+ * @brief       Formats a record into the buffer of the calling thread.
+ *
+ * The buffer is written with a single write() when the record doesn't fit, when the oldest record in it
+ * is older than LOG_SINK_FLUSH_INTERVAL_NS, on log_sink_flush(), and when the thread exits.
+ * Records are never split across writes, so lines of different threads don't interleave.
+ *
+ * @param[in] p_color           color of the record, NULL for raw records without color, location or newline
+ * @param[in] p_file            file the record was logged from
+ * @param[in] line              line the record was logged from
+ * @param[in] p_format          format string of the record, followed by its arguments
+ */
+void log_sink_write(const char* p_color,
+                    const char* p_file,
+                    int line,
+                    const char* p_format,
+                    ...) __attribute__((format(printf, 4, 5)));
+
+/**
+ * @brief       Writes the buffer of the calling thread.
+ */
+void log_sink_flush(void);
+
+/**
+ * @brief       Selects the file descriptor the buffers are written to, stdout by default.
+ *
+ * @param[in] fd                file descriptor
+ */
+void log_sink_set_output(int fd);
+
+#endif  // LOGGING_SINK_H_
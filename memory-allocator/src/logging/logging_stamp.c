@@ -0,0 +1,132 @@
+#include "logging_stamp.h"
+#include "timing.h"
+
+#include "pthread.h"
+#include "stdio.h"
+#include "time.h"
+
+#if defined(__linux__)
+#include "sys/syscall.h"
+#include "unistd.h"
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#define STAMP_USE_TSC 1
+#else
+#define STAMP_USE_TSC 0
+#endif
+
+static uint64_t epoch_ticks = 0;
+static __thread uint32_t cached_thread_id = 0;
+#if !defined(__linux__)
+static uint32_t next_thread_id = 0;
+#endif
+
+// The child of a fork is a new thread, but it inherits the cached id of the thread that forked
+static void forget_thread_id(void) {
+    cached_thread_id = 0;
+}
+
+__attribute__((constructor)) static void start_epoch(void) {
+    epoch_ticks = log_stamp_now_ticks();
+    pthread_atfork(NULL, NULL, forget_thread_id);
+
+#if defined(LOG_TIMESTAMPS)
+    // Calibrate now rather than when the first stamp is written, which may be from a crash handler
+    timing_calibrate();
+#endif
+}
+
+/**
+ * @brief       Reads the clock records are stamped with.
+ *
+ * On x86 this is the TSC, elsewhere it's CLOCK_MONOTONIC_COARSE in nanoseconds.
+ *
+ * @return uint64_t             current tick count
+ */
+uint64_t log_stamp_now_ticks(void) {
+#if STAMP_USE_TSC
+    return timing_now_ticks();
+#else
+    // Without a TSC, the coarse clock is the one that can be read without a syscall
+    struct timespec now;
+#if defined(CLOCK_MONOTONIC_COARSE)
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#endif
+    return ((uint64_t)now.tv_sec * 1000000000u) + (uint64_t)now.tv_nsec;
+#endif
+}
+
+/**
+ * @brief       Returns the id of the calling thread, which is only looked up once per thread.
+ *
+ * @return uint32_t             kernel id of the calling thread on Linux, a sequence number elsewhere
+ */
+uint32_t log_stamp_get_thread_id(void) {
+    if (cached_thread_id == 0) {
+#if defined(__linux__)
+        cached_thread_id = (uint32_t)syscall(SYS_gettid);
+#else
+        cached_thread_id = __atomic_add_fetch(&next_thread_id, 1, __ATOMIC_RELAXED);
+#endif
+    }
+    return cached_thread_id;
+}
+
+/**
+ * @brief       Converts the ticks and thread id stored in a record into a stamp.
+ *
+ * Without a TSC ticks already are nanoseconds, and timing_ticks_to_ns() leaves them as they are.
+ *
+ * @param[out] p_stamp          pointer to stamp
+ * @param[in]  ticks            ticks returned by log_stamp_now_ticks()
+ * @param[in]  thread_id        thread id returned by log_stamp_get_thread_id()
+ */
+void log_stamp_from_ticks(log_stamp_t* p_stamp, uint64_t ticks, uint32_t thread_id) {
+    p_stamp->ns = (ticks > epoch_ticks) ? timing_ticks_to_ns(ticks - epoch_ticks) : 0;
+    p_stamp->thread_id = thread_id;
+    p_stamp->reserved = 0;
+}
+
+/**
+ * @brief       Takes a stamp for the calling thread right now.
+ *
+ * @param[out] p_stamp          pointer to stamp
+ */
+void log_stamp_now(log_stamp_t* p_stamp) {
+    log_stamp_from_ticks(p_stamp, log_stamp_now_ticks(), log_stamp_get_thread_id());
+}
+
+/**
+ * @brief       Formats a stamp as the prefix of a line, seconds with nanoseconds followed by the thread id.
+ *
+ * @param[in]  p_stamp          pointer to stamp
+ * @param[out] p_text           pointer to text buffer
+ * @param[in]  text_size        size of the text buffer
+ *
+ * @return size_t               length of the text, without the terminator
+ */
+size_t log_stamp_format(const log_stamp_t* p_stamp, char* p_text, size_t text_size) {
+    int length = snprintf(p_text, text_size, "[%6llu.%09llu %6u] ",
+                          (unsigned long long)(p_stamp->ns / 1000000000u),
+                          (unsigned long long)(p_stamp->ns % 1000000000u),
+                          p_stamp->thread_id);
+    if (length < 0) {
+        return 0;
+    }
+    return ((size_t)length < text_size) ? (size_t)length : (text_size - 1);
+}
+
+/**
+ * @brief       Prints a stamp taken right now to stdout, used by the printf backend.
+ */
+void log_stamp_print(void) {
+    log_stamp_t stamp;
+    char text[LOG_STAMP_MAX_TEXT];
+
+    log_stamp_now(&stamp);
+    log_stamp_format(&stamp, text, sizeof(text));
+    fputs(text, stdout);
+}
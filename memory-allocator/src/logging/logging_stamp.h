@@ -0,0 +1,70 @@
+#ifndef LOGGING_STAMP_H_
+#define LOGGING_STAMP_H_
+
+#include "stddef.h"
+#include "stdint.h"
+
+// Records carry a stamp when LOG_TIMESTAMPS is defined, see the LOG_TIMESTAMPS CMake option.
+// The stamp is taken as raw ticks and a cached thread id, and only converted and formatted when written out
+typedef struct {
+    uint64_t ns;  // Nanoseconds since the process started
+    uint32_t thread_id;
+    uint32_t reserved;
+} log_stamp_t;
+
+// Largest text produced by log_stamp_format()
+#define LOG_STAMP_MAX_TEXT 48
+
+/**
+ * @brief       Reads the clock records are stamped with.
+ *
+ * On x86 this is the TSC, elsewhere it's CLOCK_MONOTONIC_COARSE in nanoseconds.
+ *
+ * @return uint64_t             current tick count
+ */
+uint64_t log_stamp_now_ticks(void);
+
+/**
+ * @brief       Returns the id of the calling thread, which is only looked up once per thread.
+ *
+ * @return uint32_t             kernel id of the calling thread on Linux, a sequence number elsewhere
+ */
+uint32_t log_stamp_get_thread_id(void);
+
+/**
+ * @brief       Converts the ticks and thread id stored in a record into a stamp.
+ *
+ * @param[out] p_stamp          pointer to stamp
+ * @param[in]  ticks            ticks returned by log_stamp_now_ticks()
+ * @param[in]  thread_id        thread id returned by log_stamp_get_thread_id()
+ */
+void log_stamp_from_ticks(log_stamp_t* p_stamp,
+                          uint64_t ticks,
+                          uint32_t thread_id);
+
+/**
+ * @brief       Takes a stamp for the calling thread right now.
+ *
+ * @param[out] p_stamp          pointer to stamp
+ */
+void log_stamp_now(log_stamp_t* p_stamp);
+
+/**
+ * @brief       Formats a stamp as the prefix of a line, seconds with nanoseconds followed by the thread id.
+ *
+ * @param[in]  p_stamp          pointer to stamp
+ * @param[out] p_text           pointer to text buffer
+ * @param[in]  text_size        size of the text buffer
+ *
+ * @return size_t               length of the text, without the terminator
+ */
+size_t log_stamp_format(const log_stamp_t* p_stamp,
+                        char* p_text,
+                        size_t text_size);
+
+/**
+ * @brief       Prints a stamp taken right now to stdout, used by the printf backend.
+ */
+void log_stamp_print(void);
+
+#endif  // LOGGING_STAMP_H_
@@ -1,9 +1,373 @@
+#include "planner.h"
+#include "replay.h"
+#include "timing.h"
+
+#include "getopt.h"
+#include "stdlib.h"
+#include "string.h"
+
 #define __FILENAME__     "main.c"
 #define LOG_MODULE_GROUP LOG_GROUP_DEFAULT
 #define LOG_LEVEL        LOG_LEVEL_DEBUG
 #include "logging.h"
 
-int main(int argc, char* argv[]) {
-    log_highlight("Program running");
+#define MAX_BUFFER_SIZES 16
+
+typedef struct {
+    replay_options_t replay;
+    size_t buffer_sizes[MAX_BUFFER_SIZES];
+    size_t buffer_size_count;
+} options_t;
+
+static void print_usage(const char* p_program) {
+    fprintf(stderr,
+            "Usage: %s replay TRACE [options]\n"
+            "  --pace fast|original  replay as fast as possible or at the recorded pace, fast by default\n"
+            "  --mode fail|overwrite fail allocations when full or evict the oldest blocks, fail by default\n"
+            "  --buffer-size SIZE    buffer size of every allocator, e.g. 64K, can be repeated to compare sizes\n"
+            "  --min-block N         minimum block size of every allocator\n"
+            "  --max-block N         maximum block size of every allocator\n"
+            "\n"
+            "       %s generate TRACE [options]\n"
+            "  --blocks N            blocks allocated, 1000000 by default\n"
+            "  --rate N              blocks allocated per second, 1000000 by default\n"
+            "  --sizes MIN:MAX       range of block sizes, 8:255 by default\n"
+            "  --backlog N           blocks the consumer lets pile up, 256 by default\n"
+            "  --buffer-size SIZE    buffer size recorded in the trace, 64K by default\n"
+            "  --seed N              seed of the generator\n"
+            "\n"
+            "       %s plan TRACE [options]\n"
+            "  --target PERCENT      allocations that can run out of memory, 0 by default\n"
+            "  --buffer-size SIZE    buffer size to print the out of memory rate at, can be repeated\n"
+            "\n"
+            "Traces are recorded by building with -DALLOCATOR_TRACE=ON and setting ALLOCATOR_TRACE=PATH.\n",
+            p_program, p_program, p_program);
+}
+
+// Sizes are given in bytes, with an optional K, M or G suffix
+static bool parse_size(const char* p_text, size_t* p_size) {
+    char* p_end;
+    unsigned long long size = strtoull(p_text, &p_end, 10);
+    unsigned int shift = 0;
+
+    if ((p_end == p_text) || (size == 0)) {
+        return false;
+    }
+    if ((*p_end == 'K') || (*p_end == 'k')) {
+        shift = 10;
+        p_end++;
+    } else if ((*p_end == 'M') || (*p_end == 'm')) {
+        shift = 20;
+        p_end++;
+    } else if ((*p_end == 'G') || (*p_end == 'g')) {
+        shift = 30;
+        p_end++;
+    }
+    if ((*p_end != '\0') || (size > (SIZE_MAX >> shift))) {
+        return false;
+    }
+    *p_size = (size_t)size << shift;
+    return true;
+}
+
+static bool parse_block_size(const char* p_text, uint8_t* p_size) {
+    char* p_end;
+    unsigned long size = strtoul(p_text, &p_end, 10);
+
+    if ((p_end == p_text) || (*p_end != '\0') || (size == 0) || (size > UINT8_MAX)) {
+        return false;
+    }
+    *p_size = (uint8_t)size;
+    return true;
+}
+
+static bool parse_replay_options(int argc, char* argv[], options_t* p_options) {
+    static const struct option long_options[] = {
+        { "pace", required_argument, NULL, 'p' },
+        { "mode", required_argument, NULL, 'm' },
+        { "buffer-size", required_argument, NULL, 'b' },
+        { "min-block", required_argument, NULL, 'n' },
+        { "max-block", required_argument, NULL, 'x' },
+        { NULL, 0, NULL, 0 },
+    };
+    int option;
+
+    memset(p_options, 0, sizeof(options_t));
+    p_options->replay.pace = REPLAY_PACE_FAST;
+
+    while ((option = getopt_long(argc, argv, "p:m:b:n:x:", long_options, NULL)) != -1) {
+        switch (option) {
+            case 'p':
+                if (strcmp(optarg, "fast") == 0) {
+                    p_options->replay.pace = REPLAY_PACE_FAST;
+                } else if (strcmp(optarg, "original") == 0) {
+                    p_options->replay.pace = REPLAY_PACE_ORIGINAL;
+                } else {
+                    return false;
+                }
+                break;
+            case 'm':
+                if (strcmp(optarg, "fail") == 0) {
+                    p_options->replay.overwrite_oldest = false;
+                } else if (strcmp(optarg, "overwrite") == 0) {
+                    p_options->replay.overwrite_oldest = true;
+                } else {
+                    return false;
+                }
+                break;
+            case 'b':
+                if ((p_options->buffer_size_count == MAX_BUFFER_SIZES) ||
+                    (parse_size(optarg, &p_options->buffer_sizes[p_options->buffer_size_count]) == false)) {
+                    return false;
+                }
+                p_options->buffer_size_count++;
+                break;
+            case 'n':
+                if (parse_block_size(optarg, &p_options->replay.min_block_size) == false) {
+                    return false;
+                }
+                break;
+            case 'x':
+                if (parse_block_size(optarg, &p_options->replay.max_block_size) == false) {
+                    return false;
+                }
+                break;
+            default:
+                return false;
+        }
+    }
+
+    // Without a buffer size the one of the trace is kept
+    if (p_options->buffer_size_count == 0) {
+        p_options->buffer_size_count = 1;
+    }
+    return (optind == argc);
+}
+
+static bool parse_generate_options(int argc, char* argv[], replay_generator_t* p_generator) {
+    static const struct option long_options[] = {
+        { "blocks", required_argument, NULL, 'n' },
+        { "rate", required_argument, NULL, 'r' },
+        { "sizes", required_argument, NULL, 's' },
+        { "backlog", required_argument, NULL, 'l' },
+        { "buffer-size", required_argument, NULL, 'b' },
+        { "seed", required_argument, NULL, 'S' },
+        { NULL, 0, NULL, 0 },
+    };
+    int option;
+    char* p_separator;
+
+    p_generator->blocks = 1000000;
+    p_generator->rate = 1e6;
+    p_generator->min_block_size = 8;
+    p_generator->max_block_size = 255;
+    p_generator->backlog = 256;
+    p_generator->buffer_size = 64 * 1024;
+    p_generator->seed = 1;
+
+    while ((option = getopt_long(argc, argv, "n:r:s:l:b:S:", long_options, NULL)) != -1) {
+        switch (option) {
+            case 'n':
+                p_generator->blocks = strtoull(optarg, NULL, 10);
+                break;
+            case 'r':
+                p_generator->rate = strtod(optarg, NULL);
+                break;
+            case 's':
+                p_separator = strchr(optarg, ':');
+                if (p_separator == NULL) {
+                    return false;
+                }
+                *p_separator = '\0';
+                if ((parse_block_size(optarg, &p_generator->min_block_size) == false) ||
+                    (parse_block_size(p_separator + 1, &p_generator->max_block_size) == false)) {
+                    return false;
+                }
+                break;
+            case 'l':
+                p_generator->backlog = strtoull(optarg, NULL, 10);
+                break;
+            case 'b':
+                if (parse_size(optarg, &p_generator->buffer_size) == false) {
+                    return false;
+                }
+                break;
+            case 'S':
+                p_generator->seed = strtoull(optarg, NULL, 10);
+                break;
+            default:
+                return false;
+        }
+    }
+    return (optind == argc);
+}
+
+static bool parse_plan_options(int argc, char* argv[], double* p_target_rate, options_t* p_options) {
+    static const struct option long_options[] = {
+        { "target", required_argument, NULL, 't' },
+        { "buffer-size", required_argument, NULL, 'b' },
+        { NULL, 0, NULL, 0 },
+    };
+    int option;
+    char* p_end;
+
+    memset(p_options, 0, sizeof(options_t));
+    *p_target_rate = 0.0;
+
+    while ((option = getopt_long(argc, argv, "t:b:", long_options, NULL)) != -1) {
+        switch (option) {
+            case 't':
+                *p_target_rate = strtod(optarg, &p_end) / 100.0;
+                if ((*p_end != '\0') || (*p_target_rate < 0.0) || (*p_target_rate > 1.0)) {
+                    return false;
+                }
+                break;
+            case 'b':
+                if ((p_options->buffer_size_count == MAX_BUFFER_SIZES) ||
+                    (parse_size(optarg, &p_options->buffer_sizes[p_options->buffer_size_count]) == false)) {
+                    return false;
+                }
+                p_options->buffer_size_count++;
+                break;
+            default:
+                return false;
+        }
+    }
+    return (optind == argc);
+}
+
+static int run_replay(const char* p_path, int argc, char* argv[]) {
+    options_t options;
+    replay_trace_t trace;
+
+    if (parse_replay_options(argc, argv, &options) == false) {
+        return 2;
+    }
+    if (replay_trace_load(p_path, &trace) == false) {
+        log_error("Couldn't load trace %s", p_path);
+        return 1;
+    }
+
+    // The allocator logs every operation at debug level, which would be most of what is measured
+    if (getenv("LOG_LEVELS") == NULL) {
+        log_set_level(LOG_GROUP_ID_ALLOCATOR, LOG_LEVEL_ERROR);
+    }
+    timing_calibrate();
+
+    int result = 0;
+    for (size_t i = 0; i < options.buffer_size_count; i++) {
+        replay_result_t replay_result;
+
+        options.replay.buffer_size = options.buffer_sizes[i];
+        printf("%s: %zu operations on %zu allocators, buffer size %s%zu, %s mode, %s\n",
+               p_path, trace.record_count, trace.allocator_count,
+               (options.replay.buffer_size == 0) ? "from trace " : "",
+               (options.replay.buffer_size == 0) ? (size_t)((trace.allocator_count > 0) ? trace.p_configs[0].buffer_size : 0) : options.replay.buffer_size,
+               (options.replay.overwrite_oldest == true) ? "overwrite" : "fail",
+               (options.replay.pace == REPLAY_PACE_ORIGINAL) ? "at original pace" : "as fast as possible");
+
+        if (replay_run(&trace, &options.replay, &replay_result) == false) {
+            log_error("Couldn't replay the trace");
+            result = 1;
+            break;
+        }
+        replay_print_result(&replay_result, stdout);
+        printf("\n");
+    }
+
+    replay_trace_release(&trace);
+    return result;
+}
+
+static int run_generate(const char* p_path, int argc, char* argv[]) {
+    replay_generator_t generator;
+    replay_trace_t trace;
+
+    if (parse_generate_options(argc, argv, &generator) == false) {
+        return 2;
+    }
+    if (replay_trace_generate(&generator, &trace) == false) {
+        log_error("Couldn't generate the trace, check its parameters");
+        return 1;
+    }
+
+    bool saved = replay_trace_save(&trace, p_path);
+    if (saved == true) {
+        printf("%s: %zu operations\n", p_path, trace.record_count);
+    } else {
+        log_error("Couldn't save trace %s", p_path);
+    }
+    replay_trace_release(&trace);
+    return (saved == true) ? 0 : 1;
+}
+
+static int run_plan(const char* p_path, int argc, char* argv[]) {
+    // Fractions of the planned buffer size, in percent, the out of memory rate is printed at by default
+    static const size_t default_fractions[] = { 25, 50, 75, 100, 125, 150, 200 };
+    options_t options;
+    double target_rate;
+    replay_trace_t trace;
+
+    if (parse_plan_options(argc, argv, &target_rate, &options) == false) {
+        return 2;
+    }
+    if (replay_trace_load(p_path, &trace) == false) {
+        log_error("Couldn't load trace %s", p_path);
+        return 1;
+    }
+
+    printf("%s: %zu operations on %zu allocators\n", p_path, trace.record_count, trace.allocator_count);
+    for (size_t i = 0; i < trace.allocator_count; i++) {
+        planner_plan_t plan;
+        size_t buffer_sizes[MAX_BUFFER_SIZES];
+        size_t buffer_size_count = options.buffer_size_count;
+
+        if (planner_plan(&trace, i, target_rate, &plan) == false) {
+            printf("allocator %zu: nothing allocated\n", i);
+            continue;
+        }
+
+        memcpy(buffer_sizes, options.buffer_sizes, sizeof(buffer_sizes));
+        if (buffer_size_count == 0) {
+            for (size_t f = 0; f < sizeof(default_fractions) / sizeof(default_fractions[0]); f++) {
+                buffer_sizes[buffer_size_count++] = (plan.buffer_size * default_fractions[f] + 99) / 100;
+            }
+            buffer_sizes[buffer_size_count++] = plan.configured_buffer_size;
+        }
+        planner_print_plan(&trace, i, &plan, buffer_sizes, buffer_size_count, stdout);
+    }
+
+    replay_trace_release(&trace);
     return 0;
-}
\ No newline at end of file
+}
+
+// Replays recorded or generated allocator traces and reports how a configuration copes with them,
+// or plans the smallest configuration that copes with a trace.
+// Usage: memory_allocator replay|generate|plan TRACE [options]
+int main(int argc, char* argv[]) {
+    // SIGUSR1 raises the log levels, SIGUSR2 restores them
+    log_levels_handle_signals();
+
+#if LOG_BACKEND == LOG_BACKEND_FLIGHT
+    // Keep the last records when crashing, log_decode turns them into text
+    log_flight_dump_on_crash("memory_allocator.flight");
+#endif
+
+    int result = 2;
+    if (argc >= 3) {
+        // Options come after the command and the trace
+        optind = 3;
+        if (strcmp(argv[1], "replay") == 0) {
+            result = run_replay(argv[2], argc, argv);
+        } else if (strcmp(argv[1], "generate") == 0) {
+            result = run_generate(argv[2], argc, argv);
+        } else if (strcmp(argv[1], "plan") == 0) {
+            result = run_plan(argv[2], argc, argv);
+        }
+    }
+
+    if (result == 2) {
+        print_usage(argv[0]);
+    }
+    return result;
+}
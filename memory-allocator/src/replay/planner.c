@@ -0,0 +1,215 @@
+#include "planner.h"
+
+#include "stdlib.h"
+#include "string.h"
+
+// Large enough to never run out of memory, small enough to add block sizes to without overflowing
+#define UNBOUNDED_BUFFER_SIZE (SIZE_MAX / 2)
+
+static size_t count_allocs(const replay_trace_t* p_trace, size_t allocator) {
+    size_t count = 0;
+    for (size_t i = 0; i < p_trace->record_count; i++) {
+        const allocator_trace_record_t* p_record = &p_trace->p_records[i];
+        if ((p_record->allocator_id == allocator) &&
+            (p_record->op == ALLOCATOR_TRACE_OP_ALLOC) &&
+            (p_record->result == ALLOCATOR_SUCCESS)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static double get_rate(const planner_simulation_t* p_simulation) {
+    return (p_simulation->allocs > 0) ? ((double)p_simulation->out_of_memory / (double)p_simulation->allocs) : 0.0;
+}
+
+/**
+ * @brief       Simulates one allocator of a trace with another configuration.
+ *
+ * The simulation follows the accounting of the allocator: a block fits if it fits in the buffer_size bytes
+ * the data buffer can hold besides its extra slot, and the size buffer has room for the buffer_size / min_block_size
+ * blocks the smallest blocks would take. Peeks and frees are consumed in order like in replay_run().
+ *
+ * @param[in]  p_trace          pointer to the trace
+ * @param[in]  allocator        index of the allocator in the trace
+ * @param[in]  buffer_size      buffer size to simulate
+ * @param[in]  min_block_size   minimum block size to simulate
+ * @param[in]  max_block_size   maximum block size to simulate
+ * @param[out] p_simulation     pointer to the result
+ *
+ * @return bool                 - true if the allocator was simulated
+ *                              - false if memory ran out
+ */
+bool planner_simulate(const replay_trace_t* p_trace, size_t allocator, size_t buffer_size, uint8_t min_block_size, uint8_t max_block_size, planner_simulation_t* p_simulation) {
+    memset(p_simulation, 0, sizeof(planner_simulation_t));
+
+    // The blocks of the allocator in the order they were allocated, the oldest one held is at tail
+    size_t count = count_allocs(p_trace, allocator);
+    uint8_t* p_sizes = (uint8_t*)malloc((count > 0) ? count : 1);
+    bool* p_present = (bool*)malloc(((count > 0) ? count : 1) * sizeof(bool));
+    if ((p_sizes == NULL) || (p_present == NULL)) {
+        free(p_sizes);
+        free(p_present);
+        return false;
+    }
+
+    size_t max_blocks = buffer_size / ((min_block_size > 0) ? min_block_size : 1);
+    size_t head = 0;
+    size_t tail = 0;
+    size_t used = 0;
+    size_t blocks = 0;
+
+    for (size_t i = 0; i < p_trace->record_count; i++) {
+        const allocator_trace_record_t* p_record = &p_trace->p_records[i];
+        if (p_record->allocator_id != allocator) {
+            continue;
+        }
+
+        if (p_record->op == ALLOCATOR_TRACE_OP_ALLOC) {
+            if (p_record->result != ALLOCATOR_SUCCESS) {
+                continue;
+            }
+
+            bool fits = false;
+            p_simulation->allocs++;
+            if ((p_record->size < min_block_size) || (p_record->size > max_block_size)) {
+                p_simulation->unsupported_size++;
+            } else if ((used + p_record->size > buffer_size) || (blocks >= max_blocks)) {
+                p_simulation->out_of_memory++;
+            } else {
+                fits = true;
+                used += p_record->size;
+                blocks++;
+                if (used > p_simulation->peak_utilization) {
+                    p_simulation->peak_utilization = used;
+                }
+            }
+            p_sizes[head] = (uint8_t)p_record->size;
+            p_present[head] = fits;
+            head++;
+        } else if ((p_record->op == ALLOCATOR_TRACE_OP_FREE) && (tail < head)) {
+            if (p_present[tail] == true) {
+                used -= p_sizes[tail];
+                blocks--;
+            }
+            tail++;
+        }
+    }
+
+    free(p_sizes);
+    free(p_present);
+    return true;
+}
+
+/**
+ * @brief       Finds the smallest configuration of an allocator that keeps the trace under an out of memory rate.
+ *
+ * The block size range is the narrowest one that supports every block in the trace, which also makes the
+ * size buffer as small as it can be. The buffer size is searched for assuming larger buffers never run out
+ * of memory more often.
+ *
+ * @param[in]  p_trace          pointer to the trace
+ * @param[in]  allocator        index of the allocator in the trace
+ * @param[in]  target_rate      fraction of the allocations that can run out of memory, between 0 and 1
+ * @param[out] p_plan           pointer to the plan
+ *
+ * @return bool                 - true if the plan was made
+ *                              - false if the allocator allocated nothing or memory ran out
+ */
+bool planner_plan(const replay_trace_t* p_trace, size_t allocator, double target_rate, planner_plan_t* p_plan) {
+    memset(p_plan, 0, sizeof(planner_plan_t));
+    p_plan->configured_buffer_size = p_trace->p_configs[allocator].buffer_size;
+    p_plan->target_rate = target_rate;
+    p_plan->min_block_size = UINT8_MAX;
+
+    bool allocated = false;
+    for (size_t i = 0; i < p_trace->record_count; i++) {
+        const allocator_trace_record_t* p_record = &p_trace->p_records[i];
+        if ((p_record->allocator_id == allocator) &&
+            (p_record->op == ALLOCATOR_TRACE_OP_ALLOC) &&
+            (p_record->result == ALLOCATOR_SUCCESS)) {
+            p_plan->min_block_size = (p_record->size < p_plan->min_block_size) ? (uint8_t)p_record->size : p_plan->min_block_size;
+            p_plan->max_block_size = (p_record->size > p_plan->max_block_size) ? (uint8_t)p_record->size : p_plan->max_block_size;
+            allocated = true;
+        }
+    }
+    if (allocated == false) {
+        return false;
+    }
+
+    // With room for everything the trace ever held at once nothing runs out of memory
+    planner_simulation_t simulation;
+    if (planner_simulate(p_trace, allocator, UNBOUNDED_BUFFER_SIZE, p_plan->min_block_size, p_plan->max_block_size, &simulation) == false) {
+        return false;
+    }
+    p_plan->peak_demand = simulation.peak_utilization;
+
+    // Smallest buffer size in [low, high] that meets the target, high always does
+    size_t low = 1;
+    size_t high = p_plan->peak_demand;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (planner_simulate(p_trace, allocator, middle, p_plan->min_block_size, p_plan->max_block_size, &simulation) == false) {
+            return false;
+        }
+
+        if (get_rate(&simulation) <= target_rate) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    p_plan->buffer_size = high;
+    return true;
+}
+
+/**
+ * @brief       Returns the memory an allocator takes for its data and size buffers.
+ *
+ * @param[in] buffer_size       buffer size of the allocator
+ * @param[in] min_block_size    minimum block size of the allocator
+ * @param[in] max_block_size    maximum block size of the allocator
+ *
+ * @return size_t               bytes allocated by allocator_init() besides the allocator_t
+ */
+size_t planner_get_footprint(size_t buffer_size, uint8_t min_block_size, uint8_t max_block_size) {
+    // Both buffers have an extra slot to tell full from empty, and the data buffer
+    // an overhang for the blocks that wrap around, like in allocator_init()
+    return (buffer_size + 1 + max_block_size) + (buffer_size / ((min_block_size > 0) ? min_block_size : 1) + 1);
+}
+
+/**
+ * @brief       Prints a plan and the out of memory rate at a set of buffer sizes.
+ *
+ * @param[in] p_trace           pointer to the trace
+ * @param[in] allocator         index of the allocator in the trace
+ * @param[in] p_plan            pointer to the plan of the allocator
+ * @param[in] p_buffer_sizes    buffer sizes to print the out of memory rate at
+ * @param[in] buffer_size_count number of buffer sizes
+ * @param[in] p_file            file to print to
+ */
+void planner_print_plan(const replay_trace_t* p_trace, size_t allocator, const planner_plan_t* p_plan, const size_t* p_buffer_sizes, size_t buffer_size_count, FILE* p_file) {
+    const allocator_trace_config_t* p_config = &p_trace->p_configs[allocator];
+    size_t configured_footprint = planner_get_footprint(p_config->buffer_size, p_config->min_block_size, p_config->max_block_size);
+    size_t planned_footprint = planner_get_footprint(p_plan->buffer_size, p_plan->min_block_size, p_plan->max_block_size);
+
+    fprintf(p_file, "allocator %zu: buffer size %llu, block sizes %u to %u, %zu bytes\n",
+            allocator, (unsigned long long)p_config->buffer_size, p_config->min_block_size, p_config->max_block_size, configured_footprint);
+    fprintf(p_file, "  block sizes     min_block_size %u, max_block_size %u\n",
+            p_plan->min_block_size, p_plan->max_block_size);
+    fprintf(p_file, "  peak demand     %zu bytes, %.1f%% of the buffer\n",
+            p_plan->peak_demand, (p_config->buffer_size > 0) ? (100.0 * (double)p_plan->peak_demand / (double)p_config->buffer_size) : 0.0);
+    fprintf(p_file, "  buffer size     %zu for at most %.3f%% out of memory, %zu bytes (%.1f%% of now)\n",
+            p_plan->buffer_size, 100.0 * p_plan->target_rate, planned_footprint,
+            (configured_footprint > 0) ? (100.0 * (double)planned_footprint / (double)configured_footprint) : 0.0);
+
+    fprintf(p_file, "  %12s %14s %12s\n", "buffer size", "out of memory", "bytes");
+    for (size_t i = 0; i < buffer_size_count; i++) {
+        planner_simulation_t simulation;
+        if (planner_simulate(p_trace, allocator, p_buffer_sizes[i], p_plan->min_block_size, p_plan->max_block_size, &simulation) == false) {
+            continue;
+        }
+        fprintf(p_file, "  %12zu %13.3f%% %12zu\n",
+                p_buffer_sizes[i], 100.0 * get_rate(&simulation), planner_get_footprint(p_buffer_sizes[i], p_plan->min_block_size, p_plan->max_block_size));
+    }
+}
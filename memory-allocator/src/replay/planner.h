@@ -0,0 +1,100 @@
+#ifndef PLANNER_H_
+#define PLANNER_H_
+
+#include "replay.h"
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+#include "stdio.h"
+
+typedef struct {
+    uint64_t allocs;            // Allocations simulated, the ones that failed in the trace are not
+    uint64_t out_of_memory;
+    uint64_t unsupported_size;
+    size_t peak_utilization;    // Peak number of bytes in use
+} planner_simulation_t;
+
+typedef struct {
+    size_t configured_buffer_size;  // Buffer size the allocator had in the trace
+    uint8_t min_block_size;         // Smallest block allocated, the largest minimum that rejects nothing
+    uint8_t max_block_size;         // Largest block allocated
+    size_t peak_demand;             // Peak number of bytes held, the smallest buffer that never runs out of memory
+    double target_rate;             // Out of memory rate the buffer size was planned for
+    size_t buffer_size;             // Smallest buffer size that meets the target
+} planner_plan_t;
+
+/**
+ * @brief       Simulates one allocator of a trace with another configuration.
+ *
+ * The simulation follows the accounting of the allocator: a block fits if it fits in the buffer_size bytes
+ * the data buffer can hold besides its extra slot, and the size buffer has room for the buffer_size / min_block_size
+ * blocks the smallest blocks would take. Peeks and frees are consumed in order like in replay_run().
+ *
+ * @param[in]  p_trace          pointer to the trace
+ * @param[in]  allocator        index of the allocator in the trace
+ * @param[in]  buffer_size      buffer size to simulate
+ * @param[in]  min_block_size   minimum block size to simulate
+ * @param[in]  max_block_size   maximum block size to simulate
+ * @param[out] p_simulation     pointer to the result
+ *
+ * @return bool                 - true if the allocator was simulated
+ *                              - false if memory ran out
+ */
+bool planner_simulate(const replay_trace_t* p_trace,
+                      size_t allocator,
+                      size_t buffer_size,
+                      uint8_t min_block_size,
+                      uint8_t max_block_size,
+                      planner_simulation_t* p_simulation);
+
+/**
+ * @brief       Finds the smallest configuration of an allocator that keeps the trace under an out of memory rate.
+ *
+ * The block size range is the narrowest one that supports every block in the trace, which also makes the
+ * size buffer as small as it can be. The buffer size is searched for assuming larger buffers never run out
+ * of memory more often.
+ *
+ * @param[in]  p_trace          pointer to the trace
+ * @param[in]  allocator        index of the allocator in the trace
+ * @param[in]  target_rate      fraction of the allocations that can run out of memory, between 0 and 1
+ * @param[out] p_plan           pointer to the plan
+ *
+ * @return bool                 - true if the plan was made
+ *                              - false if the allocator allocated nothing or memory ran out
+ */
+bool planner_plan(const replay_trace_t* p_trace,
+                  size_t allocator,
+                  double target_rate,
+                  planner_plan_t* p_plan);
+
+/**
+ * @brief       Returns the memory an allocator takes for its data and size buffers.
+ *
+ * @param[in] buffer_size       buffer size of the allocator
+ * @param[in] min_block_size    minimum block size of the allocator
+ * @param[in] max_block_size    maximum block size of the allocator
+ *
+ * @return size_t               bytes allocated by allocator_init() besides the allocator_t
+ */
+size_t planner_get_footprint(size_t buffer_size,
+                             uint8_t min_block_size,
+                             uint8_t max_block_size);
+
+/**
+ * @brief       Prints a plan and the out of memory rate at a set of buffer sizes.
+ *
+ * @param[in] p_trace           pointer to the trace
+ * @param[in] allocator         index of the allocator in the trace
+ * @param[in] p_plan            pointer to the plan of the allocator
+ * @param[in] p_buffer_sizes    buffer sizes to print the out of memory rate at
+ * @param[in] buffer_size_count number of buffer sizes
+ * @param[in] p_file            file to print to
+ */
+void planner_print_plan(const replay_trace_t* p_trace,
+                        size_t allocator,
+                        const planner_plan_t* p_plan,
+                        const size_t* p_buffer_sizes,
+                        size_t buffer_size_count,
+                        FILE* p_file);
+
+#endif  // PLANNER_H_
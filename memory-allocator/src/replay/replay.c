@@ -0,0 +1,524 @@
+#include "replay.h"
+#include "timing.h"
+
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+
+// Waits longer than this are slept through, shorter ones are spun
+#define PACE_SPIN_NS 100000
+
+// Initial number of records and blocks the growable arrays hold
+#define INITIAL_CAPACITY 1024
+
+// Blocks the trace holds in one allocator, oldest first, and whether the replay managed to allocate them.
+// In overwrite-oldest mode the consumer takes whatever block is the oldest instead, as it would in a live process
+typedef struct {
+    allocator_t* p_allocator;
+    bool overwrite_oldest;
+    bool* p_present;
+    size_t head;
+    size_t count;
+    size_t capacity;    // Power of two
+    size_t buffer_size;
+    size_t peak;
+} replay_state_t;
+
+static uint64_t next_random(uint64_t* p_state) {
+    *p_state ^= *p_state >> 12;
+    *p_state ^= *p_state << 25;
+    *p_state ^= *p_state >> 27;
+    return *p_state * 0x2545F4914F6CDD1Dull;
+}
+
+static bool grow(void** pp_array, size_t* p_capacity, size_t element_size) {
+    size_t capacity = (*p_capacity == 0) ? INITIAL_CAPACITY : (*p_capacity * 2);
+    void* p_array = realloc(*pp_array, capacity * element_size);
+    if (p_array == NULL) {
+        return false;
+    }
+    *pp_array = p_array;
+    *p_capacity = capacity;
+    return true;
+}
+
+// Stable, so records of the same thread with equal timestamps stay in order
+static bool sort_records(allocator_trace_record_t* p_records, size_t count) {
+    allocator_trace_record_t* p_scratch = (allocator_trace_record_t*)malloc(count * sizeof(allocator_trace_record_t));
+    if (p_scratch == NULL) {
+        return false;
+    }
+
+    allocator_trace_record_t* p_from = p_records;
+    allocator_trace_record_t* p_to = p_scratch;
+    for (size_t width = 1; width < count; width *= 2) {
+        for (size_t start = 0; start < count; start += 2 * width) {
+            size_t middle = (start + width < count) ? (start + width) : count;
+            size_t end = (start + 2 * width < count) ? (start + 2 * width) : count;
+            size_t left = start;
+            size_t right = middle;
+
+            for (size_t i = start; i < end; i++) {
+                if ((left < middle) && ((right == end) || (p_from[left].time_ns <= p_from[right].time_ns))) {
+                    p_to[i] = p_from[left++];
+                } else {
+                    p_to[i] = p_from[right++];
+                }
+            }
+        }
+        allocator_trace_record_t* p_swap = p_from;
+        p_from = p_to;
+        p_to = p_swap;
+    }
+
+    if (p_from != p_records) {
+        memcpy(p_records, p_from, count * sizeof(allocator_trace_record_t));
+    }
+    free(p_scratch);
+    return true;
+}
+
+// Turns allocator ids into indexes in p_configs and drops the records of allocators without a configuration
+static bool index_allocators(replay_trace_t* p_trace, const uint32_t* p_ids, uint32_t max_id) {
+    uint32_t* p_indexes = (uint32_t*)malloc(((size_t)max_id + 1) * sizeof(uint32_t));
+    if (p_indexes == NULL) {
+        return false;
+    }
+
+    memset(p_indexes, 0xFF, ((size_t)max_id + 1) * sizeof(uint32_t));
+    for (size_t i = 0; i < p_trace->allocator_count; i++) {
+        p_indexes[p_ids[i]] = (uint32_t)i;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < p_trace->record_count; i++) {
+        allocator_trace_record_t record = p_trace->p_records[i];
+        if ((record.allocator_id <= max_id) && (p_indexes[record.allocator_id] != UINT32_MAX)) {
+            record.allocator_id = p_indexes[record.allocator_id];
+            p_trace->p_records[kept++] = record;
+        }
+    }
+    p_trace->record_count = kept;
+    free(p_indexes);
+    return true;
+}
+
+static bool push_block(replay_state_t* p_state, bool present) {
+    if (p_state->count == p_state->capacity) {
+        bool* p_present = (bool*)malloc(((p_state->capacity == 0) ? INITIAL_CAPACITY : (p_state->capacity * 2)) * sizeof(bool));
+        if (p_present == NULL) {
+            return false;
+        }
+
+        // Unwrap the ring while moving it
+        for (size_t i = 0; i < p_state->count; i++) {
+            p_present[i] = p_state->p_present[(p_state->head + i) & (p_state->capacity - 1)];
+        }
+        free(p_state->p_present);
+        p_state->p_present = p_present;
+        p_state->head = 0;
+        p_state->capacity = (p_state->capacity == 0) ? INITIAL_CAPACITY : (p_state->capacity * 2);
+    }
+
+    p_state->p_present[(p_state->head + p_state->count) & (p_state->capacity - 1)] = present;
+    p_state->count++;
+    return true;
+}
+
+static void pop_block(replay_state_t* p_state) {
+    p_state->head = (p_state->head + 1) & (p_state->capacity - 1);
+    p_state->count--;
+}
+
+static void wait_until(uint64_t target_ns) {
+    uint64_t now_ns = timing_now_ns();
+
+    if (target_ns > now_ns + PACE_SPIN_NS) {
+        uint64_t sleep_ns = target_ns - now_ns - PACE_SPIN_NS;
+        struct timespec duration = {
+            .tv_sec = (time_t)(sleep_ns / 1000000000u),
+            .tv_nsec = (long)(sleep_ns % 1000000000u),
+        };
+        nanosleep(&duration, NULL);
+    }
+    while (timing_now_ns() < target_ns) {
+        // Spin for the last stretch, sleeping isn't precise enough
+    }
+}
+
+// Returns false if the block couldn't be tracked for the operations that follow
+static bool replay_alloc(replay_state_t* p_state, const allocator_trace_record_t* p_record, replay_result_t* p_result) {
+    uint8_t* p_block = NULL;
+
+    p_result->allocs++;
+    uint64_t start = timing_now_ticks();
+    allocator_error_t error = allocator_alloc(p_state->p_allocator, p_record->size, &p_block);
+    allocator_latency_histogram_record(&p_result->latency[ALLOCATOR_OP_ALLOC], timing_now_ticks() - start);
+
+    if (error == ALLOCATOR_ERROR_OUT_OF_MEMORY) {
+        p_result->out_of_memory++;
+    } else if (error != ALLOCATOR_SUCCESS) {
+        p_result->unsupported_size++;
+    }
+
+    size_t utilization = allocator_get_utilization(p_state->p_allocator);
+    if (utilization > p_state->peak) {
+        p_state->peak = utilization;
+    }
+    return push_block(p_state, error == ALLOCATOR_SUCCESS);
+}
+
+static void replay_peek(replay_state_t* p_state, replay_result_t* p_result) {
+    if ((p_state->overwrite_oldest == false) &&
+        ((p_state->count == 0) || (p_state->p_present[p_state->head] == false))) {
+        p_result->skipped++;
+        return;
+    }
+
+    uint8_t* p_block = NULL;
+    size_t block_size = 0;
+    uint64_t start = timing_now_ticks();
+    allocator_error_t error = allocator_peek(p_state->p_allocator, &p_block, &block_size);
+    allocator_latency_histogram_record(&p_result->latency[ALLOCATOR_OP_PEEK], timing_now_ticks() - start);
+    if (error != ALLOCATOR_SUCCESS) {
+        p_result->skipped++;
+    }
+}
+
+static void replay_free(replay_state_t* p_state, replay_result_t* p_result) {
+    if ((p_state->overwrite_oldest == false) &&
+        ((p_state->count == 0) || (p_state->p_present[p_state->head] == false))) {
+        if (p_state->count > 0) {
+            pop_block(p_state);
+        }
+        p_result->skipped++;
+        return;
+    }
+
+    uint64_t start = timing_now_ticks();
+    allocator_error_t error = allocator_free(p_state->p_allocator);
+    allocator_latency_histogram_record(&p_result->latency[ALLOCATOR_OP_FREE], timing_now_ticks() - start);
+    if (error != ALLOCATOR_SUCCESS) {
+        p_result->skipped++;
+    }
+    if (p_state->count > 0) {
+        pop_block(p_state);
+    }
+}
+
+/**
+ * @brief       Loads a trace recorded with allocator_trace_start().
+ *
+ * @param[in]  p_path           path of the trace
+ * @param[out] p_trace          pointer to the trace, to be released with replay_trace_release()
+ *
+ * @return bool                 - true if the trace was loaded
+ *                              - false if it couldn't be read or memory ran out
+ */
+bool replay_trace_load(const char* p_path, replay_trace_t* p_trace) {
+    memset(p_trace, 0, sizeof(replay_trace_t));
+
+    FILE* p_file = allocator_trace_open(p_path);
+    if (p_file == NULL) {
+        return false;
+    }
+
+    allocator_trace_record_t record;
+    allocator_trace_config_t config;
+    size_t record_capacity = 0;
+    size_t allocator_capacity = 0;
+    uint32_t* p_ids = NULL;
+    uint32_t max_id = 0;
+    bool loaded = true;
+
+    while ((loaded == true) && (allocator_trace_read(p_file, &record, &config) == true)) {
+        if (record.op == ALLOCATOR_TRACE_OP_INIT) {
+            if (p_trace->allocator_count == allocator_capacity) {
+                size_t id_capacity = allocator_capacity;
+                loaded = grow((void**)&p_trace->p_configs, &allocator_capacity, sizeof(allocator_trace_config_t)) &&
+                         grow((void**)&p_ids, &id_capacity, sizeof(uint32_t));
+                if (loaded == false) {
+                    break;
+                }
+            }
+            p_trace->p_configs[p_trace->allocator_count] = config;
+            p_ids[p_trace->allocator_count] = record.allocator_id;
+            p_trace->allocator_count++;
+            max_id = (record.allocator_id > max_id) ? record.allocator_id : max_id;
+        } else if (record.op != ALLOCATOR_TRACE_OP_UNINIT) {
+            if (p_trace->record_count == record_capacity) {
+                loaded = grow((void**)&p_trace->p_records, &record_capacity, sizeof(allocator_trace_record_t));
+                if (loaded == false) {
+                    break;
+                }
+            }
+            p_trace->p_records[p_trace->record_count++] = record;
+        }
+    }
+    fclose(p_file);
+
+    loaded = loaded &&
+             sort_records(p_trace->p_records, p_trace->record_count) &&
+             index_allocators(p_trace, p_ids, max_id);
+    free(p_ids);
+
+    if (loaded == false) {
+        replay_trace_release(p_trace);
+    }
+    return loaded;
+}
+
+/**
+ * @brief       Generates a trace of one producer and one consumer sharing an allocator.
+ *
+ * Blocks of uniformly distributed sizes are allocated at a steady rate, with some jitter. The consumer
+ * peeks at and frees half of the blocks whenever more than backlog of them pile up.
+ *
+ * @param[in]  p_generator      pointer to the parameters of the trace
+ * @param[out] p_trace          pointer to the trace, to be released with replay_trace_release()
+ *
+ * @return bool                 - true if the trace was generated
+ *                              - false if the parameters are invalid or memory ran out
+ */
+bool replay_trace_generate(const replay_generator_t* p_generator, replay_trace_t* p_trace) {
+    memset(p_trace, 0, sizeof(replay_trace_t));
+
+    if ((p_generator->blocks == 0) || (p_generator->rate <= 0.0) ||
+        (p_generator->min_block_size == 0) || (p_generator->min_block_size > p_generator->max_block_size)) {
+        return false;
+    }
+
+    // Every block is allocated, peeked at and freed, except the ones still held at the end
+    size_t capacity = p_generator->blocks * 3;
+    p_trace->p_records = (allocator_trace_record_t*)malloc(capacity * sizeof(allocator_trace_record_t));
+    p_trace->p_configs = (allocator_trace_config_t*)calloc(1, sizeof(allocator_trace_config_t));
+    if ((p_trace->p_records == NULL) || (p_trace->p_configs == NULL)) {
+        replay_trace_release(p_trace);
+        return false;
+    }
+
+    p_trace->allocator_count = 1;
+    p_trace->p_configs[0].buffer_size = p_generator->buffer_size;
+    p_trace->p_configs[0].min_block_size = p_generator->min_block_size;
+    p_trace->p_configs[0].max_block_size = p_generator->max_block_size;
+
+    uint64_t state = (p_generator->seed != 0) ? p_generator->seed : 1;
+    uint64_t size_range = (uint64_t)(p_generator->max_block_size - p_generator->min_block_size) + 1;
+    double mean_gap_ns = 1e9 / p_generator->rate;
+    double time_ns = 0.0;
+    size_t outstanding = 0;
+    const allocator_trace_record_t consumed = { .op = ALLOCATOR_TRACE_OP_PEEK, .result = ALLOCATOR_SUCCESS };
+
+    // Sizes of the blocks the consumer hasn't freed yet, needed for its peeks and frees
+    uint8_t* p_sizes = (uint8_t*)malloc(p_generator->blocks);
+    if (p_sizes == NULL) {
+        replay_trace_release(p_trace);
+        return false;
+    }
+
+    size_t oldest = 0;
+    for (size_t block = 0; block < p_generator->blocks; block++) {
+        // Gaps are uniform between 0 and twice the mean
+        time_ns += mean_gap_ns * (double)(next_random(&state) >> 11) * (2.0 / 9007199254740992.0);
+        p_sizes[block] = (uint8_t)(p_generator->min_block_size + next_random(&state) % size_range);
+
+        allocator_trace_record_t* p_record = &p_trace->p_records[p_trace->record_count++];
+        memset(p_record, 0, sizeof(allocator_trace_record_t));
+        p_record->time_ns = (uint64_t)time_ns;
+        p_record->size = p_sizes[block];
+        p_record->op = ALLOCATOR_TRACE_OP_ALLOC;
+        p_record->result = ALLOCATOR_SUCCESS;
+        outstanding++;
+
+        if (outstanding > p_generator->backlog) {
+            size_t target = p_generator->backlog / 2;
+            while (outstanding > target) {
+                allocator_trace_record_t* p_peek = &p_trace->p_records[p_trace->record_count++];
+                *p_peek = consumed;
+                p_peek->time_ns = (uint64_t)time_ns;
+                p_peek->size = p_sizes[oldest];
+
+                allocator_trace_record_t* p_free = &p_trace->p_records[p_trace->record_count++];
+                *p_free = *p_peek;
+                p_free->op = ALLOCATOR_TRACE_OP_FREE;
+
+                oldest++;
+                outstanding--;
+            }
+        }
+    }
+    free(p_sizes);
+    return true;
+}
+
+/**
+ * @brief       Saves a trace in the format of allocator_trace.h.
+ *
+ * @param[in] p_trace           pointer to the trace
+ * @param[in] p_path            path of the file, truncated if it exists
+ *
+ * @return bool                 - true if the trace was saved
+ *                              - false otherwise
+ */
+bool replay_trace_save(const replay_trace_t* p_trace, const char* p_path) {
+    FILE* p_file = fopen(p_path, "wb");
+    if (p_file == NULL) {
+        return false;
+    }
+
+    const allocator_trace_header_t header = {
+        .magic = ALLOCATOR_TRACE_MAGIC,
+        .version = ALLOCATOR_TRACE_VERSION,
+    };
+    bool saved = (fwrite(&header, sizeof(header), 1, p_file) == 1);
+
+    for (size_t i = 0; (saved == true) && (i < p_trace->allocator_count); i++) {
+        const allocator_trace_record_t init = {
+            .allocator_id = (uint32_t)i,
+            .op = ALLOCATOR_TRACE_OP_INIT,
+            .result = ALLOCATOR_SUCCESS,
+        };
+        saved = (fwrite(&init, sizeof(init), 1, p_file) == 1) &&
+                (fwrite(&p_trace->p_configs[i], sizeof(allocator_trace_config_t), 1, p_file) == 1);
+    }
+    if ((saved == true) && (p_trace->record_count > 0)) {
+        saved = (fwrite(p_trace->p_records, sizeof(allocator_trace_record_t), p_trace->record_count, p_file) == p_trace->record_count);
+    }
+
+    return (fclose(p_file) == 0) && saved;
+}
+
+/**
+ * @brief       Releases the memory of a trace.
+ *
+ * @param[in] p_trace           pointer to the trace
+ */
+void replay_trace_release(replay_trace_t* p_trace) {
+    free(p_trace->p_records);
+    free(p_trace->p_configs);
+    memset(p_trace, 0, sizeof(replay_trace_t));
+}
+
+/**
+ * @brief       Replays a trace on new allocators, from a single thread.
+ *
+ * Blocks are consumed in order, so a peek or a free in the trace applies to the oldest block the trace
+ * holds. When that block couldn't be allocated in the replay the operation is skipped. In overwrite-oldest
+ * mode they apply to the oldest block the allocator holds instead, as they would in a live process.
+ *
+ * @param[in]  p_trace          pointer to the trace
+ * @param[in]  p_options        pointer to the configuration to replay with
+ * @param[out] p_result         pointer to the result
+ *
+ * @return bool                 - true if the trace was replayed
+ *                              - false if an allocator couldn't be created or the replay ran out of memory
+ */
+bool replay_run(const replay_trace_t* p_trace, const replay_options_t* p_options, replay_result_t* p_result) {
+    memset(p_result, 0, sizeof(replay_result_t));
+
+    replay_state_t* p_states = (replay_state_t*)calloc(p_trace->allocator_count, sizeof(replay_state_t));
+    if ((p_states == NULL) && (p_trace->allocator_count > 0)) {
+        return false;
+    }
+
+    bool replayed = true;
+    for (size_t i = 0; i < p_trace->allocator_count; i++) {
+        const allocator_trace_config_t* p_config = &p_trace->p_configs[i];
+        replay_state_t* p_state = &p_states[i];
+
+        p_state->buffer_size = (p_options->buffer_size != 0) ? p_options->buffer_size : p_config->buffer_size;
+        p_state->p_allocator = allocator_init(p_state->buffer_size,
+                                              (p_options->min_block_size != 0) ? p_options->min_block_size : p_config->min_block_size,
+                                              (p_options->max_block_size != 0) ? p_options->max_block_size : p_config->max_block_size);
+        if (p_state->p_allocator == NULL) {
+            replayed = false;
+            break;
+        }
+        p_state->overwrite_oldest = p_options->overwrite_oldest;
+        allocator_set_overwrite_oldest(p_state->p_allocator, p_options->overwrite_oldest);
+    }
+
+    if (replayed == true) {
+        uint64_t start_ns = timing_now_ns();
+        uint64_t first_ns = (p_trace->record_count > 0) ? p_trace->p_records[0].time_ns : 0;
+
+        for (size_t i = 0; i < p_trace->record_count; i++) {
+            const allocator_trace_record_t* p_record = &p_trace->p_records[i];
+            replay_state_t* p_state = &p_states[p_record->allocator_id];
+
+            if (p_options->pace == REPLAY_PACE_ORIGINAL) {
+                wait_until(start_ns + (p_record->time_ns - first_ns));
+            }
+
+            if (p_record->op == ALLOCATOR_TRACE_OP_ALLOC) {
+                if (p_record->result != ALLOCATOR_SUCCESS) {
+                    p_result->trace_failures++;
+                    continue;
+                }
+                if (replay_alloc(p_state, p_record, p_result) == false) {
+                    replayed = false;
+                    break;
+                }
+            } else if (p_record->op == ALLOCATOR_TRACE_OP_PEEK) {
+                replay_peek(p_state, p_result);
+            } else {
+                replay_free(p_state, p_result);
+            }
+            p_result->operations++;
+        }
+        p_result->elapsed_ns = timing_now_ns() - start_ns;
+    }
+
+    for (size_t i = 0; i < p_trace->allocator_count; i++) {
+        replay_state_t* p_state = &p_states[i];
+
+        // Reports the allocator that came closest to running out of memory
+        if ((p_result->buffer_size == 0) ||
+            ((double)p_state->peak / (double)p_state->buffer_size > (double)p_result->peak_utilization / (double)p_result->buffer_size)) {
+            p_result->peak_utilization = p_state->peak;
+            p_result->buffer_size = p_state->buffer_size;
+        }
+        if (p_state->p_allocator != NULL) {
+            uint64_t dropped_blocks;
+            allocator_get_dropped(p_state->p_allocator, &dropped_blocks, NULL);
+            p_result->dropped_blocks += dropped_blocks;
+            allocator_uninit(p_state->p_allocator);
+        }
+        free(p_state->p_present);
+    }
+    free(p_states);
+    return replayed;
+}
+
+/**
+ * @brief       Prints the throughput, failures, peak utilization and latency percentiles of a replay.
+ *
+ * @param[in] p_result          pointer to the result
+ * @param[in] p_file            file to print to
+ */
+void replay_print_result(const replay_result_t* p_result, FILE* p_file) {
+    static const char* op_names[ALLOCATOR_OP_COUNT] = { "alloc", "peek", "free" };
+    double seconds = (double)p_result->elapsed_ns / 1e9;
+    double allocs = (p_result->allocs > 0) ? (double)p_result->allocs : 1.0;
+
+    fprintf(p_file, "operations       %llu in %.3f s, %.0f ops/s\n",
+            (unsigned long long)p_result->operations, seconds, (seconds > 0.0) ? ((double)p_result->operations / seconds) : 0.0);
+    fprintf(p_file, "out of memory    %llu of %llu allocations (%.3f%%)\n",
+            (unsigned long long)p_result->out_of_memory, (unsigned long long)p_result->allocs, 100.0 * (double)p_result->out_of_memory / allocs);
+    if (p_result->unsupported_size > 0) {
+        fprintf(p_file, "unsupported size %llu allocations\n", (unsigned long long)p_result->unsupported_size);
+    }
+    if (p_result->dropped_blocks > 0) {
+        fprintf(p_file, "dropped          %llu blocks evicted\n", (unsigned long long)p_result->dropped_blocks);
+    }
+    if (p_result->trace_failures > 0) {
+        fprintf(p_file, "not replayed     %llu allocations that had failed in the trace\n", (unsigned long long)p_result->trace_failures);
+    }
+    fprintf(p_file, "peak utilization %zu of %zu bytes (%.1f%%)\n",
+            p_result->peak_utilization, p_result->buffer_size,
+            (p_result->buffer_size > 0) ? (100.0 * (double)p_result->peak_utilization / (double)p_result->buffer_size) : 0.0);
+
+    for (size_t i = 0; i < ALLOCATOR_OP_COUNT; i++) {
+        allocator_latency_histogram_print(&p_result->latency[i], op_names[i], p_file);
+    }
+}
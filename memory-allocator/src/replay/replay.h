@@ -0,0 +1,129 @@
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include "allocator.h"
+#include "allocator_latency.h"
+#include "allocator_trace.h"
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+#include "stdio.h"
+
+typedef struct {
+    allocator_trace_record_t* p_records;    // Alloc, peek and free records sorted by time, allocator_id indexes p_configs
+    size_t record_count;
+    allocator_trace_config_t* p_configs;    // Configuration of every allocator in the trace
+    size_t allocator_count;
+} replay_trace_t;
+
+typedef struct {
+    size_t blocks;          // Number of blocks allocated
+    double rate;            // Blocks allocated per second
+    uint8_t min_block_size;
+    uint8_t max_block_size;
+    size_t backlog;         // Blocks the consumer lets pile up before it catches up on half of them
+    size_t buffer_size;     // Buffer size recorded in the trace
+    uint64_t seed;
+} replay_generator_t;
+
+typedef enum {
+    REPLAY_PACE_FAST,       // As fast as possible
+    REPLAY_PACE_ORIGINAL,   // Every operation at the time it was recorded
+} replay_pace_t;
+
+typedef struct {
+    replay_pace_t pace;
+    bool overwrite_oldest;  // Replay in overwrite-oldest mode instead of failing with out of memory
+    size_t buffer_size;     // 0 keeps the buffer size of the trace
+    uint8_t min_block_size; // 0 keeps the minimum block size of the trace
+    uint8_t max_block_size; // 0 keeps the maximum block size of the trace
+} replay_options_t;
+
+typedef struct {
+    uint64_t operations;        // Operations replayed
+    uint64_t elapsed_ns;
+    uint64_t allocs;            // Allocations replayed, the ones that failed in the trace are not
+    uint64_t out_of_memory;     // Allocations that succeeded in the trace but ran out of memory
+    uint64_t unsupported_size;  // Allocations that succeeded in the trace but not with the configured block sizes
+    uint64_t dropped_blocks;    // Blocks evicted in overwrite-oldest mode
+    uint64_t skipped;           // Peeks and frees of blocks the replay doesn't hold
+    uint64_t trace_failures;    // Allocations that had failed in the trace
+    size_t peak_utilization;    // Peak number of bytes in use, of the allocator that came closest to full
+    size_t buffer_size;         // Buffer size of that allocator
+    allocator_latency_histogram_t latency[ALLOCATOR_OP_COUNT];  // In ticks of timing_now_ticks()
+} replay_result_t;
+
+/**
+ * @brief       Loads a trace recorded with allocator_trace_start().
+ *
+ * @param[in]  p_path           path of the trace
+ * @param[out] p_trace          pointer to the trace, to be released with replay_trace_release()
+ *
+ * @return bool                 - true if the trace was loaded
+ *                              - false if it couldn't be read or memory ran out
+ */
+bool replay_trace_load(const char* p_path,
+                       replay_trace_t* p_trace);
+
+/**
+ * @brief       Generates a trace of one producer and one consumer sharing an allocator.
+ *
+ * Blocks of uniformly distributed sizes are allocated at a steady rate, with some jitter. The consumer
+ * peeks at and frees half of the blocks whenever more than backlog of them pile up.
+ *
+ * @param[in]  p_generator      pointer to the parameters of the trace
+ * @param[out] p_trace          pointer to the trace, to be released with replay_trace_release()
+ *
+ * @return bool                 - true if the trace was generated
+ *                              - false if the parameters are invalid or memory ran out
+ */
+bool replay_trace_generate(const replay_generator_t* p_generator,
+                           replay_trace_t* p_trace);
+
+/**
+ * @brief       Saves a trace in the format of allocator_trace.h.
+ *
+ * @param[in] p_trace           pointer to the trace
+ * @param[in] p_path            path of the file, truncated if it exists
+ *
+ * @return bool                 - true if the trace was saved
+ *                              - false otherwise
+ */
+bool replay_trace_save(const replay_trace_t* p_trace,
+                       const char* p_path);
+
+/**
+ * @brief       Releases the memory of a trace.
+ *
+ * @param[in] p_trace           pointer to the trace
+ */
+void replay_trace_release(replay_trace_t* p_trace);
+
+/**
+ * @brief       Replays a trace on new allocators, from a single thread.
+ *
+ * Blocks are consumed in order, so a peek or a free in the trace applies to the oldest block the trace
+ * holds. When that block couldn't be allocated in the replay the operation is skipped. In overwrite-oldest
+ * mode they apply to the oldest block the allocator holds instead, as they would in a live process.
+ *
+ * @param[in]  p_trace          pointer to the trace
+ * @param[in]  p_options        pointer to the configuration to replay with
+ * @param[out] p_result         pointer to the result
+ *
+ * @return bool                 - true if the trace was replayed
+ *                              - false if an allocator couldn't be created or the replay ran out of memory
+ */
+bool replay_run(const replay_trace_t* p_trace,
+                const replay_options_t* p_options,
+                replay_result_t* p_result);
+
+/**
+ * @brief       Prints the throughput, failures, peak utilization and latency percentiles of a replay.
+ *
+ * @param[in] p_result          pointer to the result
+ * @param[in] p_file            file to print to
+ */
+void replay_print_result(const replay_result_t* p_result,
+                         FILE* p_file);
+
+#endif  // REPLAY_H_
@@ -0,0 +1,89 @@
+#include "timing.h"
+
+#include "time.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include "x86intrin.h"
+#define TIMING_USE_TSC 1
+#else
+#define TIMING_USE_TSC 0
+#endif
+
+// How long the tick counter is measured against CLOCK_MONOTONIC when calibrating
+#define CALIBRATION_NS 10000000u
+
+// Nanoseconds per tick, 0 until calibrated. Racing calibrations all store about the same value
+static double ns_per_tick = 0.0;
+
+/**
+ * @brief       Reads CLOCK_MONOTONIC.
+ *
+ * @return uint64_t             current time in nanoseconds
+ */
+uint64_t timing_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief       Reads a cheap monotonic tick counter.
+ *
+ * On x86 this is the TSC, elsewhere it's CLOCK_MONOTONIC in nanoseconds.
+ * Ticks are only meaningful as differences, use timing_ticks_to_ns() to convert them.
+ *
+ * @return uint64_t             current tick count
+ */
+uint64_t timing_now_ticks(void) {
+#if TIMING_USE_TSC
+    return __rdtsc();
+#else
+    return timing_now_ns();
+#endif
+}
+
+/**
+ * @brief       Calibrates the tick counter against CLOCK_MONOTONIC if it hasn't been yet.
+ */
+void timing_calibrate(void) {
+    double current;
+
+    __atomic_load(&ns_per_tick, &current, __ATOMIC_RELAXED);
+    if (current != 0.0) {
+        return;
+    }
+
+#if TIMING_USE_TSC
+    uint64_t start_ns = timing_now_ns();
+    uint64_t start_ticks = timing_now_ticks();
+    uint64_t end_ns;
+
+    do {
+        end_ns = timing_now_ns();
+    } while (end_ns - start_ns < CALIBRATION_NS);
+
+    double calibrated = (double)(end_ns - start_ns) / (double)(timing_now_ticks() - start_ticks);
+#else
+    double calibrated = 1.0;
+#endif
+
+    __atomic_store(&ns_per_tick, &calibrated, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief       Converts a number of ticks to nanoseconds.
+ *
+ * The first call calibrates the tick counter against CLOCK_MONOTONIC, which takes
+ * a few milliseconds. Call timing_calibrate() at start-up to avoid paying for it later.
+ *
+ * @param[in] ticks             number of ticks
+ *
+ * @return uint64_t             number of nanoseconds
+ */
+uint64_t timing_ticks_to_ns(uint64_t ticks) {
+    double calibrated;
+
+    timing_calibrate();
+    __atomic_load(&ns_per_tick, &calibrated, __ATOMIC_RELAXED);
+    return (uint64_t)((double)ticks * calibrated);
+}
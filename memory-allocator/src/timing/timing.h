@@ -0,0 +1,40 @@
+#ifndef TIMING_H_
+#define TIMING_H_
+
+#include "stdint.h"
+
+/**
+ * @brief       Reads a cheap monotonic tick counter.
+ *
+ * On x86 this is the TSC, elsewhere it's CLOCK_MONOTONIC in nanoseconds.
+ * Ticks are only meaningful as differences, use timing_ticks_to_ns() to convert them.
+ *
+ * @return uint64_t             current tick count
+ */
+uint64_t timing_now_ticks(void);
+
+/**
+ * @brief       Converts a number of ticks to nanoseconds.
+ *
+ * The first call calibrates the tick counter against CLOCK_MONOTONIC, which takes
+ * a few milliseconds. Call timing_calibrate() at start-up to avoid paying for it later.
+ *
+ * @param[in] ticks             number of ticks
+ *
+ * @return uint64_t             number of nanoseconds
+ */
+uint64_t timing_ticks_to_ns(uint64_t ticks);
+
+/**
+ * @brief       Calibrates the tick counter against CLOCK_MONOTONIC if it hasn't been yet.
+ */
+void timing_calibrate(void);
+
+/**
+ * @brief       Reads CLOCK_MONOTONIC.
+ *
+ * @return uint64_t             current time in nanoseconds
+ */
+uint64_t timing_now_ns(void);
+
+#endif  // TIMING_H_
@@ -1,7 +1,68 @@
 
 #include "allocator.h"
+#include "logging_groups.h"
+#include "logging_levels.h"
+#include "pthread.h"
+#include "sched.h"
+#include "string.h"
+#include "time.h"
+#include "unistd.h"
 #include "unity.h"
 
+static void sleep_ms(long ms) {
+    struct timespec delay = { ms / 1000, (ms % 1000) * 1000000 };
+    nanosleep(&delay, NULL);
+}
+
+// Reads an eventfd, returning the number of times it was signalled since the last read
+static uint64_t read_event_fd(int fd) {
+    uint64_t count = 0;
+    if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+        return 0;
+    }
+    return count;
+}
+
+static void count_watermark_crossings(allocator_watermark_t watermark, void* p_context) {
+    int* p_crossings = (int*)p_context;
+    p_crossings[watermark]++;
+}
+
+static void* alloc_after_delay(void* p_arg) {
+    allocator_t* p_allocator = (allocator_t*)p_arg;
+    uint8_t* p_block = NULL;
+
+    sleep_ms(20);
+    allocator_alloc(p_allocator, 5, &p_block);
+    return NULL;
+}
+
+static void* free_after_delay(void* p_arg) {
+    allocator_t* p_allocator = (allocator_t*)p_arg;
+
+    sleep_ms(20);
+    allocator_free(p_allocator);
+    return NULL;
+}
+
+typedef struct {
+    allocator_t* p_allocator;
+    uint64_t blocks;
+    uint64_t freed;  // Written by the consumer
+} quota_race_t;
+
+static void* free_blocks(void* p_arg) {
+    quota_race_t* p_race = (quota_race_t*)p_arg;
+
+    for (uint64_t i = 0; i < p_race->blocks; i++) {
+        while (allocator_free(p_race->p_allocator) != ALLOCATOR_SUCCESS) {
+            sched_yield();
+        }
+        __atomic_store_n(&p_race->freed, i + 1, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
 void setUp(void) {
     // Nothing to set up
 }
@@ -160,6 +221,28 @@ void test_allocator_allocs_and_frees_different_sizes(void) {
     }
 }
 
+void test_allocator_alloc_wraps_around_contiguously(void) {
+    allocator_t* p_allocator = allocator_init(100, 1, 30);
+    uint8_t* p_block = NULL;
+    size_t block_size = 0;
+
+    // Blocks of 30 bytes don't divide the buffer, so they keep running past its end.
+    // Every byte of every block is written, so the sanitized build catches overflows
+    for (int i = 0; i < 50; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 30, &p_block));
+        for (int j = 0; j < 30; j++) {
+            p_block[j] = i;
+        }
+
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_peek(p_allocator, &p_block, &block_size));
+        TEST_ASSERT_EQUAL(30, block_size);
+        TEST_ASSERT_EACH_EQUAL_UINT8(i, p_block, 30);
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_free(p_allocator));
+    }
+
+    allocator_uninit(p_allocator);
+}
+
 void test_allocator_peek_error_on_empty_buffer(void) {
     allocator_t* p_allocator = allocator_init(100, 5, 10);
     uint8_t* p_block = NULL;
@@ -244,3 +327,604 @@ void test_allocator_check_peeked_data(void) {
         TEST_ASSERT_EQUAL(i * 4, p_peeked_block[i]);
     }
 }
+
+void test_allocator_peek_wait_times_out_on_empty_buffer(void) {
+    allocator_wait_strategy_t strategies[] = { ALLOCATOR_WAIT_BUSY_SPIN, ALLOCATOR_WAIT_SPIN_YIELD, ALLOCATOR_WAIT_FUTEX };
+
+    for (size_t i = 0; i < sizeof(strategies) / sizeof(strategies[0]); i++) {
+        allocator_t* p_allocator = allocator_init(100, 5, 10);
+        uint8_t* p_block = NULL;
+        size_t block_size = 0;
+
+        allocator_set_wait_strategy(p_allocator, strategies[i]);
+        allocator_error_t result = allocator_peek_wait(p_allocator, &p_block, &block_size, 1000000);
+        TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, result);
+        TEST_ASSERT(p_block == NULL);
+
+        allocator_uninit(p_allocator);
+    }
+}
+
+void test_allocator_alloc_wait_times_out_on_full_buffer(void) {
+    allocator_t* p_allocator = allocator_init(10, 5, 10);
+    uint8_t* p_block = NULL;
+    allocator_error_t result;
+
+    result = allocator_alloc(p_allocator, 10, &p_block);
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, result);
+
+    allocator_set_wait_strategy(p_allocator, ALLOCATOR_WAIT_FUTEX);
+    result = allocator_alloc_wait(p_allocator, 5, &p_block, 1000000);
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_OUT_OF_MEMORY, result);
+
+    // Unsupported sizes fail straight away instead of waiting
+    result = allocator_alloc_wait(p_allocator, 20, &p_block, ALLOCATOR_WAIT_FOREVER);
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_UNSUPPORTED_SIZE, result);
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_peek_wait_wakes_up_on_alloc(void) {
+    allocator_wait_strategy_t strategies[] = { ALLOCATOR_WAIT_BUSY_SPIN, ALLOCATOR_WAIT_SPIN_YIELD, ALLOCATOR_WAIT_FUTEX };
+
+    for (size_t i = 0; i < sizeof(strategies) / sizeof(strategies[0]); i++) {
+        allocator_t* p_allocator = allocator_init(100, 5, 10);
+        uint8_t* p_block = NULL;
+        size_t block_size = 0;
+        pthread_t producer;
+
+        allocator_set_wait_strategy(p_allocator, strategies[i]);
+        pthread_create(&producer, NULL, alloc_after_delay, p_allocator);
+
+        allocator_error_t result = allocator_peek_wait(p_allocator, &p_block, &block_size, ALLOCATOR_WAIT_FOREVER);
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, result);
+        TEST_ASSERT(p_block != NULL);
+        TEST_ASSERT_EQUAL(5, block_size);
+
+        pthread_join(producer, NULL);
+        allocator_uninit(p_allocator);
+    }
+}
+
+void test_allocator_alloc_wait_wakes_up_on_free(void) {
+    allocator_t* p_allocator = allocator_init(10, 5, 10);
+    uint8_t* p_block = NULL;
+    pthread_t consumer;
+    allocator_error_t result;
+
+    result = allocator_alloc(p_allocator, 10, &p_block);
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, result);
+
+    allocator_set_wait_strategy(p_allocator, ALLOCATOR_WAIT_FUTEX);
+    pthread_create(&consumer, NULL, free_after_delay, p_allocator);
+
+    p_block = NULL;
+    result = allocator_alloc_wait(p_allocator, 10, &p_block, ALLOCATOR_WAIT_FOREVER);
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, result);
+    TEST_ASSERT(p_block != NULL);
+
+    pthread_join(consumer, NULL);
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_event_fds_disabled_by_default(void) {
+    allocator_t* p_allocator = allocator_init(100, 5, 10);
+    TEST_ASSERT_EQUAL(-1, allocator_get_data_event_fd(p_allocator));
+    TEST_ASSERT_EQUAL(-1, allocator_get_space_event_fd(p_allocator));
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_data_event_fd_signalled_when_not_empty(void) {
+    allocator_t* p_allocator = allocator_init(100, 5, 10);
+    uint8_t* p_block = NULL;
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_enable_event_fds(p_allocator, 50));
+    int data_fd = allocator_get_data_event_fd(p_allocator);
+    TEST_ASSERT(data_fd >= 0);
+    TEST_ASSERT_EQUAL(0, read_event_fd(data_fd));
+
+    // Only the first block after the buffer was empty generates a signal
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 5, &p_block));
+    }
+    TEST_ASSERT_EQUAL(1, read_event_fd(data_fd));
+
+    // Drain the buffer, nothing should be signalled until it is refilled
+    while (allocator_free(p_allocator) == ALLOCATOR_SUCCESS) {
+    }
+    TEST_ASSERT_EQUAL(0, read_event_fd(data_fd));
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 5, &p_block));
+    TEST_ASSERT_EQUAL(1, read_event_fd(data_fd));
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_space_event_fd_signalled_below_watermark(void) {
+    allocator_t* p_allocator = allocator_init(100, 5, 10);
+    uint8_t* p_block = NULL;
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_enable_event_fds(p_allocator, 50));
+    int space_fd = allocator_get_space_event_fd(p_allocator);
+    TEST_ASSERT(space_fd >= 0);
+
+    // Fill the buffer up to 100 bytes
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 10, &p_block));
+    }
+
+    // Going from 100 down to 50 bytes used stays at or above the watermark
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_free(p_allocator));
+    }
+    TEST_ASSERT_EQUAL(0, read_event_fd(space_fd));
+
+    // Crossing below the watermark signals exactly once
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_free(p_allocator));
+    }
+    TEST_ASSERT_EQUAL(1, read_event_fd(space_fd));
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_overwrite_oldest_never_runs_out_of_memory(void) {
+    allocator_t* p_allocator = allocator_init(10, 1, 5);
+    uint8_t* p_block = NULL;
+    size_t block_size = 0;
+    uint64_t dropped_blocks = 0;
+    uint64_t dropped_bytes = 0;
+
+    allocator_set_overwrite_oldest(p_allocator, true);
+
+    // Write 20 blocks of 2 bytes, numbered in order
+    for (int i = 0; i < 20; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 2, &p_block));
+        p_block[0] = i;
+    }
+
+    // Only the 5 most recent blocks fit in the buffer
+    allocator_get_dropped(p_allocator, &dropped_blocks, &dropped_bytes);
+    TEST_ASSERT_EQUAL(15, dropped_blocks);
+    TEST_ASSERT_EQUAL(30, dropped_bytes);
+
+    for (int i = 15; i < 20; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_peek(p_allocator, &p_block, &block_size));
+        TEST_ASSERT_EQUAL(2, block_size);
+        TEST_ASSERT_EQUAL(i, p_block[0]);
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_free(p_allocator));
+    }
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_free(p_allocator));
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_overwrite_oldest_evicts_enough_for_bigger_blocks(void) {
+    allocator_t* p_allocator = allocator_init(10, 1, 5);
+    uint8_t* p_block = NULL;
+    size_t block_size = 0;
+    uint64_t dropped_blocks = 0;
+
+    allocator_set_overwrite_oldest(p_allocator, true);
+
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 1, &p_block));
+    }
+
+    // A 5 byte block needs the 5 oldest 1 byte blocks to be evicted
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 5, &p_block));
+    allocator_get_dropped(p_allocator, &dropped_blocks, NULL);
+    TEST_ASSERT_EQUAL(5, dropped_blocks);
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_peek(p_allocator, &p_block, &block_size));
+    TEST_ASSERT_EQUAL(1, block_size);
+
+    // Sizes are still validated
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_UNSUPPORTED_SIZE, allocator_alloc(p_allocator, 6, &p_block));
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_cursors_read_every_block(void) {
+    allocator_t* p_allocator = allocator_init(100, 1, 10);
+    size_t cursor_ids[3];
+    uint8_t* p_block = NULL;
+    size_t block_size = 0;
+
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_cursor_register(p_allocator, &cursor_ids[i]));
+    }
+
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, i + 1, &p_block));
+        p_block[0] = i;
+    }
+
+    // Every cursor sees the same blocks in the same order, regardless of the others
+    for (int c = 2; c >= 0; c--) {
+        for (int i = 0; i < 5; i++) {
+            TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_cursor_peek(p_allocator, cursor_ids[c], &p_block, &block_size));
+            TEST_ASSERT_EQUAL(i + 1, block_size);
+            TEST_ASSERT_EQUAL(i, p_block[0]);
+            TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_cursor_advance(p_allocator, cursor_ids[c]));
+        }
+        TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_cursor_peek(p_allocator, cursor_ids[c], &p_block, &block_size));
+        TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_cursor_advance(p_allocator, cursor_ids[c]));
+    }
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_cursors_reclaim_after_slowest(void) {
+    allocator_t* p_allocator = allocator_init(20, 10, 10);
+    size_t fast_cursor;
+    size_t slow_cursor;
+    uint8_t* p_block = NULL;
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_cursor_register(p_allocator, &fast_cursor));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_cursor_register(p_allocator, &slow_cursor));
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 10, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 10, &p_block));
+
+    // The fast cursor read everything, but the slow one is still holding both blocks
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_cursor_advance(p_allocator, fast_cursor));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_cursor_advance(p_allocator, fast_cursor));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_OUT_OF_MEMORY, allocator_alloc(p_allocator, 10, &p_block));
+
+    // Once the slow cursor moves past the oldest block its space can be reused
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_cursor_advance(p_allocator, slow_cursor));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 10, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_OUT_OF_MEMORY, allocator_alloc(p_allocator, 10, &p_block));
+
+    // Unregistering the slow cursor stops it from holding back reclamation
+    allocator_cursor_unregister(p_allocator, slow_cursor);
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 10, &p_block));
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_cursor_register_error_when_all_in_use(void) {
+    allocator_t* p_allocator = allocator_init(100, 5, 10);
+    size_t cursor_id;
+
+    for (int i = 0; i < ALLOCATOR_MAX_CURSORS; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_cursor_register(p_allocator, &cursor_id));
+    }
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_OUT_OF_MEMORY, allocator_cursor_register(p_allocator, &cursor_id));
+
+    // Unregistered slots are reused
+    allocator_cursor_unregister(p_allocator, 3);
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_cursor_register(p_allocator, &cursor_id));
+    TEST_ASSERT_EQUAL(3, cursor_id);
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_cursor_error_on_invalid_id(void) {
+    allocator_t* p_allocator = allocator_init(100, 5, 10);
+    size_t cursor_id;
+    uint8_t* p_block = NULL;
+    size_t block_size = 0;
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_cursor_register(p_allocator, &cursor_id));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 5, &p_block));
+
+    // Ids out of range and ids of unregistered cursors don't touch any cursor
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_cursor_peek(p_allocator, ALLOCATOR_MAX_CURSORS, &p_block, &block_size));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_cursor_advance(p_allocator, ALLOCATOR_MAX_CURSORS));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_cursor_peek(p_allocator, cursor_id + 1, &p_block, &block_size));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_cursor_advance(p_allocator, cursor_id + 1));
+    allocator_cursor_unregister(p_allocator, ALLOCATOR_MAX_CURSORS);
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_cursor_peek(p_allocator, cursor_id, &p_block, &block_size));
+
+    // A stale id is rejected once its cursor is unregistered
+    allocator_cursor_unregister(p_allocator, cursor_id);
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_cursor_peek(p_allocator, cursor_id, &p_block, &block_size));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_cursor_advance(p_allocator, cursor_id));
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_quota_ceiling_exceeded(void) {
+    allocator_t* p_allocator = allocator_init(100, 5, 10);
+    uint8_t* p_block = NULL;
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_enable_quotas(p_allocator, 2));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_set_quota(p_allocator, 1, 0, 20));
+
+    // Tenant 1 can't hold more than 20 bytes, tenant 0 is unaffected
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc_tenant(p_allocator, 1, 10, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc_tenant(p_allocator, 1, 10, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_QUOTA_EXCEEDED, allocator_alloc_tenant(p_allocator, 1, 5, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 10, &p_block));
+
+    // Freeing the oldest block gives its bytes back to tenant 1
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_free(p_allocator));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc_tenant(p_allocator, 1, 10, &p_block));
+
+    // Unknown tenants are rejected
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_alloc_tenant(p_allocator, 2, 10, &p_block));
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_quota_reservation_protected_from_other_tenants(void) {
+    allocator_t* p_allocator = allocator_init(100, 10, 10);
+    uint8_t* p_block = NULL;
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_enable_quotas(p_allocator, 2));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_set_quota(p_allocator, 1, 30, SIZE_MAX));
+
+    // A noisy tenant 0 can only fill the buffer up to the reservation of tenant 1
+    for (int i = 0; i < 7; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 10, &p_block));
+    }
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_OUT_OF_MEMORY, allocator_alloc(p_allocator, 10, &p_block));
+
+    // Tenant 1 still gets all of its reserved bytes
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc_tenant(p_allocator, 1, 10, &p_block));
+    }
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_OUT_OF_MEMORY, allocator_alloc_tenant(p_allocator, 1, 10, &p_block));
+
+    // Once the buffer drains, the reservation is protected again
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_free(p_allocator));
+    }
+    TEST_ASSERT_EQUAL(30, p_allocator->reserved_unused);
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_quota_reservation_under_concurrent_frees(void) {
+    allocator_t* p_allocator = allocator_init(100, 10, 10);
+    quota_race_t race = { p_allocator, 200000, 0 };
+    uint8_t level = log_get_level(LOG_GROUP_ID_ALLOCATOR);
+    uint8_t* p_block = NULL;
+    uint64_t failures = 0;
+    pthread_t consumer;
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_enable_quotas(p_allocator, 2));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_set_quota(p_allocator, 1, 50, SIZE_MAX));
+    log_set_levels("allocator=error");
+    pthread_create(&consumer, NULL, free_blocks, &race);
+
+    // With at most 3 blocks in flight tenant 1 stays within its reservation, so every allocation
+    // has to succeed while the consumer frees the blocks of the same tenant
+    for (uint64_t i = 0; i < race.blocks; i++) {
+        while (i - __atomic_load_n(&race.freed, __ATOMIC_ACQUIRE) >= 3) {
+            sched_yield();
+        }
+        while (allocator_alloc_tenant(p_allocator, 1, 10, &p_block) != ALLOCATOR_SUCCESS) {
+            failures++;
+        }
+    }
+
+    pthread_join(consumer, NULL);
+    log_set_level(LOG_GROUP_ID_ALLOCATOR, level);
+    TEST_ASSERT_EQUAL_UINT64(0, failures);
+    TEST_ASSERT_EQUAL(50, p_allocator->reserved_unused);
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_quota_reservation_while_free_is_half_done(void) {
+    allocator_t* p_allocator = allocator_init(100, 10, 10);
+    uint8_t* p_block = NULL;
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_enable_quotas(p_allocator, 2));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_set_quota(p_allocator, 1, 50, SIZE_MAX));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc_tenant(p_allocator, 1, 10, &p_block));
+
+    // A consumer freeing the block lowers the bytes used by the tenant before it gives the reservation
+    // back, a producer of the same tenant running in between must still get its reserved bytes
+    p_allocator->p_quotas[1].used -= 10;
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc_tenant(p_allocator, 1, 10, &p_block));
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_quota_error_on_unknown_tenant(void) {
+    allocator_t* p_allocator = allocator_init(100, 5, 10);
+
+    // Quotas have to be enabled first
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_set_quota(p_allocator, 0, 0, 20));
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_enable_quotas(p_allocator, 2));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_set_quota(p_allocator, 1, 0, 20));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_set_quota(p_allocator, 2, 0, 20));
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_utilization_follows_allocs_and_frees(void) {
+    allocator_t* p_allocator = allocator_init(100, 5, 10);
+    uint8_t* p_block = NULL;
+
+    TEST_ASSERT_EQUAL(0, allocator_get_utilization(p_allocator));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 7, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 9, &p_block));
+    TEST_ASSERT_EQUAL(16, allocator_get_utilization(p_allocator));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_free(p_allocator));
+    TEST_ASSERT_EQUAL(9, allocator_get_utilization(p_allocator));
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_watermarks_fire_once_per_crossing(void) {
+    allocator_t* p_allocator = allocator_init(100, 10, 10);
+    uint8_t* p_block = NULL;
+    int crossings[2] = { 0, 0 };
+
+    allocator_set_watermarks(p_allocator, 80, 30, count_watermark_crossings, crossings);
+
+    for (int cycles = 0; cycles < 3; cycles++) {
+        // Filling up to 70 bytes stays below the high watermark
+        for (int i = 0; i < 7; i++) {
+            TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 10, &p_block));
+        }
+        TEST_ASSERT_FALSE(allocator_is_above_high_watermark(p_allocator));
+
+        // Going to 100 bytes crosses it only once
+        for (int i = 0; i < 3; i++) {
+            TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 10, &p_block));
+        }
+        TEST_ASSERT_TRUE(allocator_is_above_high_watermark(p_allocator));
+        TEST_ASSERT_EQUAL(cycles + 1, crossings[ALLOCATOR_WATERMARK_HIGH]);
+
+        // Dropping to 40 bytes is not enough to resume
+        for (int i = 0; i < 6; i++) {
+            TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_free(p_allocator));
+        }
+        TEST_ASSERT_TRUE(allocator_is_above_high_watermark(p_allocator));
+        TEST_ASSERT_EQUAL(cycles, crossings[ALLOCATOR_WATERMARK_LOW]);
+
+        // Dropping to 30 bytes is
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_free(p_allocator));
+        TEST_ASSERT_FALSE(allocator_is_above_high_watermark(p_allocator));
+        TEST_ASSERT_EQUAL(cycles + 1, crossings[ALLOCATOR_WATERMARK_LOW]);
+
+        while (allocator_free(p_allocator) == ALLOCATOR_SUCCESS) {
+        }
+    }
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_stats_disabled_by_default(void) {
+    allocator_t* p_allocator = allocator_init(100, 5, 10);
+    allocator_stats_t stats;
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_get_stats(p_allocator, &stats));
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_stats_count_operations(void) {
+    allocator_t* p_allocator = allocator_init(20, 2, 10);
+    uint8_t* p_block = NULL;
+    allocator_stats_t stats;
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_enable_stats(p_allocator));
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 2, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 3, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 8, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 7, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_OUT_OF_MEMORY, allocator_alloc(p_allocator, 2, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_UNSUPPORTED_SIZE, allocator_alloc(p_allocator, 1, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_UNSUPPORTED_SIZE, allocator_alloc(p_allocator, 11, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_free(p_allocator));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_free(p_allocator));
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_get_stats(p_allocator, &stats));
+    TEST_ASSERT_EQUAL(4, stats.allocs);
+    TEST_ASSERT_EQUAL(2, stats.frees);
+    TEST_ASSERT_EQUAL(20, stats.bytes_in);
+    TEST_ASSERT_EQUAL(5, stats.bytes_out);
+    TEST_ASSERT_EQUAL(20, stats.data_peak_utilization);
+    TEST_ASSERT_EQUAL(4, stats.size_peak_utilization);
+    TEST_ASSERT_EQUAL(1, stats.out_of_memory);
+    TEST_ASSERT_EQUAL(2, stats.unsupported_size);
+
+    // Sizes 2 and 3 go in [2, 4), 7 in [4, 8) and 8 in [8, 16)
+    TEST_ASSERT_EQUAL(0, stats.block_size_histogram[0]);
+    TEST_ASSERT_EQUAL(2, stats.block_size_histogram[1]);
+    TEST_ASSERT_EQUAL(1, stats.block_size_histogram[2]);
+    TEST_ASSERT_EQUAL(1, stats.block_size_histogram[3]);
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_alloc_aligned_blocks_are_aligned(void) {
+    allocator_t* p_allocator = allocator_init(10000, 1, 64);
+    size_t alignments[] = { 1, 2, 16, 64, 4096 };
+    uint8_t* p_allocated_block = NULL;
+    uint8_t* p_peeked_block = NULL;
+    size_t block_size = 0;
+
+    for (size_t i = 0; i < sizeof(alignments) / sizeof(alignments[0]); i++) {
+        // Misalign the head first so the block needs padding
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 3, &p_allocated_block));
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc_aligned(p_allocator, 64, alignments[i], &p_allocated_block));
+        TEST_ASSERT_EQUAL(0, (uintptr_t)p_allocated_block % alignments[i]);
+
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_free(p_allocator));
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_peek(p_allocator, &p_peeked_block, &block_size));
+        TEST_ASSERT_EQUAL_PTR(p_allocated_block, p_peeked_block);
+        TEST_ASSERT_EQUAL(64, block_size);
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_free(p_allocator));
+    }
+
+    // The padding is given back along with the blocks
+    TEST_ASSERT_EQUAL(0, allocator_get_utilization(p_allocator));
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_alloc_aligned_error_on_unsupported_alignment(void) {
+    allocator_t* p_allocator = allocator_init(100, 1, 10);
+    uint8_t* p_block = NULL;
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_UNSUPPORTED_SIZE, allocator_alloc_aligned(p_allocator, 10, 0, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_UNSUPPORTED_SIZE, allocator_alloc_aligned(p_allocator, 10, 24, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_UNSUPPORTED_SIZE, allocator_alloc_aligned(p_allocator, 10, ALLOCATOR_MAX_ALIGNMENT * 2, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_UNSUPPORTED_SIZE, allocator_alloc_aligned(p_allocator, 11, 8, &p_block));
+    TEST_ASSERT_EQUAL(0, allocator_get_utilization(p_allocator));
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_alloc_aligned_mixed_with_unaligned(void) {
+    allocator_t* p_allocator = allocator_init(500, 1, 50);
+    uint8_t* p_block = NULL;
+    size_t block_size = 0;
+    int allocated = 0;
+    int freed = 0;
+
+    // Keep a few blocks of every kind in flight while the buffer wraps around many times
+    while (freed < 1000) {
+        size_t size = 1 + (allocated * 7) % 50;
+        allocator_error_t result = ((allocated % 3) == 0) ? allocator_alloc(p_allocator, size, &p_block) :
+                                                            allocator_alloc_aligned(p_allocator, size, 32, &p_block);
+        if (result == ALLOCATOR_SUCCESS) {
+            TEST_ASSERT_TRUE(((allocated % 3) == 0) || ((uintptr_t)p_block % 32 == 0));
+            memset(p_block, allocated, size);
+            allocated++;
+            continue;
+        }
+
+        TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_OUT_OF_MEMORY, result);
+        while (allocator_peek(p_allocator, &p_block, &block_size) == ALLOCATOR_SUCCESS) {
+            TEST_ASSERT_EQUAL(1 + (freed * 7) % 50, block_size);
+            TEST_ASSERT_EACH_EQUAL_UINT8((uint8_t)freed, p_block, block_size);
+            TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_free(p_allocator));
+            freed++;
+        }
+    }
+
+    TEST_ASSERT_EQUAL(0, allocator_get_utilization(p_allocator));
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_cursors_read_aligned_blocks(void) {
+    allocator_t* p_allocator = allocator_init(200, 1, 20);
+    size_t cursor_id;
+    uint8_t* p_allocated_blocks[5];
+    uint8_t* p_block = NULL;
+    size_t block_size = 0;
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_cursor_register(p_allocator, &cursor_id));
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc_aligned(p_allocator, 5 + i, 16, &p_allocated_blocks[i]));
+    }
+
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_cursor_peek(p_allocator, cursor_id, &p_block, &block_size));
+        TEST_ASSERT_EQUAL_PTR(p_allocated_blocks[i], p_block);
+        TEST_ASSERT_EQUAL(5 + i, block_size);
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_cursor_advance(p_allocator, cursor_id));
+    }
+
+    allocator_uninit(p_allocator);
+}
@@ -3,6 +3,13 @@
 /*=======Automagically Detected Files To Include=====*/
 #include "unity.h"
 #include "allocator.h"
+#include "logging_groups.h"
+#include "logging_levels.h"
+#include "pthread.h"
+#include "sched.h"
+#include "string.h"
+#include "time.h"
+#include "unistd.h"
 
 /*=======External Functions This Runner Calls=====*/
 extern void setUp(void);
@@ -16,9 +23,36 @@ extern void test_allocator_alloc_full_buffer_one_by_one(void);
 extern void test_allocator_many_allocs(void);
 extern void test_allocator_many_allocs_and_frees(void);
 extern void test_allocator_allocs_and_frees_different_sizes(void);
+extern void test_allocator_alloc_wraps_around_contiguously(void);
 extern void test_allocator_peek_error_on_empty_buffer(void);
 extern void test_allocator_peek_last_alloc(void);
 extern void test_allocator_check_peeked_data(void);
+extern void test_allocator_peek_wait_times_out_on_empty_buffer(void);
+extern void test_allocator_alloc_wait_times_out_on_full_buffer(void);
+extern void test_allocator_peek_wait_wakes_up_on_alloc(void);
+extern void test_allocator_alloc_wait_wakes_up_on_free(void);
+extern void test_allocator_event_fds_disabled_by_default(void);
+extern void test_allocator_data_event_fd_signalled_when_not_empty(void);
+extern void test_allocator_space_event_fd_signalled_below_watermark(void);
+extern void test_allocator_overwrite_oldest_never_runs_out_of_memory(void);
+extern void test_allocator_overwrite_oldest_evicts_enough_for_bigger_blocks(void);
+extern void test_allocator_cursors_read_every_block(void);
+extern void test_allocator_cursors_reclaim_after_slowest(void);
+extern void test_allocator_cursor_register_error_when_all_in_use(void);
+extern void test_allocator_cursor_error_on_invalid_id(void);
+extern void test_allocator_quota_ceiling_exceeded(void);
+extern void test_allocator_quota_reservation_protected_from_other_tenants(void);
+extern void test_allocator_quota_reservation_under_concurrent_frees(void);
+extern void test_allocator_quota_reservation_while_free_is_half_done(void);
+extern void test_allocator_quota_error_on_unknown_tenant(void);
+extern void test_allocator_utilization_follows_allocs_and_frees(void);
+extern void test_allocator_watermarks_fire_once_per_crossing(void);
+extern void test_allocator_stats_disabled_by_default(void);
+extern void test_allocator_stats_count_operations(void);
+extern void test_allocator_alloc_aligned_blocks_are_aligned(void);
+extern void test_allocator_alloc_aligned_error_on_unsupported_alignment(void);
+extern void test_allocator_alloc_aligned_mixed_with_unaligned(void);
+extern void test_allocator_cursors_read_aligned_blocks(void);
 
 
 /*=======Mock Management=====*/
@@ -80,18 +114,45 @@ static void run_test(UnityTestFunction func, const char* name, UNITY_LINE_TYPE l
 int main(void)
 {
   UnityBegin("tests/test_allocator.c");
-  run_test(test_allocator_initialization_not_null, "test_allocator_initialization_not_null", 13);
-  run_test(test_allocator_alloc_success, "test_allocator_alloc_success", 20);
-  run_test(test_allocator_alloc_error_below_min_block_size, "test_allocator_alloc_error_below_min_block_size", 29);
-  run_test(test_allocator_alloc_error_above_max_block_size, "test_allocator_alloc_error_above_max_block_size", 38);
-  run_test(test_allocator_free_error_on_empty_buffer, "test_allocator_free_error_on_empty_buffer", 47);
-  run_test(test_allocator_alloc_full_buffer_one_by_one, "test_allocator_alloc_full_buffer_one_by_one", 53);
-  run_test(test_allocator_many_allocs, "test_allocator_many_allocs", 86);
-  run_test(test_allocator_many_allocs_and_frees, "test_allocator_many_allocs_and_frees", 105);
-  run_test(test_allocator_allocs_and_frees_different_sizes, "test_allocator_allocs_and_frees_different_sizes", 140);
-  run_test(test_allocator_peek_error_on_empty_buffer, "test_allocator_peek_error_on_empty_buffer", 163);
-  run_test(test_allocator_peek_last_alloc, "test_allocator_peek_last_alloc", 175);
-  run_test(test_allocator_check_peeked_data, "test_allocator_check_peeked_data", 192);
+  run_test(test_allocator_initialization_not_null, "test_allocator_initialization_not_null", 74);
+  run_test(test_allocator_alloc_success, "test_allocator_alloc_success", 81);
+  run_test(test_allocator_alloc_error_below_min_block_size, "test_allocator_alloc_error_below_min_block_size", 90);
+  run_test(test_allocator_alloc_error_above_max_block_size, "test_allocator_alloc_error_above_max_block_size", 99);
+  run_test(test_allocator_free_error_on_empty_buffer, "test_allocator_free_error_on_empty_buffer", 108);
+  run_test(test_allocator_alloc_full_buffer_one_by_one, "test_allocator_alloc_full_buffer_one_by_one", 114);
+  run_test(test_allocator_many_allocs, "test_allocator_many_allocs", 147);
+  run_test(test_allocator_many_allocs_and_frees, "test_allocator_many_allocs_and_frees", 166);
+  run_test(test_allocator_allocs_and_frees_different_sizes, "test_allocator_allocs_and_frees_different_sizes", 201);
+  run_test(test_allocator_alloc_wraps_around_contiguously, "test_allocator_alloc_wraps_around_contiguously", 224);
+  run_test(test_allocator_peek_error_on_empty_buffer, "test_allocator_peek_error_on_empty_buffer", 246);
+  run_test(test_allocator_peek_last_alloc, "test_allocator_peek_last_alloc", 258);
+  run_test(test_allocator_check_peeked_data, "test_allocator_check_peeked_data", 275);
+  run_test(test_allocator_peek_wait_times_out_on_empty_buffer, "test_allocator_peek_wait_times_out_on_empty_buffer", 331);
+  run_test(test_allocator_alloc_wait_times_out_on_full_buffer, "test_allocator_alloc_wait_times_out_on_full_buffer", 348);
+  run_test(test_allocator_peek_wait_wakes_up_on_alloc, "test_allocator_peek_wait_wakes_up_on_alloc", 367);
+  run_test(test_allocator_alloc_wait_wakes_up_on_free, "test_allocator_alloc_wait_wakes_up_on_free", 389);
+  run_test(test_allocator_event_fds_disabled_by_default, "test_allocator_event_fds_disabled_by_default", 410);
+  run_test(test_allocator_data_event_fd_signalled_when_not_empty, "test_allocator_data_event_fd_signalled_when_not_empty", 417);
+  run_test(test_allocator_space_event_fd_signalled_below_watermark, "test_allocator_space_event_fd_signalled_below_watermark", 443);
+  run_test(test_allocator_overwrite_oldest_never_runs_out_of_memory, "test_allocator_overwrite_oldest_never_runs_out_of_memory", 471);
+  run_test(test_allocator_overwrite_oldest_evicts_enough_for_bigger_blocks, "test_allocator_overwrite_oldest_evicts_enough_for_bigger_blocks", 502);
+  run_test(test_allocator_cursors_read_every_block, "test_allocator_cursors_read_every_block", 528);
+  run_test(test_allocator_cursors_reclaim_after_slowest, "test_allocator_cursors_reclaim_after_slowest", 558);
+  run_test(test_allocator_cursor_register_error_when_all_in_use, "test_allocator_cursor_register_error_when_all_in_use", 587);
+  run_test(test_allocator_cursor_error_on_invalid_id, "test_allocator_cursor_error_on_invalid_id", 604);
+  run_test(test_allocator_quota_ceiling_exceeded, "test_allocator_quota_ceiling_exceeded", 629);
+  run_test(test_allocator_quota_reservation_protected_from_other_tenants, "test_allocator_quota_reservation_protected_from_other_tenants", 652);
+  run_test(test_allocator_quota_reservation_under_concurrent_frees, "test_allocator_quota_reservation_under_concurrent_frees", 680);
+  run_test(test_allocator_quota_reservation_while_free_is_half_done, "test_allocator_quota_reservation_while_free_is_half_done", 712);
+  run_test(test_allocator_quota_error_on_unknown_tenant, "test_allocator_quota_error_on_unknown_tenant", 728);
+  run_test(test_allocator_utilization_follows_allocs_and_frees, "test_allocator_utilization_follows_allocs_and_frees", 741);
+  run_test(test_allocator_watermarks_fire_once_per_crossing, "test_allocator_watermarks_fire_once_per_crossing", 755);
+  run_test(test_allocator_stats_disabled_by_default, "test_allocator_stats_disabled_by_default", 795);
+  run_test(test_allocator_stats_count_operations, "test_allocator_stats_count_operations", 804);
+  run_test(test_allocator_alloc_aligned_blocks_are_aligned, "test_allocator_alloc_aligned_blocks_are_aligned", 840);
+  run_test(test_allocator_alloc_aligned_error_on_unsupported_alignment, "test_allocator_alloc_aligned_error_on_unsupported_alignment", 865);
+  run_test(test_allocator_alloc_aligned_mixed_with_unaligned, "test_allocator_alloc_aligned_mixed_with_unaligned", 878);
+  run_test(test_allocator_cursors_read_aligned_blocks, "test_allocator_cursors_read_aligned_blocks", 910);
 
   return UnityEnd();
 }
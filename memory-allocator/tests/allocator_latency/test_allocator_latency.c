@@ -0,0 +1,106 @@
+#include "allocator.h"
+#include "allocator_latency.h"
+#include "unity.h"
+
+void setUp(void) {
+    // Nothing to set up
+}
+
+void tearDown(void) {
+    // Nothing to clean up
+}
+
+void test_allocator_latency_empty_histogram(void) {
+    allocator_latency_histogram_t histogram;
+    allocator_latency_histogram_reset(&histogram);
+
+    TEST_ASSERT_EQUAL_UINT64(0, histogram.total);
+    TEST_ASSERT_EQUAL_UINT64(0, histogram.max);
+    TEST_ASSERT_EQUAL_UINT64(0, allocator_latency_histogram_percentile(&histogram, 50.0));
+}
+
+void test_allocator_latency_small_values_are_exact(void) {
+    allocator_latency_histogram_t histogram;
+    allocator_latency_histogram_reset(&histogram);
+
+    for (uint64_t i = 1; i <= 4; i++) {
+        allocator_latency_histogram_record(&histogram, i);
+    }
+
+    TEST_ASSERT_EQUAL_UINT64(4, histogram.total);
+    TEST_ASSERT_EQUAL_UINT64(4, histogram.max);
+    TEST_ASSERT_EQUAL_UINT64(1, allocator_latency_histogram_percentile(&histogram, 25.0));
+    TEST_ASSERT_EQUAL_UINT64(2, allocator_latency_histogram_percentile(&histogram, 50.0));
+    TEST_ASSERT_EQUAL_UINT64(4, allocator_latency_histogram_percentile(&histogram, 100.0));
+}
+
+void test_allocator_latency_large_values_within_bucket_error(void) {
+    allocator_latency_histogram_t histogram;
+    allocator_latency_histogram_reset(&histogram);
+
+    for (uint64_t i = 1; i <= 1000; i++) {
+        allocator_latency_histogram_record(&histogram, i * 1000);
+    }
+
+    // Each bucket spans at most 1/8 of its values
+    uint64_t p50 = allocator_latency_histogram_percentile(&histogram, 50.0);
+    TEST_ASSERT(p50 >= 500000);
+    TEST_ASSERT(p50 <= 500000 + 500000 / 8);
+
+    uint64_t p99 = allocator_latency_histogram_percentile(&histogram, 99.0);
+    TEST_ASSERT(p99 >= 990000);
+    TEST_ASSERT(p99 <= 1000000);
+
+    TEST_ASSERT_EQUAL_UINT64(1000000, allocator_latency_histogram_percentile(&histogram, 100.0));
+}
+
+void test_allocator_latency_largest_value(void) {
+    allocator_latency_histogram_t histogram;
+    allocator_latency_histogram_reset(&histogram);
+
+    allocator_latency_histogram_record(&histogram, UINT64_MAX);
+
+    TEST_ASSERT_EQUAL_UINT64(1, histogram.counts[ALLOCATOR_LATENCY_BUCKETS - 1]);
+    TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, allocator_latency_histogram_percentile(&histogram, 99.9));
+}
+
+void test_allocator_latency_reset_clears_values(void) {
+    allocator_latency_histogram_t histogram;
+    allocator_latency_histogram_reset(&histogram);
+
+    allocator_latency_histogram_record(&histogram, 123);
+    allocator_latency_histogram_reset(&histogram);
+
+    TEST_ASSERT_EQUAL_UINT64(0, histogram.total);
+    TEST_ASSERT_EQUAL_UINT64(0, histogram.max);
+}
+
+void test_allocator_latency_recorded_per_operation(void) {
+    allocator_t* p_allocator = allocator_init(100, 5, 10);
+    allocator_latency_histogram_t histogram;
+    uint8_t* p_block = NULL;
+    size_t block_size = 0;
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 5, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 5, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_peek(p_allocator, &p_block, &block_size));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_free(p_allocator));
+
+#if defined(ALLOCATOR_LATENCY)
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_get_latency(p_allocator, ALLOCATOR_OP_ALLOC, &histogram));
+    TEST_ASSERT_EQUAL_UINT64(2, histogram.total);
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_get_latency(p_allocator, ALLOCATOR_OP_PEEK, &histogram));
+    TEST_ASSERT_EQUAL_UINT64(1, histogram.total);
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_get_latency(p_allocator, ALLOCATOR_OP_FREE, &histogram));
+    TEST_ASSERT_EQUAL_UINT64(1, histogram.total);
+
+    allocator_reset_latency(p_allocator);
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_get_latency(p_allocator, ALLOCATOR_OP_ALLOC, &histogram));
+    TEST_ASSERT_EQUAL_UINT64(0, histogram.total);
+#else
+    TEST_ASSERT(p_allocator->p_latency == NULL);
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_get_latency(p_allocator, ALLOCATOR_OP_ALLOC, &histogram));
+#endif
+
+    allocator_uninit(p_allocator);
+}
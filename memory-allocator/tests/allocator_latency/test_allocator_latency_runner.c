@@ -0,0 +1,86 @@
+/* AUTOGENERATED FILE. DO NOT EDIT. */
+
+/*=======Automagically Detected Files To Include=====*/
+#include "unity.h"
+#include "allocator.h"
+#include "allocator_latency.h"
+
+/*=======External Functions This Runner Calls=====*/
+extern void setUp(void);
+extern void tearDown(void);
+extern void test_allocator_latency_empty_histogram(void);
+extern void test_allocator_latency_small_values_are_exact(void);
+extern void test_allocator_latency_large_values_within_bucket_error(void);
+extern void test_allocator_latency_largest_value(void);
+extern void test_allocator_latency_reset_clears_values(void);
+extern void test_allocator_latency_recorded_per_operation(void);
+
+
+/*=======Mock Management=====*/
+static void CMock_Init(void)
+{
+}
+static void CMock_Verify(void)
+{
+}
+static void CMock_Destroy(void)
+{
+}
+
+/*=======Test Reset Options=====*/
+void resetTest(void);
+void resetTest(void)
+{
+  tearDown();
+  CMock_Verify();
+  CMock_Destroy();
+  CMock_Init();
+  setUp();
+}
+void verifyTest(void);
+void verifyTest(void)
+{
+  CMock_Verify();
+}
+
+/*=======Test Runner Used To Run Each Test=====*/
+static void run_test(UnityTestFunction func, const char* name, UNITY_LINE_TYPE line_num)
+{
+    Unity.CurrentTestName = name;
+    Unity.CurrentTestLineNumber = line_num;
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+    if (!UnityTestMatches())
+        return;
+#endif
+    Unity.NumberOfTests++;
+    UNITY_CLR_DETAILS();
+    UNITY_EXEC_TIME_START();
+    CMock_Init();
+    if (TEST_PROTECT())
+    {
+        setUp();
+        func();
+    }
+    if (TEST_PROTECT())
+    {
+        tearDown();
+        CMock_Verify();
+    }
+    CMock_Destroy();
+    UNITY_EXEC_TIME_STOP();
+    UnityConcludeTest();
+}
+
+/*=======MAIN=====*/
+int main(void)
+{
+  UnityBegin("tests/test_allocator_latency.c");
+  run_test(test_allocator_latency_empty_histogram, "test_allocator_latency_empty_histogram", 13);
+  run_test(test_allocator_latency_small_values_are_exact, "test_allocator_latency_small_values_are_exact", 22);
+  run_test(test_allocator_latency_large_values_within_bucket_error, "test_allocator_latency_large_values_within_bucket_error", 37);
+  run_test(test_allocator_latency_largest_value, "test_allocator_latency_largest_value", 57);
+  run_test(test_allocator_latency_reset_clears_values, "test_allocator_latency_reset_clears_values", 67);
+  run_test(test_allocator_latency_recorded_per_operation, "test_allocator_latency_recorded_per_operation", 78);
+
+  return UnityEnd();
+}
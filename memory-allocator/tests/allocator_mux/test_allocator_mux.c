@@ -0,0 +1,187 @@
+
+#include "allocator_mux.h"
+#include "unity.h"
+
+void setUp(void) {
+    // Nothing to set up
+}
+
+void tearDown(void) {
+    // Nothing to clean up
+}
+
+void test_allocator_mux_initialization_not_null(void) {
+    allocator_mux_t* p_mux = allocator_mux_init(100, 5, 10, 200);
+    TEST_ASSERT(p_mux != NULL);
+    TEST_ASSERT(p_mux->p_allocator != NULL);
+    TEST_ASSERT(p_mux->p_streams != NULL);
+    allocator_mux_uninit(p_mux);
+}
+
+void test_allocator_mux_error_on_unknown_stream(void) {
+    allocator_mux_t* p_mux = allocator_mux_init(100, 5, 10, 4);
+    uint8_t* p_block = NULL;
+    size_t block_size = 0;
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_mux_alloc(p_mux, 4, 5, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_mux_peek(p_mux, 4, &p_block, &block_size));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_mux_free(p_mux, 4));
+
+    allocator_mux_uninit(p_mux);
+}
+
+void test_allocator_mux_streams_are_independent_fifos(void) {
+    allocator_mux_t* p_mux = allocator_mux_init(100, 1, 10, 3);
+    uint8_t* p_block = NULL;
+    size_t block_size = 0;
+
+    // Interleave blocks of three streams, tagging each one with its stream and order
+    for (int i = 0; i < 4; i++) {
+        for (uint16_t stream = 0; stream < 3; stream++) {
+            TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_alloc(p_mux, stream, stream + 2, &p_block));
+            p_block[0] = stream;
+            p_block[1] = i;
+        }
+    }
+
+    // Drain the streams one after another, in reverse order
+    for (int stream = 2; stream >= 0; stream--) {
+        for (int i = 0; i < 4; i++) {
+            TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_peek(p_mux, stream, &p_block, &block_size));
+            TEST_ASSERT_EQUAL(stream + 2, block_size);
+            TEST_ASSERT_EQUAL(stream, p_block[0]);
+            TEST_ASSERT_EQUAL(i, p_block[1]);
+            TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_free(p_mux, stream));
+        }
+        TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_mux_peek(p_mux, stream, &p_block, &block_size));
+    }
+
+    allocator_mux_uninit(p_mux);
+}
+
+void test_allocator_mux_space_reclaimed_when_older_blocks_freed(void) {
+    allocator_mux_t* p_mux = allocator_mux_init(20, 10, 10, 2);
+    uint8_t* p_block = NULL;
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_alloc(p_mux, 0, 10, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_alloc(p_mux, 1, 10, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_OUT_OF_MEMORY, allocator_mux_alloc(p_mux, 1, 10, &p_block));
+
+    // Stream 1 freed its block, but it sits behind the block of stream 0
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_free(p_mux, 1));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_OUT_OF_MEMORY, allocator_mux_alloc(p_mux, 1, 10, &p_block));
+
+    // Freeing stream 0 releases both blocks
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_free(p_mux, 0));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_alloc(p_mux, 1, 10, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_alloc(p_mux, 0, 10, &p_block));
+
+    allocator_mux_uninit(p_mux);
+}
+
+void test_allocator_mux_peek_next_follows_lane_priority(void) {
+    allocator_mux_t* p_mux = allocator_mux_init(100, 1, 10, 4);
+    uint8_t* p_block = NULL;
+    size_t block_size = 0;
+    uint16_t stream_id = 0;
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_set_lane(p_mux, 2, 0));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_set_lane(p_mux, 0, 1));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_set_lane(p_mux, 1, 1));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_set_lane(p_mux, 3, 3));
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_mux_peek_next(p_mux, &stream_id, &p_block, &block_size));
+
+    // Low priority traffic first, then high priority traffic
+    uint16_t streams[] = { 3, 0, 1, 0, 2, 2 };
+    for (size_t i = 0; i < sizeof(streams) / sizeof(streams[0]); i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_alloc(p_mux, streams[i], 1, &p_block));
+        p_block[0] = i;
+    }
+
+    // Lane 0 comes out first, then lane 1 in arrival order, then lane 3
+    uint16_t expected_streams[] = { 2, 2, 0, 1, 0, 3 };
+    uint8_t expected_order[] = { 4, 5, 1, 2, 3, 0 };
+    for (size_t i = 0; i < sizeof(expected_streams) / sizeof(expected_streams[0]); i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_peek_next(p_mux, &stream_id, &p_block, &block_size));
+        TEST_ASSERT_EQUAL(expected_streams[i], stream_id);
+        TEST_ASSERT_EQUAL(expected_order[i], p_block[0]);
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_free(p_mux, stream_id));
+    }
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_mux_peek_next(p_mux, &stream_id, &p_block, &block_size));
+
+    allocator_mux_uninit(p_mux);
+}
+
+void test_allocator_mux_peek_next_skips_blocks_freed_by_stream(void) {
+    allocator_mux_t* p_mux = allocator_mux_init(100, 1, 10, 2);
+    uint8_t* p_block = NULL;
+    size_t block_size = 0;
+    uint16_t stream_id = 0;
+
+    // Both streams share lane 0
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_alloc(p_mux, 0, 1, &p_block));
+        p_block[0] = i;
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_alloc(p_mux, 1, 1, &p_block));
+        p_block[0] = 10 + i;
+    }
+
+    // Drain stream 1 directly, the lane then only holds the blocks of stream 0
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_free(p_mux, 1));
+    }
+
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_peek_next(p_mux, &stream_id, &p_block, &block_size));
+        TEST_ASSERT_EQUAL(0, stream_id);
+        TEST_ASSERT_EQUAL(i, p_block[0]);
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_free(p_mux, stream_id));
+    }
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_mux_peek_next(p_mux, &stream_id, &p_block, &block_size));
+
+    allocator_mux_uninit(p_mux);
+}
+
+
+void test_allocator_mux_set_lane_error_on_unknown_stream(void) {
+    allocator_mux_t* p_mux = allocator_mux_init(100, 1, 10, 4);
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_mux_set_lane(p_mux, 4, 0));
+
+    allocator_mux_uninit(p_mux);
+}
+
+void test_allocator_mux_set_lane_error_on_unknown_lane(void) {
+    allocator_mux_t* p_mux = allocator_mux_init(100, 1, 10, 4);
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_UNSUPPORTED_SIZE, allocator_mux_set_lane(p_mux, 0, ALLOCATOR_MUX_LANES));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_set_lane(p_mux, 0, ALLOCATOR_MUX_LANES - 1));
+
+    allocator_mux_uninit(p_mux);
+}
+
+void test_allocator_mux_set_lane_error_on_non_empty_stream(void) {
+    allocator_mux_t* p_mux = allocator_mux_init(100, 1, 10, 2);
+    uint8_t* p_block = NULL;
+    size_t block_size = 0;
+    uint16_t stream_id = 0;
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_set_lane(p_mux, 1, 1));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_alloc(p_mux, 1, 1, &p_block));
+    p_block[0] = 1;
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_alloc(p_mux, 0, 1, &p_block));
+    p_block[0] = 0;
+
+    // The stream stays in its lane, so its block still comes out after the one in lane 0
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_EMPTY, allocator_mux_set_lane(p_mux, 1, 0));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_peek_next(p_mux, &stream_id, &p_block, &block_size));
+    TEST_ASSERT_EQUAL(0, stream_id);
+    TEST_ASSERT_EQUAL(0, p_block[0]);
+
+    // Once the stream is drained it can move
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_free(p_mux, 1));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_mux_set_lane(p_mux, 1, 0));
+
+    allocator_mux_uninit(p_mux);
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+/* AUTOGENERATED FILE. DO NOT EDIT. */
+
+/*=======Automagically Detected Files To Include=====*/
+#include "unity.h"
+#include "allocator_mux.h"
+
+/*=======External Functions This Runner Calls=====*/
+extern void setUp(void);
+extern void tearDown(void);
+extern void test_allocator_mux_initialization_not_null(void);
+extern void test_allocator_mux_error_on_unknown_stream(void);
+extern void test_allocator_mux_streams_are_independent_fifos(void);
+extern void test_allocator_mux_space_reclaimed_when_older_blocks_freed(void);
+extern void test_allocator_mux_peek_next_follows_lane_priority(void);
+extern void test_allocator_mux_peek_next_skips_blocks_freed_by_stream(void);
+extern void test_allocator_mux_set_lane_error_on_unknown_stream(void);
+extern void test_allocator_mux_set_lane_error_on_unknown_lane(void);
+extern void test_allocator_mux_set_lane_error_on_non_empty_stream(void);
+
+
+/*=======Mock Management=====*/
+static void CMock_Init(void)
+{
+}
+static void CMock_Verify(void)
+{
+}
+static void CMock_Destroy(void)
+{
+}
+
+/*=======Test Reset Options=====*/
+void resetTest(void);
+void resetTest(void)
+{
+  tearDown();
+  CMock_Verify();
+  CMock_Destroy();
+  CMock_Init();
+  setUp();
+}
+void verifyTest(void);
+void verifyTest(void)
+{
+  CMock_Verify();
+}
+
+/*=======Test Runner Used To Run Each Test=====*/
+static void run_test(UnityTestFunction func, const char* name, UNITY_LINE_TYPE line_num)
+{
+    Unity.CurrentTestName = name;
+    Unity.CurrentTestLineNumber = line_num;
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+    if (!UnityTestMatches())
+        return;
+#endif
+    Unity.NumberOfTests++;
+    UNITY_CLR_DETAILS();
+    UNITY_EXEC_TIME_START();
+    CMock_Init();
+    if (TEST_PROTECT())
+    {
+        setUp();
+        func();
+    }
+    if (TEST_PROTECT())
+    {
+        tearDown();
+        CMock_Verify();
+    }
+    CMock_Destroy();
+    UNITY_EXEC_TIME_STOP();
+    UnityConcludeTest();
+}
+
+/*=======MAIN=====*/
+int main(void)
+{
+  UnityBegin("tests/test_allocator_mux.c");
+  run_test(test_allocator_mux_initialization_not_null, "test_allocator_mux_initialization_not_null", 13);
+  run_test(test_allocator_mux_error_on_unknown_stream, "test_allocator_mux_error_on_unknown_stream", 21);
+  run_test(test_allocator_mux_streams_are_independent_fifos, "test_allocator_mux_streams_are_independent_fifos", 33);
+  run_test(test_allocator_mux_space_reclaimed_when_older_blocks_freed, "test_allocator_mux_space_reclaimed_when_older_blocks_freed", 62);
+  run_test(test_allocator_mux_peek_next_follows_lane_priority, "test_allocator_mux_peek_next_follows_lane_priority", 82);
+  run_test(test_allocator_mux_peek_next_skips_blocks_freed_by_stream, "test_allocator_mux_peek_next_skips_blocks_freed_by_stream", 116);
+  run_test(test_allocator_mux_set_lane_error_on_unknown_stream, "test_allocator_mux_set_lane_error_on_unknown_stream", 147);
+  run_test(test_allocator_mux_set_lane_error_on_unknown_lane, "test_allocator_mux_set_lane_error_on_unknown_lane", 155);
+  run_test(test_allocator_mux_set_lane_error_on_non_empty_stream, "test_allocator_mux_set_lane_error_on_non_empty_stream", 164);
+
+  return UnityEnd();
+}
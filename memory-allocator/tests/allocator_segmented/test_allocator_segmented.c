@@ -0,0 +1,106 @@
+
+#include "allocator_segmented.h"
+#include "unity.h"
+
+void setUp(void) {
+    // Nothing to set up
+}
+
+void tearDown(void) {
+    // Nothing to clean up
+}
+
+void test_allocator_segmented_initialization_not_null(void) {
+    allocator_segmented_t* p_allocator = allocator_segmented_init(100, 5, 10, 2);
+    TEST_ASSERT(p_allocator != NULL);
+    TEST_ASSERT(p_allocator->p_head != NULL);
+    TEST_ASSERT(p_allocator->p_head == p_allocator->p_tail);
+    TEST_ASSERT_EQUAL(1, p_allocator->segment_count);
+    allocator_segmented_uninit(p_allocator);
+}
+
+void test_allocator_segmented_initialization_error_segment_too_small(void) {
+    allocator_segmented_t* p_allocator = allocator_segmented_init(8, 5, 10, 2);
+    TEST_ASSERT(p_allocator == NULL);
+}
+
+void test_allocator_segmented_alloc_error_unsupported_size(void) {
+    allocator_segmented_t* p_allocator = allocator_segmented_init(100, 5, 10, 2);
+    uint8_t* p_block = NULL;
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_UNSUPPORTED_SIZE, allocator_segmented_alloc(p_allocator, 2, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_UNSUPPORTED_SIZE, allocator_segmented_alloc(p_allocator, 20, &p_block));
+    TEST_ASSERT(p_block == NULL);
+    TEST_ASSERT_EQUAL(1, p_allocator->segment_count);
+
+    allocator_segmented_uninit(p_allocator);
+}
+
+void test_allocator_segmented_peek_and_free_error_on_empty(void) {
+    allocator_segmented_t* p_allocator = allocator_segmented_init(100, 5, 10, 2);
+    uint8_t* p_block = NULL;
+    size_t block_size = 0;
+
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_segmented_peek(p_allocator, &p_block, &block_size));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_segmented_free(p_allocator));
+
+    allocator_segmented_uninit(p_allocator);
+}
+
+void test_allocator_segmented_grows_beyond_one_segment(void) {
+    allocator_segmented_t* p_allocator = allocator_segmented_init(50, 5, 10, 2);
+    uint8_t* p_blocks[100];
+
+    // 100 blocks of 10 bytes need 20 segments of 50 bytes
+    for (int i = 0; i < 100; i++) {
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_segmented_alloc(p_allocator, 10, &p_blocks[i]));
+        for (int j = 0; j < 10; j++) {
+            p_blocks[i][j] = i;
+        }
+    }
+    TEST_ASSERT_EQUAL(20, p_allocator->segment_count);
+
+    // Blocks come out in the order they went in, at the address they were allocated at
+    for (int i = 0; i < 100; i++) {
+        uint8_t* p_block = NULL;
+        size_t block_size = 0;
+
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_segmented_peek(p_allocator, &p_block, &block_size));
+        TEST_ASSERT(p_block == p_blocks[i]);
+        TEST_ASSERT_EQUAL(10, block_size);
+        for (int j = 0; j < 10; j++) {
+            TEST_ASSERT_EQUAL(i, p_block[j]);
+        }
+        TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_segmented_free(p_allocator));
+    }
+
+    // Everything except the newest segment has been released, and the pool is capped
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_segmented_free(p_allocator));
+    TEST_ASSERT_EQUAL(1, p_allocator->segment_count);
+    TEST_ASSERT_EQUAL(2, p_allocator->pooled_count);
+
+    allocator_segmented_uninit(p_allocator);
+}
+
+void test_allocator_segmented_reuses_pooled_segments(void) {
+    allocator_segmented_t* p_allocator = allocator_segmented_init(10, 5, 10, 4);
+    uint8_t* p_block = NULL;
+
+    for (int cycles = 0; cycles < 10; cycles++) {
+        // Keep three segments busy and then drain them
+        for (int i = 0; i < 3; i++) {
+            TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_segmented_alloc(p_allocator, 10, &p_block));
+        }
+        TEST_ASSERT_EQUAL(3, p_allocator->segment_count);
+
+        for (int i = 0; i < 3; i++) {
+            TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_segmented_free(p_allocator));
+        }
+        TEST_ASSERT_EQUAL(1, p_allocator->segment_count);
+
+        // The chain plus the pool never holds more than the peak backlog
+        TEST_ASSERT_EQUAL(3, p_allocator->segment_count + p_allocator->pooled_count);
+    }
+
+    allocator_segmented_uninit(p_allocator);
+}
@@ -0,0 +1,85 @@
+/* AUTOGENERATED FILE. DO NOT EDIT. */
+
+/*=======Automagically Detected Files To Include=====*/
+#include "unity.h"
+#include "allocator_segmented.h"
+
+/*=======External Functions This Runner Calls=====*/
+extern void setUp(void);
+extern void tearDown(void);
+extern void test_allocator_segmented_initialization_not_null(void);
+extern void test_allocator_segmented_initialization_error_segment_too_small(void);
+extern void test_allocator_segmented_alloc_error_unsupported_size(void);
+extern void test_allocator_segmented_peek_and_free_error_on_empty(void);
+extern void test_allocator_segmented_grows_beyond_one_segment(void);
+extern void test_allocator_segmented_reuses_pooled_segments(void);
+
+
+/*=======Mock Management=====*/
+static void CMock_Init(void)
+{
+}
+static void CMock_Verify(void)
+{
+}
+static void CMock_Destroy(void)
+{
+}
+
+/*=======Test Reset Options=====*/
+void resetTest(void);
+void resetTest(void)
+{
+  tearDown();
+  CMock_Verify();
+  CMock_Destroy();
+  CMock_Init();
+  setUp();
+}
+void verifyTest(void);
+void verifyTest(void)
+{
+  CMock_Verify();
+}
+
+/*=======Test Runner Used To Run Each Test=====*/
+static void run_test(UnityTestFunction func, const char* name, UNITY_LINE_TYPE line_num)
+{
+    Unity.CurrentTestName = name;
+    Unity.CurrentTestLineNumber = line_num;
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+    if (!UnityTestMatches())
+        return;
+#endif
+    Unity.NumberOfTests++;
+    UNITY_CLR_DETAILS();
+    UNITY_EXEC_TIME_START();
+    CMock_Init();
+    if (TEST_PROTECT())
+    {
+        setUp();
+        func();
+    }
+    if (TEST_PROTECT())
+    {
+        tearDown();
+        CMock_Verify();
+    }
+    CMock_Destroy();
+    UNITY_EXEC_TIME_STOP();
+    UnityConcludeTest();
+}
+
+/*=======MAIN=====*/
+int main(void)
+{
+  UnityBegin("tests/test_allocator_segmented.c");
+  run_test(test_allocator_segmented_initialization_not_null, "test_allocator_segmented_initialization_not_null", 13);
+  run_test(test_allocator_segmented_initialization_error_segment_too_small, "test_allocator_segmented_initialization_error_segment_too_small", 22);
+  run_test(test_allocator_segmented_alloc_error_unsupported_size, "test_allocator_segmented_alloc_error_unsupported_size", 27);
+  run_test(test_allocator_segmented_peek_and_free_error_on_empty, "test_allocator_segmented_peek_and_free_error_on_empty", 39);
+  run_test(test_allocator_segmented_grows_beyond_one_segment, "test_allocator_segmented_grows_beyond_one_segment", 50);
+  run_test(test_allocator_segmented_reuses_pooled_segments, "test_allocator_segmented_reuses_pooled_segments", 85);
+
+  return UnityEnd();
+}
@@ -0,0 +1,172 @@
+#include "allocator.h"
+#include "allocator_trace.h"
+#include "stdio.h"
+#include "unity.h"
+
+#define TRACE_PATH "test_allocator_trace.bin"
+
+void setUp(void) {
+    // Nothing to set up
+}
+
+void tearDown(void) {
+    allocator_trace_stop();
+    remove(TRACE_PATH);
+}
+
+static void read_record(FILE* p_file, allocator_trace_op_t op, size_t size, allocator_error_t result) {
+    allocator_trace_record_t record;
+    allocator_trace_config_t config;
+
+    TEST_ASSERT_TRUE(allocator_trace_read(p_file, &record, &config));
+    TEST_ASSERT_EQUAL(op, record.op);
+    TEST_ASSERT_EQUAL(size, record.size);
+    TEST_ASSERT_EQUAL(result, record.result);
+}
+
+void test_allocator_trace_records_are_read_back(void) {
+    allocator_t* p_allocator = allocator_init(100, 5, 10);
+    allocator_trace_record_t record;
+    allocator_trace_config_t config;
+
+    TEST_ASSERT_TRUE(allocator_trace_start(TRACE_PATH));
+    allocator_trace_record(p_allocator, ALLOCATOR_TRACE_OP_ALLOC, 7, ALLOCATOR_SUCCESS);
+    allocator_trace_record(p_allocator, ALLOCATOR_TRACE_OP_ALLOC, 200, ALLOCATOR_ERROR_UNSUPPORTED_SIZE);
+    allocator_trace_record(p_allocator, ALLOCATOR_TRACE_OP_FREE, 7, ALLOCATOR_SUCCESS);
+    allocator_trace_stop();
+
+    FILE* p_file = allocator_trace_open(TRACE_PATH);
+    TEST_ASSERT_NOT_NULL(p_file);
+
+    // The configuration comes first since the allocator wasn't in the trace yet
+    TEST_ASSERT_TRUE(allocator_trace_read(p_file, &record, &config));
+    TEST_ASSERT_EQUAL(ALLOCATOR_TRACE_OP_INIT, record.op);
+    TEST_ASSERT_EQUAL_UINT32(p_allocator->trace_id, record.allocator_id);
+    TEST_ASSERT_EQUAL_UINT64(100, config.buffer_size);
+    TEST_ASSERT_EQUAL_UINT8(5, config.min_block_size);
+    TEST_ASSERT_EQUAL_UINT8(10, config.max_block_size);
+
+    read_record(p_file, ALLOCATOR_TRACE_OP_ALLOC, 7, ALLOCATOR_SUCCESS);
+    read_record(p_file, ALLOCATOR_TRACE_OP_ALLOC, 200, ALLOCATOR_ERROR_UNSUPPORTED_SIZE);
+    read_record(p_file, ALLOCATOR_TRACE_OP_FREE, 7, ALLOCATOR_SUCCESS);
+    TEST_ASSERT_FALSE(allocator_trace_read(p_file, &record, &config));
+
+    fclose(p_file);
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_trace_timestamps_are_ordered(void) {
+    allocator_t* p_allocator = allocator_init(100, 5, 10);
+    allocator_trace_record_t record;
+    allocator_trace_config_t config;
+    uint64_t previous_ns = 0;
+    size_t count = 0;
+
+    TEST_ASSERT_TRUE(allocator_trace_start(TRACE_PATH));
+    for (size_t i = 0; i < 10000; i++) {
+        allocator_trace_record(p_allocator, ALLOCATOR_TRACE_OP_PEEK, 5, ALLOCATOR_SUCCESS);
+    }
+    allocator_trace_stop();
+
+    FILE* p_file = allocator_trace_open(TRACE_PATH);
+    TEST_ASSERT_NOT_NULL(p_file);
+    while (allocator_trace_read(p_file, &record, &config) == true) {
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT64(previous_ns, record.time_ns);
+        previous_ns = record.time_ns;
+        count++;
+    }
+
+    // More records than fit in one buffer, plus the configuration
+    TEST_ASSERT_EQUAL(10001, count);
+
+    fclose(p_file);
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_trace_every_trace_has_the_configuration(void) {
+    allocator_t* p_allocator = allocator_init(100, 5, 10);
+    allocator_trace_record_t record;
+    allocator_trace_config_t config;
+
+    for (size_t i = 0; i < 2; i++) {
+        TEST_ASSERT_TRUE(allocator_trace_start(TRACE_PATH));
+        allocator_trace_record(p_allocator, ALLOCATOR_TRACE_OP_FREE, 5, ALLOCATOR_SUCCESS);
+        allocator_trace_stop();
+
+        FILE* p_file = allocator_trace_open(TRACE_PATH);
+        TEST_ASSERT_NOT_NULL(p_file);
+        TEST_ASSERT_TRUE(allocator_trace_read(p_file, &record, &config));
+        TEST_ASSERT_EQUAL(ALLOCATOR_TRACE_OP_INIT, record.op);
+        read_record(p_file, ALLOCATOR_TRACE_OP_FREE, 5, ALLOCATOR_SUCCESS);
+        TEST_ASSERT_FALSE(allocator_trace_read(p_file, &record, &config));
+        fclose(p_file);
+    }
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_trace_nothing_recorded_when_stopped(void) {
+    allocator_t* p_allocator = allocator_init(100, 5, 10);
+    allocator_trace_record_t record;
+    allocator_trace_config_t config;
+
+    TEST_ASSERT_TRUE(allocator_trace_start(TRACE_PATH));
+    allocator_trace_stop();
+    allocator_trace_record(p_allocator, ALLOCATOR_TRACE_OP_FREE, 5, ALLOCATOR_SUCCESS);
+
+    FILE* p_file = allocator_trace_open(TRACE_PATH);
+    TEST_ASSERT_NOT_NULL(p_file);
+    TEST_ASSERT_FALSE(allocator_trace_read(p_file, &record, &config));
+    fclose(p_file);
+
+    allocator_uninit(p_allocator);
+}
+
+void test_allocator_trace_start_fails(void) {
+    TEST_ASSERT_FALSE(allocator_trace_start("/nonexistent/trace.bin"));
+    TEST_ASSERT_TRUE(allocator_trace_start(TRACE_PATH));
+    TEST_ASSERT_FALSE(allocator_trace_start(TRACE_PATH));
+}
+
+void test_allocator_trace_open_rejects_other_files(void) {
+    FILE* p_file = fopen(TRACE_PATH, "wb");
+    fputs("not a trace", p_file);
+    fclose(p_file);
+
+    TEST_ASSERT_NULL(allocator_trace_open(TRACE_PATH));
+    TEST_ASSERT_NULL(allocator_trace_open("/nonexistent/trace.bin"));
+}
+
+void test_allocator_trace_operations_recorded(void) {
+    allocator_trace_record_t record;
+    allocator_trace_config_t config;
+    uint8_t* p_block = NULL;
+    size_t block_size = 0;
+
+    TEST_ASSERT_TRUE(allocator_trace_start(TRACE_PATH));
+    allocator_t* p_allocator = allocator_init(10, 5, 10);
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_alloc(p_allocator, 6, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_OUT_OF_MEMORY, allocator_alloc(p_allocator, 5, &p_block));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_peek(p_allocator, &p_block, &block_size));
+    TEST_ASSERT_EQUAL(ALLOCATOR_SUCCESS, allocator_free(p_allocator));
+    TEST_ASSERT_EQUAL(ALLOCATOR_ERROR_NOT_FOUND, allocator_free(p_allocator));
+    allocator_uninit(p_allocator);
+    allocator_trace_stop();
+
+    FILE* p_file = allocator_trace_open(TRACE_PATH);
+    TEST_ASSERT_NOT_NULL(p_file);
+#if defined(ALLOCATOR_TRACE)
+    TEST_ASSERT_TRUE(allocator_trace_read(p_file, &record, &config));
+    TEST_ASSERT_EQUAL(ALLOCATOR_TRACE_OP_INIT, record.op);
+    TEST_ASSERT_EQUAL_UINT64(10, config.buffer_size);
+    read_record(p_file, ALLOCATOR_TRACE_OP_ALLOC, 6, ALLOCATOR_SUCCESS);
+    read_record(p_file, ALLOCATOR_TRACE_OP_ALLOC, 5, ALLOCATOR_ERROR_OUT_OF_MEMORY);
+    read_record(p_file, ALLOCATOR_TRACE_OP_PEEK, 6, ALLOCATOR_SUCCESS);
+    read_record(p_file, ALLOCATOR_TRACE_OP_FREE, 6, ALLOCATOR_SUCCESS);
+
+    // Failed frees carry nothing worth replaying
+    read_record(p_file, ALLOCATOR_TRACE_OP_UNINIT, 0, ALLOCATOR_SUCCESS);
+#endif
+    TEST_ASSERT_FALSE(allocator_trace_read(p_file, &record, &config));
+    fclose(p_file);
+}
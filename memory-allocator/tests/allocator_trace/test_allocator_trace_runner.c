@@ -0,0 +1,89 @@
+/* AUTOGENERATED FILE. DO NOT EDIT. */
+
+/*=======Automagically Detected Files To Include=====*/
+#include "unity.h"
+#include "allocator.h"
+#include "allocator_trace.h"
+#include "stdio.h"
+
+/*=======External Functions This Runner Calls=====*/
+extern void setUp(void);
+extern void tearDown(void);
+extern void test_allocator_trace_records_are_read_back(void);
+extern void test_allocator_trace_timestamps_are_ordered(void);
+extern void test_allocator_trace_every_trace_has_the_configuration(void);
+extern void test_allocator_trace_nothing_recorded_when_stopped(void);
+extern void test_allocator_trace_start_fails(void);
+extern void test_allocator_trace_open_rejects_other_files(void);
+extern void test_allocator_trace_operations_recorded(void);
+
+
+/*=======Mock Management=====*/
+static void CMock_Init(void)
+{
+}
+static void CMock_Verify(void)
+{
+}
+static void CMock_Destroy(void)
+{
+}
+
+/*=======Test Reset Options=====*/
+void resetTest(void);
+void resetTest(void)
+{
+  tearDown();
+  CMock_Verify();
+  CMock_Destroy();
+  CMock_Init();
+  setUp();
+}
+void verifyTest(void);
+void verifyTest(void)
+{
+  CMock_Verify();
+}
+
+/*=======Test Runner Used To Run Each Test=====*/
+static void run_test(UnityTestFunction func, const char* name, UNITY_LINE_TYPE line_num)
+{
+    Unity.CurrentTestName = name;
+    Unity.CurrentTestLineNumber = line_num;
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+    if (!UnityTestMatches())
+        return;
+#endif
+    Unity.NumberOfTests++;
+    UNITY_CLR_DETAILS();
+    UNITY_EXEC_TIME_START();
+    CMock_Init();
+    if (TEST_PROTECT())
+    {
+        setUp();
+        func();
+    }
+    if (TEST_PROTECT())
+    {
+        tearDown();
+        CMock_Verify();
+    }
+    CMock_Destroy();
+    UNITY_EXEC_TIME_STOP();
+    UnityConcludeTest();
+}
+
+/*=======MAIN=====*/
+int main(void)
+{
+  UnityBegin("tests/test_allocator_trace.c");
+  run_test(test_allocator_trace_records_are_read_back, "test_allocator_trace_records_are_read_back", 27);
+  run_test(test_allocator_trace_timestamps_are_ordered, "test_allocator_trace_timestamps_are_ordered", 58);
+  run_test(test_allocator_trace_every_trace_has_the_configuration, "test_allocator_trace_every_trace_has_the_configuration", 86);
+  run_test(test_allocator_trace_nothing_recorded_when_stopped, "test_allocator_trace_nothing_recorded_when_stopped", 108);
+  run_test(test_allocator_trace_start_fails, "test_allocator_trace_start_fails", 125);
+  run_test(test_allocator_trace_open_rejects_other_files, "test_allocator_trace_open_rejects_other_files", 131);
+  run_test(test_allocator_trace_operations_recorded, "test_allocator_trace_operations_recorded", 140);
+
+  return UnityEnd();
+}
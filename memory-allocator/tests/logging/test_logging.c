@@ -0,0 +1,474 @@
+#include "logging_async.h"
+#include "logging_compact.h"
+#include "logging_flight.h"
+#include "logging_groups.h"
+#include "logging_levels.h"
+#include "logging_limits.h"
+#include "logging_sink.h"
+#include "logging_stamp.h"
+#include "logging_record.h"
+#include "pthread.h"
+#include "signal.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "sys/wait.h"
+#include "unistd.h"
+#include "unity.h"
+#include "logging.h"
+
+void setUp(void) {
+    // Nothing to set up
+}
+
+void tearDown(void) {
+    // Nothing to clean up
+}
+
+static size_t encode(uint8_t* p_record, size_t record_size, const log_site_t* p_site, ...) {
+    va_list args;
+    va_start(args, p_site);
+    size_t size = log_record_encode(p_record, record_size, p_site, args);
+    va_end(args);
+    return size;
+}
+
+static const char* format_site(const log_site_t* p_site, char* p_text, size_t text_size, ...) {
+    uint8_t record[LOG_RECORD_MAX_SIZE];
+    va_list args;
+    va_start(args, text_size);
+    size_t size = log_record_encode(record, sizeof(record), p_site, args);
+    va_end(args);
+
+    size_t header_size = sizeof(log_record_header_t);
+    log_record_format(p_site, NULL, &record[header_size], size - header_size, p_text, text_size);
+    return p_text;
+}
+
+// Records are stamped when LOG_TIMESTAMPS is defined, and the expected lines leave the stamp out
+static char* remove_stamp(char* p_text) {
+#if defined(LOG_TIMESTAMPS)
+    char* p_start = strchr(p_text, '[');
+    char* p_end = (p_start != NULL) ? strstr(p_start, "] ") : NULL;
+    if (p_end != NULL) {
+        memmove(p_start, p_end + 2, strlen(p_end + 2) + 1);
+    }
+#endif
+    return p_text;
+}
+
+static void* log_from_thread(void* p_argument) {
+    static const log_site_t site = { "thread.c", "Thread record %d", "", 1, 4 };
+    for (int i = 0; i < 100; i++) {
+        log_async_write(&site, site.p_format, i);
+    }
+    return p_argument;
+}
+
+static void* log_to_sink_from_thread(void* p_argument) {
+    for (int i = 0; i < 1000; i++) {
+        log_sink_write("", "thread.c", 1, "Thread record %d", i);
+    }
+    return p_argument;
+}
+
+static size_t get_file_size(FILE* p_file) {
+    fseek(p_file, 0, SEEK_END);
+    return (size_t)ftell(p_file);
+}
+
+void test_logging_record_formats_like_printf(void) {
+    const log_site_t site = { "file.c", "%d %u %ld %zu %x %c %s %.2f %5s|%-4d|%%", "", 42, 4 };
+    char text[LOG_RECORD_MAX_TEXT];
+    char expected[LOG_RECORD_MAX_TEXT];
+
+    snprintf(expected, sizeof(expected), "%-28s:%4d: -1 7 -123456789012 99 ff z text 3.14    ab|5   |%%\n", "file.c", 42);
+    TEST_ASSERT_EQUAL_STRING(expected,
+                             format_site(&site, text, sizeof(text), -1, 7u, -123456789012L, (size_t)99, 255, 'z', "text", 3.14159, "ab", 5));
+}
+
+void test_logging_record_star_width_and_precision(void) {
+    const log_site_t site = { "file.c", "[%*d] [%.*s] [%-*.*f]", NULL, 1, 4 };
+    const char not_terminated[3] = { 'a', 'b', 'c' };
+    char text[LOG_RECORD_MAX_TEXT];
+
+    TEST_ASSERT_EQUAL_STRING("[   12] [ab] [1.5  ]",
+                             format_site(&site, text, sizeof(text), 5, 12, 2, not_terminated, 5, 1, 1.5));
+}
+
+void test_logging_record_small_types_are_truncated(void) {
+    const log_site_t site = { "file.c", "%hhu %hd %lld %p %s", NULL, 1, 4 };
+    char text[LOG_RECORD_MAX_TEXT];
+    char expected[LOG_RECORD_MAX_TEXT];
+    int value = 0;
+
+    snprintf(expected, sizeof(expected), "44 -1 -5 %p (null)", (void*)&value);
+    TEST_ASSERT_EQUAL_STRING(expected, format_site(&site, text, sizeof(text), 300, 65535, -5LL, (void*)&value, (char*)NULL));
+}
+
+void test_logging_record_long_string_truncated(void) {
+    const log_site_t site = { "file.c", "%s %d", NULL, 1, 4 };
+    uint8_t record[LOG_RECORD_MAX_SIZE];
+    char text[LOG_RECORD_MAX_TEXT];
+    char string[2 * LOG_RECORD_MAX_SIZE];
+
+    memset(string, 'x', sizeof(string) - 1);
+    string[sizeof(string) - 1] = '\0';
+
+    // The string takes all the space left, so the integer after it is left out
+    TEST_ASSERT_EQUAL(LOG_RECORD_MAX_SIZE, encode(record, sizeof(record), &site, string, 5));
+    size_t length = log_record_format(&site, NULL, &record[sizeof(log_record_header_t)], LOG_RECORD_MAX_SIZE - sizeof(log_record_header_t), text, sizeof(text));
+    // All the characters that fit, plus the space before the integer
+    TEST_ASSERT_EQUAL(LOG_RECORD_MAX_SIZE - sizeof(log_record_header_t), length);
+    TEST_ASSERT_EQUAL_CHAR('x', text[0]);
+    TEST_ASSERT_EQUAL_CHAR(' ', text[length - 1]);
+}
+
+void test_logging_record_text_truncated_keeps_newline(void) {
+    const log_site_t site = { "file.c", "%s", "", 1, 4 };
+    char text[16];
+
+    TEST_ASSERT_EQUAL(15, strlen(format_site(&site, text, sizeof(text), "a long message")));
+    TEST_ASSERT_EQUAL_CHAR('\n', text[14]);
+}
+
+void test_logging_async_writes_records_of_all_threads(void) {
+    static const log_site_t site = { "main.c", "Main record %d", "", 2, 4 };
+    FILE* p_file = tmpfile();
+    pthread_t thread;
+    char line[LOG_RECORD_MAX_TEXT];
+    size_t main_lines = 0;
+    size_t thread_lines = 0;
+
+    log_async_set_compact(false);
+    log_async_set_output(fileno(p_file));
+    TEST_ASSERT_EQUAL(0, pthread_create(&thread, NULL, log_from_thread, NULL));
+    for (int i = 0; i < 100; i++) {
+        log_async_write(&site, site.p_format, i);
+    }
+    pthread_join(thread, NULL);
+    log_async_flush();
+    log_async_set_output(STDOUT_FILENO);
+
+    rewind(p_file);
+    while (fgets(line, sizeof(line), p_file) != NULL) {
+        if (strstr(line, "Main record") != NULL) {
+            main_lines++;
+        } else if (strstr(line, "Thread record") != NULL) {
+            thread_lines++;
+        }
+    }
+    fclose(p_file);
+
+    TEST_ASSERT_EQUAL(100, main_lines);
+    TEST_ASSERT_EQUAL(100, thread_lines);
+}
+
+void test_logging_compact_stream_decodes_to_text(void) {
+    static const log_site_t first_site LOG_SITE_ATTRIBUTES = { "first.c", "Value %d of %s", "", 10, 4 };
+    static const log_site_t second_site LOG_SITE_ATTRIBUTES = { "second.c", "Raw %.1f", NULL, 20, 4 };
+    static const log_site_t unknown_site = { "unknown.c", "Unknown", "", 30, 4 };
+    FILE* p_file = tmpfile();
+    log_compact_reader_t reader;
+    char text[LOG_RECORD_MAX_TEXT];
+    char expected[LOG_RECORD_MAX_TEXT];
+
+    TEST_ASSERT(log_compact_get_site_id(&first_site) != LOG_COMPACT_UNKNOWN_SITE);
+    TEST_ASSERT(log_compact_get_site_id(&second_site) != LOG_COMPACT_UNKNOWN_SITE);
+    TEST_ASSERT(log_compact_get_site_id(&first_site) != log_compact_get_site_id(&second_site));
+    TEST_ASSERT_EQUAL(LOG_COMPACT_UNKNOWN_SITE, log_compact_get_site_id(&unknown_site));
+
+    log_async_set_compact(true);
+    log_async_set_output(fileno(p_file));
+    log_async_write(&first_site, first_site.p_format, 7, "eight");
+    log_async_write(&second_site, second_site.p_format, 2.5);
+    log_async_write(&unknown_site, unknown_site.p_format);
+    log_async_flush();
+    log_async_set_output(STDOUT_FILENO);
+    log_async_set_compact(false);
+
+    rewind(p_file);
+    log_compact_reader_init(&reader, p_file);
+
+    snprintf(expected, sizeof(expected), "%-28s:%4d: Value 7 of eight\n", "first.c", 10);
+    TEST_ASSERT(log_compact_read(&reader, text, sizeof(text)) == true);
+    TEST_ASSERT_EQUAL_STRING(expected, remove_stamp(text));
+    TEST_ASSERT(log_compact_read(&reader, text, sizeof(text)) == true);
+    TEST_ASSERT_EQUAL_STRING("Raw 2.5", text);
+    TEST_ASSERT(log_compact_read(&reader, text, sizeof(text)) == true);
+    TEST_ASSERT_EQUAL_STRING("Unknown log call site 4294967295\n", remove_stamp(text));
+    TEST_ASSERT(log_compact_read(&reader, text, sizeof(text)) == false);
+
+    log_compact_reader_uninit(&reader);
+    fclose(p_file);
+}
+
+void test_logging_levels_set_and_get(void) {
+    uint8_t previous = log_get_level(LOG_GROUP_ID_ALLOCATOR);
+
+    log_set_level(LOG_GROUP_ID_ALLOCATOR, 2);
+    TEST_ASSERT_EQUAL(2, log_get_level(LOG_GROUP_ID_ALLOCATOR));
+    TEST_ASSERT(log_level_enabled(LOG_GROUP_ID_ALLOCATOR, 2));
+    TEST_ASSERT_FALSE(log_level_enabled(LOG_GROUP_ID_ALLOCATOR, 3));
+
+    log_set_level(LOG_GROUP_ID_ALLOCATOR, previous);
+}
+
+void test_logging_levels_parsed_from_list(void) {
+    TEST_ASSERT(log_set_levels("all=warning,allocator=debug") == true);
+    TEST_ASSERT_EQUAL(2, log_get_level(LOG_GROUP_ID_DEFAULT));
+    TEST_ASSERT_EQUAL(4, log_get_level(LOG_GROUP_ID_ALLOCATOR));
+
+    // Valid pairs are applied even if others are not
+    TEST_ASSERT(log_set_levels("default=1,unknown=info,allocator=loud") == false);
+    TEST_ASSERT_EQUAL(1, log_get_level(LOG_GROUP_ID_DEFAULT));
+    TEST_ASSERT_EQUAL(4, log_get_level(LOG_GROUP_ID_ALLOCATOR));
+
+    log_set_levels("all=trace2");
+}
+
+void test_logging_levels_changed_by_signals(void) {
+    TEST_ASSERT(log_levels_handle_signals() == true);
+    log_set_levels("default=info,allocator=off");
+
+    raise(SIGUSR1);
+    TEST_ASSERT_EQUAL(4, log_get_level(LOG_GROUP_ID_DEFAULT));
+    TEST_ASSERT_EQUAL(1, log_get_level(LOG_GROUP_ID_ALLOCATOR));
+
+    // Levels go back to the ones at startup, which let everything through
+    raise(SIGUSR2);
+    TEST_ASSERT_EQUAL(LOG_RUNTIME_LEVEL_DEFAULT, log_get_level(LOG_GROUP_ID_DEFAULT));
+    TEST_ASSERT_EQUAL(LOG_RUNTIME_LEVEL_DEFAULT, log_get_level(LOG_GROUP_ID_ALLOCATOR));
+}
+
+void test_logging_sink_writes_when_flushed(void) {
+    FILE* p_file = tmpfile();
+    char line[LOG_RECORD_MAX_TEXT];
+    char expected[LOG_RECORD_MAX_TEXT];
+
+    log_sink_set_output(fileno(p_file));
+    log_sink_write("", "file.c", 12, "Buffered %d", 1);
+    log_sink_write(NULL, "file.c", 13, "raw ");
+    log_sink_write("", "file.c", 14, "Buffered %d", 2);
+    TEST_ASSERT_EQUAL(0, get_file_size(p_file));
+
+    log_sink_flush();
+    log_sink_set_output(STDOUT_FILENO);
+
+    rewind(p_file);
+    snprintf(expected, sizeof(expected), "%-28s:%4d: Buffered 1\n", "file.c", 12);
+    TEST_ASSERT(fgets(line, sizeof(line), p_file) != NULL);
+    TEST_ASSERT_EQUAL_STRING(expected, remove_stamp(line));
+    snprintf(expected, sizeof(expected), "raw %-28s:%4d: Buffered 2\n", "file.c", 14);
+    TEST_ASSERT(fgets(line, sizeof(line), p_file) != NULL);
+    TEST_ASSERT_EQUAL_STRING(expected, remove_stamp(line));
+    fclose(p_file);
+}
+
+void test_logging_sink_writes_when_full(void) {
+    FILE* p_file = tmpfile();
+    char message[LOG_SINK_BUFFER_SIZE / 4];
+
+    memset(message, 'x', sizeof(message) - 1);
+    message[sizeof(message) - 1] = '\0';
+
+    // Only whole records are written
+    log_sink_set_output(fileno(p_file));
+    for (int i = 0; i < 4; i++) {
+        log_sink_write(NULL, "file.c", 1, "%s", message);
+    }
+    TEST_ASSERT_EQUAL(0, get_file_size(p_file));
+    log_sink_write(NULL, "file.c", 1, "%s", message);
+    TEST_ASSERT_EQUAL(4 * (sizeof(message) - 1), get_file_size(p_file));
+
+    log_sink_flush();
+    log_sink_set_output(STDOUT_FILENO);
+    TEST_ASSERT_EQUAL(5 * (sizeof(message) - 1), get_file_size(p_file));
+    fclose(p_file);
+}
+
+void test_logging_sink_lines_of_threads_do_not_interleave(void) {
+    FILE* p_file = tmpfile();
+    pthread_t threads[4];
+    char line[LOG_RECORD_MAX_TEXT];
+    char expected_prefix[LOG_RECORD_MAX_TEXT];
+    size_t lines = 0;
+
+    log_sink_set_output(fileno(p_file));
+    for (size_t i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(0, pthread_create(&threads[i], NULL, log_to_sink_from_thread, NULL));
+    }
+    // Threads write what is left in their buffers when they exit
+    for (size_t i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    log_sink_set_output(STDOUT_FILENO);
+
+    rewind(p_file);
+    snprintf(expected_prefix, sizeof(expected_prefix), "%-28s:%4d: Thread record ", "thread.c", 1);
+    while (fgets(line, sizeof(line), p_file) != NULL) {
+        TEST_ASSERT_EQUAL(0, strncmp(remove_stamp(line), expected_prefix, strlen(expected_prefix)));
+        lines++;
+    }
+    fclose(p_file);
+
+    TEST_ASSERT_EQUAL(4000, lines);
+}
+
+void test_logging_flight_dump_keeps_latest_records(void) {
+    static const log_site_t site LOG_SITE_ATTRIBUTES = { "flight.c", "Flight record %d", "", 5, 4 };
+    FILE* p_file = tmpfile();
+    log_compact_reader_t reader;
+    char text[LOG_RECORD_MAX_TEXT];
+    char expected[LOG_RECORD_MAX_TEXT];
+    int records = 0;
+
+    for (int i = 0; i < LOG_FLIGHT_SLOTS + 10; i++) {
+        log_flight_write(&site, site.p_format, i);
+    }
+    log_flight_dump(fileno(p_file));
+
+    // Only the newest records are left, oldest first
+    rewind(p_file);
+    log_compact_reader_init(&reader, p_file);
+    while (log_compact_read(&reader, text, sizeof(text)) == true) {
+        snprintf(expected, sizeof(expected), "%-28s:%4d: Flight record %d\n", "flight.c", 5, records + 10);
+        TEST_ASSERT_EQUAL_STRING(expected, remove_stamp(text));
+        records++;
+    }
+    log_compact_reader_uninit(&reader);
+    fclose(p_file);
+
+    TEST_ASSERT_EQUAL(LOG_FLIGHT_SLOTS, records);
+}
+
+void test_logging_flight_dumped_on_crash(void) {
+    static const log_site_t site LOG_SITE_ATTRIBUTES = { "crash.c", "Last words %s", "", 9, 1 };
+    char path[] = "/tmp/test_logging_flight_XXXXXX";
+    log_compact_reader_t reader;
+    char text[LOG_RECORD_MAX_TEXT];
+    char last_text[LOG_RECORD_MAX_TEXT] = "";
+    char expected[LOG_RECORD_MAX_TEXT];
+    int status;
+
+    int fd = mkstemp(path);
+    TEST_ASSERT(fd >= 0);
+    close(fd);
+
+    pid_t child = fork();
+    TEST_ASSERT(child >= 0);
+    if (child == 0) {
+        log_flight_dump_on_crash(path);
+        log_flight_write(&site, site.p_format, "before abort");
+        abort();
+    }
+    TEST_ASSERT_EQUAL(child, waitpid(child, &status, 0));
+    TEST_ASSERT(WIFSIGNALED(status));
+    TEST_ASSERT_EQUAL(SIGABRT, WTERMSIG(status));
+
+    FILE* p_file = fopen(path, "rb");
+    TEST_ASSERT(p_file != NULL);
+    log_compact_reader_init(&reader, p_file);
+    while (log_compact_read(&reader, text, sizeof(text)) == true) {
+        strcpy(last_text, text);
+    }
+    log_compact_reader_uninit(&reader);
+    fclose(p_file);
+    unlink(path);
+
+    snprintf(expected, sizeof(expected), "%-28s:%4d: Last words before abort\n", "crash.c", 9);
+    TEST_ASSERT_EQUAL_STRING(expected, remove_stamp(last_text));
+}
+
+void test_logging_sample_follows_probability(void) {
+    uint32_t sampled = 0;
+
+    for (int i = 0; i < 1000; i++) {
+        TEST_ASSERT_FALSE(log_sample(0.0));
+        TEST_ASSERT_TRUE(log_sample(1.0));
+    }
+    for (int i = 0; i < 10000; i++) {
+        if (log_sample(0.25) == true) {
+            sampled++;
+        }
+    }
+    TEST_ASSERT_UINT32_WITHIN(500, 2500, sampled);
+}
+
+void test_logging_ratelimit_allows_a_burst_of_one_second(void) {
+    uint64_t state = 0;
+
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_TRUE(log_ratelimit(&state, 10));
+    }
+    TEST_ASSERT_FALSE(log_ratelimit(&state, 10));
+    TEST_ASSERT_FALSE(log_ratelimit(&state, 0));
+}
+
+void test_logging_every_n_skips_arguments_of_suppressed_records(void) {
+    int emitted = 0;
+
+    for (int i = 0; i < 100; i++) {
+        log_info_every_n(10, "Every 10th record %d", ++emitted);
+    }
+    log_flush();
+    TEST_ASSERT_EQUAL(10, emitted);
+}
+
+void test_logging_every_n_of_zero_and_one(void) {
+    int emitted = 0;
+
+    // Every record is emitted with n of 1, none with n of 0
+    for (int i = 0; i < 10; i++) {
+        log_info_every_n(1, "Every record %d", ++emitted);
+    }
+    for (int i = 0; i < 10; i++) {
+        log_info_every_n(0, "No record %d", ++emitted);
+    }
+    log_flush();
+    TEST_ASSERT_EQUAL(10, emitted);
+}
+
+static void* get_thread_id(void* p_argument) {
+    *(uint32_t*)p_argument = log_stamp_get_thread_id();
+    return NULL;
+}
+
+void test_logging_stamp_identifies_threads(void) {
+    uint32_t other_thread_id = 0;
+    pthread_t thread;
+
+    TEST_ASSERT_EQUAL(0, pthread_create(&thread, NULL, get_thread_id, &other_thread_id));
+    pthread_join(thread, NULL);
+
+    TEST_ASSERT(log_stamp_get_thread_id() != 0);
+    TEST_ASSERT_EQUAL(log_stamp_get_thread_id(), log_stamp_get_thread_id());
+    TEST_ASSERT(other_thread_id != 0);
+    TEST_ASSERT(other_thread_id != log_stamp_get_thread_id());
+}
+
+void test_logging_stamp_time_increases(void) {
+    log_stamp_t first;
+    log_stamp_t second;
+
+    log_stamp_now(&first);
+    usleep(2000);
+    log_stamp_now(&second);
+
+    TEST_ASSERT(second.ns >= first.ns + 1000000);
+    TEST_ASSERT_EQUAL(first.thread_id, second.thread_id);
+}
+
+void test_logging_stamp_formatted_before_location(void) {
+    static const log_site_t site = { "file.c", "Stamped %d", "", 3, 4 };
+    const log_stamp_t stamp = { .ns = 12345678901ull, .thread_id = 42 };
+    uint8_t record[LOG_RECORD_MAX_SIZE];
+    char text[LOG_RECORD_MAX_TEXT];
+    char expected[LOG_RECORD_MAX_TEXT];
+
+    size_t size = encode(record, sizeof(record), &site, 5);
+    log_record_format(&site, &stamp, &record[sizeof(log_record_header_t)], size - sizeof(log_record_header_t), text, sizeof(text));
+
+    snprintf(expected, sizeof(expected), "[    12.345678901     42] %-28s:%4d: Stamped 5\n", "file.c", 3);
+    TEST_ASSERT_EQUAL_STRING(expected, text);
+}
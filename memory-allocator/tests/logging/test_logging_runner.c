@@ -0,0 +1,133 @@
+/* AUTOGENERATED FILE. DO NOT EDIT. */
+
+/*=======Automagically Detected Files To Include=====*/
+#include "unity.h"
+#include "logging_async.h"
+#include "logging_compact.h"
+#include "logging_flight.h"
+#include "logging_groups.h"
+#include "logging_levels.h"
+#include "logging_limits.h"
+#include "logging_sink.h"
+#include "logging_stamp.h"
+#include "logging_record.h"
+#include "pthread.h"
+#include "signal.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "sys/wait.h"
+#include "unistd.h"
+#include "logging.h"
+
+/*=======External Functions This Runner Calls=====*/
+extern void setUp(void);
+extern void tearDown(void);
+extern void test_logging_record_formats_like_printf(void);
+extern void test_logging_record_star_width_and_precision(void);
+extern void test_logging_record_small_types_are_truncated(void);
+extern void test_logging_record_long_string_truncated(void);
+extern void test_logging_record_text_truncated_keeps_newline(void);
+extern void test_logging_async_writes_records_of_all_threads(void);
+extern void test_logging_compact_stream_decodes_to_text(void);
+extern void test_logging_levels_set_and_get(void);
+extern void test_logging_levels_parsed_from_list(void);
+extern void test_logging_levels_changed_by_signals(void);
+extern void test_logging_sink_writes_when_flushed(void);
+extern void test_logging_sink_writes_when_full(void);
+extern void test_logging_sink_lines_of_threads_do_not_interleave(void);
+extern void test_logging_flight_dump_keeps_latest_records(void);
+extern void test_logging_flight_dumped_on_crash(void);
+extern void test_logging_sample_follows_probability(void);
+extern void test_logging_ratelimit_allows_a_burst_of_one_second(void);
+extern void test_logging_every_n_skips_arguments_of_suppressed_records(void);
+extern void test_logging_every_n_of_zero_and_one(void);
+extern void test_logging_stamp_identifies_threads(void);
+extern void test_logging_stamp_time_increases(void);
+extern void test_logging_stamp_formatted_before_location(void);
+
+
+/*=======Mock Management=====*/
+static void CMock_Init(void)
+{
+}
+static void CMock_Verify(void)
+{
+}
+static void CMock_Destroy(void)
+{
+}
+
+/*=======Test Reset Options=====*/
+void resetTest(void);
+void resetTest(void)
+{
+  tearDown();
+  CMock_Verify();
+  CMock_Destroy();
+  CMock_Init();
+  setUp();
+}
+void verifyTest(void);
+void verifyTest(void)
+{
+  CMock_Verify();
+}
+
+/*=======Test Runner Used To Run Each Test=====*/
+static void run_test(UnityTestFunction func, const char* name, UNITY_LINE_TYPE line_num)
+{
+    Unity.CurrentTestName = name;
+    Unity.CurrentTestLineNumber = line_num;
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+    if (!UnityTestMatches())
+        return;
+#endif
+    Unity.NumberOfTests++;
+    UNITY_CLR_DETAILS();
+    UNITY_EXEC_TIME_START();
+    CMock_Init();
+    if (TEST_PROTECT())
+    {
+        setUp();
+        func();
+    }
+    if (TEST_PROTECT())
+    {
+        tearDown();
+        CMock_Verify();
+    }
+    CMock_Destroy();
+    UNITY_EXEC_TIME_STOP();
+    UnityConcludeTest();
+}
+
+/*=======MAIN=====*/
+int main(void)
+{
+  UnityBegin("tests/test_logging.c");
+  run_test(test_logging_record_formats_like_printf, "test_logging_record_formats_like_printf", 80);
+  run_test(test_logging_record_star_width_and_precision, "test_logging_record_star_width_and_precision", 90);
+  run_test(test_logging_record_small_types_are_truncated, "test_logging_record_small_types_are_truncated", 99);
+  run_test(test_logging_record_long_string_truncated, "test_logging_record_long_string_truncated", 109);
+  run_test(test_logging_record_text_truncated_keeps_newline, "test_logging_record_text_truncated_keeps_newline", 127);
+  run_test(test_logging_async_writes_records_of_all_threads, "test_logging_async_writes_records_of_all_threads", 135);
+  run_test(test_logging_compact_stream_decodes_to_text, "test_logging_compact_stream_decodes_to_text", 167);
+  run_test(test_logging_levels_set_and_get, "test_logging_levels_set_and_get", 206);
+  run_test(test_logging_levels_parsed_from_list, "test_logging_levels_parsed_from_list", 217);
+  run_test(test_logging_levels_changed_by_signals, "test_logging_levels_changed_by_signals", 230);
+  run_test(test_logging_sink_writes_when_flushed, "test_logging_sink_writes_when_flushed", 244);
+  run_test(test_logging_sink_writes_when_full, "test_logging_sink_writes_when_full", 268);
+  run_test(test_logging_sink_lines_of_threads_do_not_interleave, "test_logging_sink_lines_of_threads_do_not_interleave", 290);
+  run_test(test_logging_flight_dump_keeps_latest_records, "test_logging_flight_dump_keeps_latest_records", 318);
+  run_test(test_logging_flight_dumped_on_crash, "test_logging_flight_dumped_on_crash", 345);
+  run_test(test_logging_sample_follows_probability, "test_logging_sample_follows_probability", 383);
+  run_test(test_logging_ratelimit_allows_a_burst_of_one_second, "test_logging_ratelimit_allows_a_burst_of_one_second", 398);
+  run_test(test_logging_every_n_skips_arguments_of_suppressed_records, "test_logging_every_n_skips_arguments_of_suppressed_records", 408);
+  run_test(test_logging_every_n_of_zero_and_one, "test_logging_every_n_of_zero_and_one", 418);
+  run_test(test_logging_stamp_identifies_threads, "test_logging_stamp_identifies_threads", 437);
+  run_test(test_logging_stamp_time_increases, "test_logging_stamp_time_increases", 450);
+  run_test(test_logging_stamp_formatted_before_location, "test_logging_stamp_formatted_before_location", 462);
+
+  return UnityEnd();
+}
@@ -0,0 +1,100 @@
+#include "allocator.h"
+#include "planner.h"
+#include "replay.h"
+#include "unity.h"
+
+static const replay_generator_t generator = {
+    .blocks = 10000,
+    .rate = 1e9,
+    .min_block_size = 8,
+    .max_block_size = 64,
+    .backlog = 64,
+    .buffer_size = 4096,
+    .seed = 42,
+};
+
+static replay_trace_t trace;
+
+void setUp(void) {
+    TEST_ASSERT_TRUE(replay_trace_generate(&generator, &trace));
+}
+
+void tearDown(void) {
+    replay_trace_release(&trace);
+}
+
+void test_planner_simulation_matches_replay(void) {
+    const size_t buffer_sizes[] = { 512, 1024, 2048, 4096 };
+
+    for (size_t i = 0; i < sizeof(buffer_sizes) / sizeof(buffer_sizes[0]); i++) {
+        const replay_options_t options = { .pace = REPLAY_PACE_FAST, .buffer_size = buffer_sizes[i] };
+        replay_result_t result;
+        planner_simulation_t simulation;
+
+        TEST_ASSERT_TRUE(replay_run(&trace, &options, &result));
+        TEST_ASSERT_TRUE(planner_simulate(&trace, 0, buffer_sizes[i], 8, 64, &simulation));
+
+        TEST_ASSERT_EQUAL_UINT64(result.allocs, simulation.allocs);
+        TEST_ASSERT_EQUAL_UINT64(result.out_of_memory, simulation.out_of_memory);
+        TEST_ASSERT_EQUAL(result.peak_utilization, simulation.peak_utilization);
+    }
+}
+
+void test_planner_unsupported_sizes(void) {
+    planner_simulation_t simulation;
+
+    TEST_ASSERT_TRUE(planner_simulate(&trace, 0, 4096, 16, 32, &simulation));
+    TEST_ASSERT_GREATER_THAN_UINT64(0, simulation.unsupported_size);
+    TEST_ASSERT_LESS_THAN_UINT64(simulation.allocs, simulation.unsupported_size);
+}
+
+void test_planner_block_sizes(void) {
+    planner_plan_t plan;
+
+    TEST_ASSERT_TRUE(planner_plan(&trace, 0, 0.0, &plan));
+    TEST_ASSERT_EQUAL_UINT8(8, plan.min_block_size);
+    TEST_ASSERT_EQUAL_UINT8(64, plan.max_block_size);
+    TEST_ASSERT_EQUAL(4096, plan.configured_buffer_size);
+}
+
+void test_planner_no_out_of_memory(void) {
+    planner_plan_t plan;
+    planner_simulation_t simulation;
+
+    TEST_ASSERT_TRUE(planner_plan(&trace, 0, 0.0, &plan));
+
+    // Nothing runs out of memory with room for the peak demand, something does with one byte less
+    TEST_ASSERT_EQUAL(plan.peak_demand, plan.buffer_size);
+    TEST_ASSERT_TRUE(planner_simulate(&trace, 0, plan.buffer_size, plan.min_block_size, plan.max_block_size, &simulation));
+    TEST_ASSERT_EQUAL_UINT64(0, simulation.out_of_memory);
+    TEST_ASSERT_TRUE(planner_simulate(&trace, 0, plan.buffer_size - 1, plan.min_block_size, plan.max_block_size, &simulation));
+    TEST_ASSERT_GREATER_THAN_UINT64(0, simulation.out_of_memory);
+}
+
+void test_planner_target_rate(void) {
+    planner_plan_t plan;
+    planner_simulation_t simulation;
+
+    TEST_ASSERT_TRUE(planner_plan(&trace, 0, 0.05, &plan));
+    TEST_ASSERT_LESS_THAN(plan.peak_demand, plan.buffer_size);
+
+    TEST_ASSERT_TRUE(planner_simulate(&trace, 0, plan.buffer_size, plan.min_block_size, plan.max_block_size, &simulation));
+    TEST_ASSERT_TRUE((double)simulation.out_of_memory <= 0.05 * (double)simulation.allocs);
+    TEST_ASSERT_TRUE(planner_simulate(&trace, 0, plan.buffer_size - 1, plan.min_block_size, plan.max_block_size, &simulation));
+    TEST_ASSERT_TRUE((double)simulation.out_of_memory > 0.05 * (double)simulation.allocs);
+}
+
+void test_planner_nothing_allocated(void) {
+    allocator_trace_config_t config = { .buffer_size = 100, .min_block_size = 5, .max_block_size = 10 };
+    allocator_trace_record_t record = { .size = 5, .op = ALLOCATOR_TRACE_OP_ALLOC, .result = ALLOCATOR_ERROR_OUT_OF_MEMORY };
+    replay_trace_t empty = { &record, 1, &config, 1 };
+    planner_plan_t plan;
+
+    TEST_ASSERT_FALSE(planner_plan(&empty, 0, 0.0, &plan));
+}
+
+void test_planner_footprint(void) {
+    // Data buffer with its overhang and size buffer, both with their extra slot
+    TEST_ASSERT_EQUAL(101 + 10 + 21, planner_get_footprint(100, 5, 10));
+    TEST_ASSERT_EQUAL(4097 + 64 + 513, planner_get_footprint(4096, 8, 64));
+}
@@ -0,0 +1,89 @@
+/* AUTOGENERATED FILE. DO NOT EDIT. */
+
+/*=======Automagically Detected Files To Include=====*/
+#include "unity.h"
+#include "allocator.h"
+#include "planner.h"
+#include "replay.h"
+
+/*=======External Functions This Runner Calls=====*/
+extern void setUp(void);
+extern void tearDown(void);
+extern void test_planner_simulation_matches_replay(void);
+extern void test_planner_unsupported_sizes(void);
+extern void test_planner_block_sizes(void);
+extern void test_planner_no_out_of_memory(void);
+extern void test_planner_target_rate(void);
+extern void test_planner_nothing_allocated(void);
+extern void test_planner_footprint(void);
+
+
+/*=======Mock Management=====*/
+static void CMock_Init(void)
+{
+}
+static void CMock_Verify(void)
+{
+}
+static void CMock_Destroy(void)
+{
+}
+
+/*=======Test Reset Options=====*/
+void resetTest(void);
+void resetTest(void)
+{
+  tearDown();
+  CMock_Verify();
+  CMock_Destroy();
+  CMock_Init();
+  setUp();
+}
+void verifyTest(void);
+void verifyTest(void)
+{
+  CMock_Verify();
+}
+
+/*=======Test Runner Used To Run Each Test=====*/
+static void run_test(UnityTestFunction func, const char* name, UNITY_LINE_TYPE line_num)
+{
+    Unity.CurrentTestName = name;
+    Unity.CurrentTestLineNumber = line_num;
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+    if (!UnityTestMatches())
+        return;
+#endif
+    Unity.NumberOfTests++;
+    UNITY_CLR_DETAILS();
+    UNITY_EXEC_TIME_START();
+    CMock_Init();
+    if (TEST_PROTECT())
+    {
+        setUp();
+        func();
+    }
+    if (TEST_PROTECT())
+    {
+        tearDown();
+        CMock_Verify();
+    }
+    CMock_Destroy();
+    UNITY_EXEC_TIME_STOP();
+    UnityConcludeTest();
+}
+
+/*=======MAIN=====*/
+int main(void)
+{
+  UnityBegin("tests/test_planner.c");
+  run_test(test_planner_simulation_matches_replay, "test_planner_simulation_matches_replay", 26);
+  run_test(test_planner_unsupported_sizes, "test_planner_unsupported_sizes", 43);
+  run_test(test_planner_block_sizes, "test_planner_block_sizes", 51);
+  run_test(test_planner_no_out_of_memory, "test_planner_no_out_of_memory", 60);
+  run_test(test_planner_target_rate, "test_planner_target_rate", 74);
+  run_test(test_planner_nothing_allocated, "test_planner_nothing_allocated", 87);
+  run_test(test_planner_footprint, "test_planner_footprint", 96);
+
+  return UnityEnd();
+}
@@ -0,0 +1,187 @@
+#include "allocator.h"
+#include "allocator_trace.h"
+#include "replay.h"
+#include "stdio.h"
+#include "unity.h"
+
+#define TRACE_PATH "test_replay.bin"
+
+// Small enough to run quickly, large enough to wrap the buffer many times
+static const replay_generator_t generator = {
+    .blocks = 10000,
+    .rate = 1e9,
+    .min_block_size = 8,
+    .max_block_size = 64,
+    .backlog = 64,
+    .buffer_size = 4096,
+    .seed = 42,
+};
+
+void setUp(void) {
+    // Nothing to set up
+}
+
+void tearDown(void) {
+    remove(TRACE_PATH);
+}
+
+static size_t count_ops(const replay_trace_t* p_trace, allocator_trace_op_t op) {
+    size_t count = 0;
+    for (size_t i = 0; i < p_trace->record_count; i++) {
+        if (p_trace->p_records[i].op == op) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void test_replay_generated_trace(void) {
+    replay_trace_t trace;
+
+    TEST_ASSERT_TRUE(replay_trace_generate(&generator, &trace));
+    TEST_ASSERT_EQUAL(1, trace.allocator_count);
+    TEST_ASSERT_EQUAL_UINT64(4096, trace.p_configs[0].buffer_size);
+    TEST_ASSERT_EQUAL(10000, count_ops(&trace, ALLOCATOR_TRACE_OP_ALLOC));
+    TEST_ASSERT_EQUAL(count_ops(&trace, ALLOCATOR_TRACE_OP_PEEK), count_ops(&trace, ALLOCATOR_TRACE_OP_FREE));
+
+    for (size_t i = 1; i < trace.record_count; i++) {
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT64(trace.p_records[i - 1].time_ns, trace.p_records[i].time_ns);
+        TEST_ASSERT_TRUE((trace.p_records[i].size >= 8) && (trace.p_records[i].size <= 64));
+    }
+
+    replay_trace_release(&trace);
+}
+
+void test_replay_generate_rejects_invalid_parameters(void) {
+    replay_generator_t invalid = generator;
+    replay_trace_t trace;
+
+    invalid.min_block_size = 100;
+    TEST_ASSERT_FALSE(replay_trace_generate(&invalid, &trace));
+    invalid = generator;
+    invalid.blocks = 0;
+    TEST_ASSERT_FALSE(replay_trace_generate(&invalid, &trace));
+}
+
+void test_replay_save_and_load(void) {
+    replay_trace_t generated;
+    replay_trace_t loaded;
+
+    TEST_ASSERT_TRUE(replay_trace_generate(&generator, &generated));
+    TEST_ASSERT_TRUE(replay_trace_save(&generated, TRACE_PATH));
+    TEST_ASSERT_TRUE(replay_trace_load(TRACE_PATH, &loaded));
+
+    TEST_ASSERT_EQUAL(generated.allocator_count, loaded.allocator_count);
+    TEST_ASSERT_EQUAL_MEMORY(generated.p_configs, loaded.p_configs, sizeof(allocator_trace_config_t));
+    TEST_ASSERT_EQUAL(generated.record_count, loaded.record_count);
+    TEST_ASSERT_EQUAL_MEMORY(generated.p_records, loaded.p_records, generated.record_count * sizeof(allocator_trace_record_t));
+
+    replay_trace_release(&generated);
+    replay_trace_release(&loaded);
+}
+
+void test_replay_load_sorts_records(void) {
+    allocator_trace_config_t configs[2] = {
+        { .buffer_size = 100, .min_block_size = 5, .max_block_size = 10 },
+        { .buffer_size = 200, .min_block_size = 5, .max_block_size = 10 },
+    };
+    allocator_trace_record_t records[3] = {
+        { .time_ns = 30, .allocator_id = 1, .size = 5, .op = ALLOCATOR_TRACE_OP_FREE },
+        { .time_ns = 10, .allocator_id = 1, .size = 5, .op = ALLOCATOR_TRACE_OP_ALLOC },
+        { .time_ns = 20, .allocator_id = 0, .size = 6, .op = ALLOCATOR_TRACE_OP_ALLOC },
+    };
+    replay_trace_t trace = { records, 3, configs, 2 };
+    replay_trace_t loaded;
+
+    // Records of different threads come in chunks, so a trace isn't sorted by time
+    TEST_ASSERT_TRUE(replay_trace_save(&trace, TRACE_PATH));
+    TEST_ASSERT_TRUE(replay_trace_load(TRACE_PATH, &loaded));
+
+    TEST_ASSERT_EQUAL(3, loaded.record_count);
+    TEST_ASSERT_EQUAL_UINT64(10, loaded.p_records[0].time_ns);
+    TEST_ASSERT_EQUAL_UINT32(1, loaded.p_records[0].allocator_id);
+    TEST_ASSERT_EQUAL_UINT64(20, loaded.p_records[1].time_ns);
+    TEST_ASSERT_EQUAL_UINT32(0, loaded.p_records[1].allocator_id);
+    TEST_ASSERT_EQUAL_UINT64(30, loaded.p_records[2].time_ns);
+    TEST_ASSERT_EQUAL_UINT64(200, loaded.p_configs[loaded.p_records[0].allocator_id].buffer_size);
+
+    replay_trace_release(&loaded);
+}
+
+void test_replay_load_rejects_other_files(void) {
+    replay_trace_t trace;
+
+    TEST_ASSERT_FALSE(replay_trace_load("/nonexistent/trace.bin", &trace));
+}
+
+void test_replay_enough_memory(void) {
+    replay_trace_t trace;
+    replay_result_t result;
+    const replay_options_t options = { .pace = REPLAY_PACE_FAST };
+
+    TEST_ASSERT_TRUE(replay_trace_generate(&generator, &trace));
+    TEST_ASSERT_TRUE(replay_run(&trace, &options, &result));
+
+    TEST_ASSERT_EQUAL_UINT64(trace.record_count, result.operations);
+    TEST_ASSERT_EQUAL_UINT64(10000, result.allocs);
+    TEST_ASSERT_EQUAL_UINT64(0, result.out_of_memory);
+    TEST_ASSERT_EQUAL_UINT64(0, result.skipped);
+    TEST_ASSERT_EQUAL_UINT64(10000, result.latency[ALLOCATOR_OP_ALLOC].total);
+    TEST_ASSERT_EQUAL_UINT64(count_ops(&trace, ALLOCATOR_TRACE_OP_FREE), result.latency[ALLOCATOR_OP_FREE].total);
+    TEST_ASSERT_EQUAL(4096, result.buffer_size);
+    TEST_ASSERT_TRUE((result.peak_utilization > 0) && (result.peak_utilization <= 4096));
+
+    replay_trace_release(&trace);
+}
+
+void test_replay_out_of_memory(void) {
+    replay_trace_t trace;
+    replay_result_t result;
+    const replay_options_t options = { .pace = REPLAY_PACE_FAST, .buffer_size = 1024 };
+
+    TEST_ASSERT_TRUE(replay_trace_generate(&generator, &trace));
+    TEST_ASSERT_TRUE(replay_run(&trace, &options, &result));
+
+    // Peeks and frees of the blocks that didn't fit are skipped, the others are replayed
+    size_t consumed = count_ops(&trace, ALLOCATOR_TRACE_OP_PEEK) + count_ops(&trace, ALLOCATOR_TRACE_OP_FREE);
+    TEST_ASSERT_GREATER_THAN_UINT64(0, result.out_of_memory);
+    TEST_ASSERT_GREATER_THAN_UINT64(0, result.skipped);
+    TEST_ASSERT_EQUAL_UINT64(consumed, result.skipped + result.latency[ALLOCATOR_OP_PEEK].total + result.latency[ALLOCATOR_OP_FREE].total);
+    TEST_ASSERT_EQUAL(1024, result.buffer_size);
+
+    replay_trace_release(&trace);
+}
+
+void test_replay_overwrite_oldest(void) {
+    replay_trace_t trace;
+    replay_result_t result;
+    const replay_options_t options = { .pace = REPLAY_PACE_FAST, .overwrite_oldest = true, .buffer_size = 1024 };
+
+    TEST_ASSERT_TRUE(replay_trace_generate(&generator, &trace));
+    TEST_ASSERT_TRUE(replay_run(&trace, &options, &result));
+
+    TEST_ASSERT_EQUAL_UINT64(0, result.out_of_memory);
+    TEST_ASSERT_GREATER_THAN_UINT64(0, result.dropped_blocks);
+
+    replay_trace_release(&trace);
+}
+
+void test_replay_failures_in_trace_not_replayed(void) {
+    allocator_trace_config_t config = { .buffer_size = 100, .min_block_size = 5, .max_block_size = 10 };
+    allocator_trace_record_t records[3] = {
+        { .time_ns = 0, .size = 5, .op = ALLOCATOR_TRACE_OP_ALLOC, .result = ALLOCATOR_SUCCESS },
+        { .time_ns = 1, .size = 5, .op = ALLOCATOR_TRACE_OP_ALLOC, .result = ALLOCATOR_ERROR_OUT_OF_MEMORY },
+        { .time_ns = 2, .size = 5, .op = ALLOCATOR_TRACE_OP_FREE, .result = ALLOCATOR_SUCCESS },
+    };
+    replay_trace_t trace = { records, 3, &config, 1 };
+    replay_result_t result;
+    const replay_options_t options = { .pace = REPLAY_PACE_ORIGINAL, .min_block_size = 6 };
+
+    TEST_ASSERT_TRUE(replay_run(&trace, &options, &result));
+    TEST_ASSERT_EQUAL_UINT64(1, result.trace_failures);
+    TEST_ASSERT_EQUAL_UINT64(1, result.allocs);
+
+    // Blocks of 5 bytes are no longer supported, so there is nothing to free
+    TEST_ASSERT_EQUAL_UINT64(1, result.unsupported_size);
+    TEST_ASSERT_EQUAL_UINT64(1, result.skipped);
+}
@@ -0,0 +1,94 @@
+/* AUTOGENERATED FILE. DO NOT EDIT. */
+
+/*=======Automagically Detected Files To Include=====*/
+#include "unity.h"
+#include "allocator.h"
+#include "allocator_trace.h"
+#include "replay.h"
+#include "stdio.h"
+
+/*=======External Functions This Runner Calls=====*/
+extern void setUp(void);
+extern void tearDown(void);
+extern void test_replay_generated_trace(void);
+extern void test_replay_generate_rejects_invalid_parameters(void);
+extern void test_replay_save_and_load(void);
+extern void test_replay_load_sorts_records(void);
+extern void test_replay_load_rejects_other_files(void);
+extern void test_replay_enough_memory(void);
+extern void test_replay_out_of_memory(void);
+extern void test_replay_overwrite_oldest(void);
+extern void test_replay_failures_in_trace_not_replayed(void);
+
+
+/*=======Mock Management=====*/
+static void CMock_Init(void)
+{
+}
+static void CMock_Verify(void)
+{
+}
+static void CMock_Destroy(void)
+{
+}
+
+/*=======Test Reset Options=====*/
+void resetTest(void);
+void resetTest(void)
+{
+  tearDown();
+  CMock_Verify();
+  CMock_Destroy();
+  CMock_Init();
+  setUp();
+}
+void verifyTest(void);
+void verifyTest(void)
+{
+  CMock_Verify();
+}
+
+/*=======Test Runner Used To Run Each Test=====*/
+static void run_test(UnityTestFunction func, const char* name, UNITY_LINE_TYPE line_num)
+{
+    Unity.CurrentTestName = name;
+    Unity.CurrentTestLineNumber = line_num;
+#ifdef UNITY_USE_COMMAND_LINE_ARGS
+    if (!UnityTestMatches())
+        return;
+#endif
+    Unity.NumberOfTests++;
+    UNITY_CLR_DETAILS();
+    UNITY_EXEC_TIME_START();
+    CMock_Init();
+    if (TEST_PROTECT())
+    {
+        setUp();
+        func();
+    }
+    if (TEST_PROTECT())
+    {
+        tearDown();
+        CMock_Verify();
+    }
+    CMock_Destroy();
+    UNITY_EXEC_TIME_STOP();
+    UnityConcludeTest();
+}
+
+/*=======MAIN=====*/
+int main(void)
+{
+  UnityBegin("tests/test_replay.c");
+  run_test(test_replay_generated_trace, "test_replay_generated_trace", 38);
+  run_test(test_replay_generate_rejects_invalid_parameters, "test_replay_generate_rejects_invalid_parameters", 55);
+  run_test(test_replay_save_and_load, "test_replay_save_and_load", 66);
+  run_test(test_replay_load_sorts_records, "test_replay_load_sorts_records", 83);
+  run_test(test_replay_load_rejects_other_files, "test_replay_load_rejects_other_files", 111);
+  run_test(test_replay_enough_memory, "test_replay_enough_memory", 117);
+  run_test(test_replay_out_of_memory, "test_replay_out_of_memory", 137);
+  run_test(test_replay_overwrite_oldest, "test_replay_overwrite_oldest", 155);
+  run_test(test_replay_failures_in_trace_not_replayed, "test_replay_failures_in_trace_not_replayed", 169);
+
+  return UnityEnd();
+}
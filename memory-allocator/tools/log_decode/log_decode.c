@@ -0,0 +1,30 @@
+#include "logging_compact.h"
+#include "stdio.h"
+
+// Turns a compact log stream, written by the compact logging backend, back into text.
+// Usage: log_decode [file], reads from stdin if no file is given
+int main(int argc, char* argv[]) {
+    FILE* p_file = stdin;
+    log_compact_reader_t reader;
+    char text[LOG_RECORD_MAX_TEXT];
+
+    if (argc > 1) {
+        p_file = fopen(argv[1], "rb");
+        if (p_file == NULL) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    log_compact_reader_init(&reader, p_file);
+    while (log_compact_read(&reader, text, sizeof(text)) == true) {
+        fputs(text, stdout);
+    }
+    log_compact_reader_uninit(&reader);
+
+    int result = (ferror(p_file) != 0) ? 1 : 0;
+    if (p_file != stdin) {
+        fclose(p_file);
+    }
+    return result;
+}